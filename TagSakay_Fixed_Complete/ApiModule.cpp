@@ -1,13 +1,32 @@
 #include "ApiModule.h"
+#include "HttpBodyStream.h"
+#include "ScanBatch.h"
+#include "ScanCache.h"
+#include "NetworkTask.h"
+
+// Runtime switch owned by the main sketch
+extern bool useWebSocket;
+
+static const char* circuitNames[] = {"scan", "control", "bulk"};
+
+// All the UI takes from a scan reply: the driver for a 200, nothing for a 404
+static const char SCAN_VERDICT_FILTER[] = "{\"data\":{\"user\":{\"name\":true,\"role\":true}}}";
+
+// Guards ticket allocation; submitScan() may be called from either core
+static portMUX_TYPE scanTicketLock = portMUX_INITIALIZER_UNLOCKED;
 
 ApiModule::ApiModule() 
-  : initialized(false), lastRequestTime(0), consecutiveFailures(0),
+  : requestLock(nullptr), initialized(false), lastRequestTime(0), consecutiveFailures(0),
+    scanIntake(nullptr), scanCompletions(nullptr), pendingScanCount(0),
+    nextTicket(1), scanCallback(nullptr),
     totalRequests(0), successfulRequests(0), failedRequests(0), totalResponseTime(0) {
   
   // Default retry configuration
   retryConfig.maxRetries = API_RETRY_ATTEMPTS;
-  retryConfig.retryDelay = 1000;  // 1 second
+  retryConfig.retryDelay = API_RETRY_BASE_DELAY;
   retryConfig.exponentialBackoff = true;
+
+  memset(&deviceState, 0, sizeof(deviceState));
 }
 
 bool ApiModule::initialize(const String& url, const String& key, const String& devId) {
@@ -19,6 +38,29 @@ bool ApiModule::initialize(const String& url, const String& key, const String& d
   baseUrl = url;
   apiKey = key;
   deviceId = devId;
+  
+  if (!connection.begin(baseUrl)) {
+    LOG_ERROR("API initialization failed: Invalid base URL");
+    return false;
+  }
+  
+  if (!requestLock) {
+    requestLock = xSemaphoreCreateMutex();
+    if (!requestLock) {
+      LOG_ERROR("API initialization failed: Request lock allocation failed");
+      return false;
+    }
+  }
+  
+  if (!scanIntake) {
+    scanIntake = xQueueCreate(API_SCAN_QUEUE_SIZE, sizeof(QueuedScan));
+    scanCompletions = xQueueCreate(API_SCAN_QUEUE_SIZE, sizeof(ScanCompletion));
+    if (!scanIntake || !scanCompletions) {
+      LOG_ERROR("API initialization failed: Scan queue allocation failed");
+      return false;
+    }
+  }
+  
   initialized = true;
   
   LOG_INFO("API Module initialized");
@@ -51,39 +93,36 @@ String ApiModule::buildUrl(const String& endpoint) {
   return url;
 }
 
-bool ApiModule::validateResponse(const String& response) {
-  if (response.length() == 0) {
-    return false;
+bool ApiModule::parseBody(Stream& input, JsonDocument& doc, const char* filter) {
+  DeserializationError error;
+  if (filter) {
+    StaticJsonDocument<256> filterDoc;
+    if (deserializeJson(filterDoc, filter)) {
+      LOG_ERROR("Bad response filter: " + String(filter));
+    }
+    filterDoc["success"] = true;
+    error = deserializeJson(doc, input, DeserializationOption::Filter(filterDoc));
+  } else {
+    error = deserializeJson(doc, input);
   }
   
-  // Try to parse as JSON
-  StaticJsonDocument<512> doc;
-  DeserializationError error = deserializeJson(doc, response);
-  
   if (error) {
-    LOG_WARNING("Response validation failed: Invalid JSON");
-    return false;
-  }
-  
-  // Check for success field
-  if (!doc.containsKey("success")) {
-    LOG_WARNING("Response validation failed: Missing 'success' field");
+    LOG_WARNING("Response parse failed: " + String(error.c_str()));
     return false;
   }
-  
   return true;
 }
 
 ApiResponse ApiModule::sendRequest(const String& method, const String& endpoint, 
-                                   const String& payload, bool useRetry) {
+                                   const String& payload, bool useRetry,
+                                   const char* ifNoneMatch, ApiBody* body) {
   if (useRetry) {
-    return sendRequestWithRetry(method, endpoint, payload);
+    return sendRequestWithRetry(method, endpoint, payload, ifNoneMatch, body);
   }
   
   ApiResponse response;
   response.result = API_NETWORK_ERROR;
   response.httpCode = 0;
-  response.data = "";
   response.error = "";
   
   if (!initialized) {
@@ -97,34 +136,77 @@ ApiResponse ApiModule::sendRequest(const String& method, const String& endpoint,
     LOG_WARNING("Low memory - request may fail");
   }
   
+  // Both cores send through the one connection; wait out a request already
+  // in flight (connect plus response, at worst) rather than open a second socket
+  if (xSemaphoreTake(requestLock, pdMS_TO_TICKS(2 * API_TIMEOUT_MS)) != pdTRUE) {
+    LOG_WARNING("API client busy: " + method + " " + endpoint);
+    response.error = "Client busy";
+    return response;
+  }
+  
+  // A backend known to be down is not asked again until a probe answers;
+  // the caller gets the failure now instead of after API_TIMEOUT_MS
+  ApiCircuit circuitId = circuitFor(endpoint);
+  CircuitBreaker* circuit = circuitId < API_CIRCUIT_COUNT ? &circuits[circuitId] : nullptr;
+  if (circuit && !circuit->allow()) {
+    xSemaphoreGive(requestLock);
+    response.httpCode = HTTP_CODE_CIRCUIT_OPEN;
+    response.error = "Circuit open";
+    return response;
+  }
+  
   String url = buildUrl(endpoint);
   unsigned long startTime = millis();
   
   LOG_DEBUG("API Request: " + method + " " + endpoint);
   
-  http.begin(url);
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("x-api-key", apiKey);
-  http.addHeader("User-Agent", String(DEVICE_NAME) + "/" + String(DEVICE_VERSION));
-  http.setTimeout(API_TIMEOUT_MS);
-  
-  int httpCode;
-  if (method == "POST") {
-    if (payload.length() > 0) {
-      LOG_DEBUG("Payload size: " + String(payload.length()) + " bytes");
+  int httpCode = HTTPC_ERROR_CONNECTION_REFUSED;
+  for (int attempt = 0; attempt < 2; attempt++) {
+    bool reused = false;
+    if (!connection.open(url, reused)) {
+      break;
     }
-    httpCode = http.POST(payload);
-  } else if (method == "PUT") {
-    httpCode = http.PUT(payload);
-  } else if (method == "GET") {
-    httpCode = http.GET();
-  } else if (method == "DELETE") {
-    httpCode = http.sendRequest("DELETE");
-  } else {
-    LOG_ERROR("Unsupported HTTP method: " + method);
-    response.error = "Unsupported method";
-    http.end();
-    return response;
+    response.handshakeMs = reused ? 0 : connection.getLastHandshakeMs();
+    
+    HTTPClient& http = connection.client();
+    http.addHeader("Content-Type", "application/json");
+    http.addHeader("x-api-key", apiKey);
+    http.addHeader("User-Agent", String(DEVICE_NAME) + "/" + String(DEVICE_VERSION));
+    http.setTimeout(API_TIMEOUT_MS);
+    if (ifNoneMatch && ifNoneMatch[0] != '\0') {
+      http.addHeader("If-None-Match", ifNoneMatch);
+    }
+    
+    if (method == "POST") {
+      if (payload.length() > 0) {
+        LOG_DEBUG("Payload size: " + String(payload.length()) + " bytes");
+      }
+      httpCode = http.POST(payload);
+    } else if (method == "PUT") {
+      httpCode = http.PUT(payload);
+    } else if (method == "GET") {
+      httpCode = http.GET();
+    } else if (method == "DELETE") {
+      httpCode = http.sendRequest("DELETE");
+    } else {
+      LOG_ERROR("Unsupported HTTP method: " + method);
+      response.error = "Unsupported method";
+      connection.release();
+      if (circuit) circuit->abandon();
+      xSemaphoreGive(requestLock);
+      return response;
+    }
+    
+    // A kept-alive socket the server already closed fails before anything
+    // was sent; that is safe to repeat once on a fresh connection
+    if (reused && (httpCode == HTTPC_ERROR_SEND_HEADER_FAILED ||
+                   httpCode == HTTPC_ERROR_NOT_CONNECTED)) {
+      LOG_DEBUG("Stale keep-alive connection - reconnecting");
+      connection.close();
+      connection.noteStaleRetry();
+      continue;
+    }
+    break;
   }
   
   lastRequestTime = millis();
@@ -132,16 +214,46 @@ ApiResponse ApiModule::sendRequest(const String& method, const String& endpoint,
   totalRequests++;
   totalResponseTime += requestDuration;
   
+  // The body is parsed once, here, into the caller's document (or, when the
+  // caller keeps nothing, into one just big enough for "success")
+  StaticJsonDocument<64> scratch;
+  JsonDocument& doc = body ? body->doc : scratch;
+  
   if (httpCode > 0) {
-    response.data = http.getString();
+    // Conditional request answered with "nothing new": no body to read or parse
+    response.notModified = httpCode == HTTP_CODE_NOT_MODIFIED ||
+                           (httpCode == HTTP_CODE_NO_CONTENT && ifNoneMatch);
+    bool reusable = true;
+    if (!response.notModified && httpCode != HTTP_CODE_NO_CONTENT) {
+      // Parsed as it comes off the socket: only the filtered fields are ever
+      // held, so a larger reply costs read time, not heap
+      HTTPClient& http = connection.client();
+      HttpBodyStream input;
+      input.begin(connection.socket(), http.getSize(),
+                  http.header("Transfer-Encoding").equalsIgnoreCase("chunked"));
+      input.setTimeout(API_TIMEOUT_MS);
+      uint32_t bodyStarted = micros();
+      response.hasBody = parseBody(input, doc, body ? body->filter : "{}");
+      reusable = input.finish(API_TIMEOUT_MS);
+      connection.noteBody(input.getConsumed(), micros() - bodyStarted, reusable);
+    }
+    response.etag = connection.client().header("ETag");
     response.httpCode = httpCode;
-    http.end();
+    if (reusable) {
+      connection.release();
+    } else {
+      connection.close();  // Body not read to its end: the next reply would be misread
+    }
     
     LOG_DEBUG("Response: " + String(httpCode) + " (" + String(requestDuration) + "ms)");
     
-    if (httpCode >= 200 && httpCode < 300) {
-      // Validate response structure
-      if (validateResponse(response.data)) {
+    if (response.notModified) {
+      response.result = API_SUCCESS;
+      consecutiveFailures = 0;
+      successfulRequests++;
+    } else if (httpCode >= 200 && httpCode < 300) {
+      // A valid reply is a JSON object carrying "success"
+      if (response.hasBody && doc.containsKey("success")) {
         response.result = API_SUCCESS;
         consecutiveFailures = 0;
         successfulRequests++;
@@ -159,19 +271,37 @@ ApiResponse ApiModule::sendRequest(const String& method, const String& endpoint,
       LOG_WARNING("HTTP Error: " + String(httpCode));
     }
   } else {
-    response.error = http.errorToString(httpCode).c_str();
+    response.error = HTTPClient::errorToString(httpCode).c_str();
     response.httpCode = httpCode;
     consecutiveFailures++;
     failedRequests++;
-    http.end();
+    connection.close();  // Unknown state: never reuse a failed socket
     LOG_ERROR("Connection error: " + response.error);
   }
   
+  // Only an unreachable or failing server counts against the circuit; a 4xx
+  // or a malformed body is still an answer
+  if (circuit) {
+    if (httpCode <= 0 || httpCode >= 500) {
+      circuit->recordFailure(lastRequestTime);
+    } else {
+      circuit->recordSuccess(lastRequestTime);
+    }
+  }
+  
+  xSemaphoreGive(requestLock);
   return response;
 }
 
+ApiResponse ApiModule::request(const String& method, const String& endpoint,
+                               const String& payload, bool useRetry,
+                               const char* ifNoneMatch, ApiBody* body) {
+  return sendRequest(method, endpoint, payload, useRetry, ifNoneMatch, body);
+}
+
 ApiResponse ApiModule::sendRequestWithRetry(const String& method, const String& endpoint, 
-                                           const String& payload) {
+                                           const String& payload, const char* ifNoneMatch,
+                                           ApiBody* body) {
   ApiResponse response;
   int attempt = 0;
   unsigned long retryDelay = retryConfig.retryDelay;
@@ -187,7 +317,7 @@ ApiResponse ApiModule::sendRequestWithRetry(const String& method, const String&
       }
     }
     
-    response = sendRequest(method, endpoint, payload, false);
+    response = sendRequest(method, endpoint, payload, false, ifNoneMatch, body);
     
     if (response.result == API_SUCCESS) {
       if (attempt > 0) {
@@ -195,6 +325,9 @@ ApiResponse ApiModule::sendRequestWithRetry(const String& method, const String&
       }
       return response;
     }
+    if (response.httpCode == HTTP_CODE_CIRCUIT_OPEN) {
+      return response;  // Retrying cannot help until a probe closes it
+    }
     
     attempt++;
   }
@@ -203,25 +336,31 @@ ApiResponse ApiModule::sendRequestWithRetry(const String& method, const String&
   return response;
 }
 
-ApiResponse ApiModule::sendScan(const String& tagId, const String& location) {
-  if (!IS_VALID_TAG_ID(tagId)) {
+ApiResponse ApiModule::sendScan(const TagUid& tag, const char* location) {
+  if (tag.isEmpty()) {
     ApiResponse response;
     response.result = API_JSON_ERROR;
     response.error = "Invalid tag ID";
     response.httpCode = 0;
-    response.data = "";
     return response;
   }
   
+  LOG_INFOF("Sending RFID scan: %s\n", tag.toText().c_str());
+  
+  return sendRequest("POST", "/api/rfid/scan", buildScanPayload(tag, location ? location : ""));
+}
+
+String ApiModule::buildScanPayload(const TagUid& tag, const char* location) {
+  TagIdText tagId = tag.toText();
   StaticJsonDocument<512> doc;
-  doc["tagId"] = tagId;
+  doc["tagId"] = tagId.c_str();
   doc["deviceId"] = deviceId;
   doc["timestamp"] = millis();
   
-  if (location.length() > 0) {
+  if (location[0] != '\0') {
     doc["location"] = location;
   } else {
-    doc["location"] = deviceConfig.location;
+    doc["location"] = deviceState.location;
   }
   
   // Add device context
@@ -230,53 +369,266 @@ ApiResponse ApiModule::sendScan(const String& tagId, const String& location) {
   
   String payload;
   serializeJson(doc, payload);
+  return payload;
+}
+
+ScanTicket ApiModule::submitScan(const TagUid& tag, const char* location, bool registration,
+                                 const ScanTiming* timing) {
+  if (!initialized || !scanIntake) {
+    LOG_ERROR("API not initialized");
+    return SCAN_TICKET_NONE;
+  }
   
-  LOG_INFO("Sending RFID scan: " + tagId);
+  if (tag.isEmpty()) {
+    LOG_ERROR("Invalid tag ID");
+    return SCAN_TICKET_NONE;
+  }
+  
+  QueuedScan scan;
+  memset(&scan, 0, sizeof(scan));
+  scan.registration = registration;
+  if (timing) {
+    scan.timing = *timing;
+  }
+  scan.tag = tag;
+  strlcpy(scan.location, location ? location : "", sizeof(scan.location));
   
-  return sendRequest("POST", "/api/rfid/scan", payload);
+  return enqueueScan(scan);
 }
 
-ApiResponse ApiModule::sendHeartbeat(bool includeStats) {
-  String endpoint = "/api/devices/" + deviceId + "/heartbeat";
+ScanTicket ApiModule::enqueueScan(QueuedScan& scan) {
+  portENTER_CRITICAL(&scanTicketLock);
+  scan.ticket = nextTicket++;
+  if (nextTicket == SCAN_TICKET_NONE) {
+    nextTicket = 1;
+  }
+  portEXIT_CRITICAL(&scanTicketLock);
   
-  StaticJsonDocument<512> doc;
+  scan.submittedAt = millis();
+  scan.nextAttempt = scan.submittedAt;
+  
+  if (xQueueSend(scanIntake, &scan, 0) != pdTRUE) {
+    LOG_WARNINGF("Scan queue full - scan rejected: %s\n", scan.tag.toText().c_str());
+    return SCAN_TICKET_NONE;
+  }
+  
+  LOG_DEBUG("Scan queued (ticket " + String(scan.ticket) + ")");
+  return scan.ticket;
+}
+
+void ApiModule::serviceScanQueue() {
+  if (!scanIntake) {
+    return;
+  }
+  
+  // Move new submissions into free retry slots
+  while (pendingScanCount < API_SCAN_QUEUE_SIZE &&
+         xQueueReceive(scanIntake, &pendingScans[pendingScanCount], 0) == pdTRUE) {
+    pendingScanCount++;
+  }
+  
+  // Send at most one due scan per call so heartbeats and WebSocket
+  // traffic are never stuck behind a backlog of retries
+  unsigned long now = millis();
+  for (int i = 0; i < pendingScanCount; i++) {
+    QueuedScan& scan = pendingScans[i];
+    if ((long)(now - scan.nextAttempt) < 0) {
+      continue;
+    }
+    
+    TagIdText tagId = scan.tag.toText();
+    if (scan.attempts > 0) {
+      LOG_INFOF("Scan retry %u/%d: %s\n", scan.attempts, retryConfig.maxRetries, tagId.c_str());
+    } else {
+      LOG_INFOF("Sending RFID scan: %s\n", tagId.c_str());
+    }
+    
+    scan.attempts++;
+    String payload = buildScanPayload(scan.tag, scan.location);
+    StaticJsonDocument<256> verdict;
+    ApiBody body{verdict, SCAN_VERDICT_FILTER};
+    scan.timing.sentUs = micros();
+    ApiResponse response = sendRequest("POST", "/api/rfid/scan", payload, false, nullptr, &body);
+    scan.timing.receivedUs = micros();
+    
+    // Only a lost request is worth resending. A 4xx is the server's answer
+    // (404/403 are verdicts), and every resend would be recorded again.
+    // An open circuit is not retried here either; the breaker's probe decides.
+    bool transient = (response.httpCode <= 0 && response.httpCode != HTTP_CODE_CIRCUIT_OPEN) ||
+                     response.httpCode >= 500;
+    if (response.result != API_SUCCESS && transient &&
+        scan.attempts <= retryConfig.maxRetries) {
+      // Back off without blocking; other slots keep being served meanwhile
+      unsigned long backoff = retryConfig.retryDelay;
+      if (retryConfig.exponentialBackoff) {
+        backoff <<= (scan.attempts - 1);
+      }
+      scan.nextAttempt = millis() + backoff;
+      return;
+    }
+    
+    if (response.result != API_SUCCESS && transient) {
+      LOG_ERRORF("Scan failed after %d retries: %s\n", retryConfig.maxRetries, tagId.c_str());
+    }
+    
+    completeScan(scan, response, verdict);
+    
+    // Drop the slot, keeping submission order for the rest
+    for (int j = i; j < pendingScanCount - 1; j++) {
+      pendingScans[j] = pendingScans[j + 1];
+    }
+    pendingScanCount--;
+    return;
+  }
+}
+
+void ApiModule::completeScan(const QueuedScan& scan, const ApiResponse& response,
+                             JsonDocument& body) {
+  ScanCompletion completion;
+  memset(&completion, 0, sizeof(completion));
+  completion.ticket = scan.ticket;
+  completion.registration = scan.registration;
+  completion.result = response.result;
+  completion.httpCode = response.httpCode;
+  completion.attempts = scan.attempts;
+  completion.elapsedMs = millis() - scan.submittedAt;
+  completion.timing = scan.timing;
+  completion.tag = scan.tag;
+  strlcpy(completion.error, response.error.c_str(), sizeof(completion.error));
+  
+  // 200 names the driver, 404 means unregistered: both are verdicts the UI
+  // shows and caches for the next tap
+  if (!scan.registration && response.hasBody &&
+      (response.result == API_SUCCESS || response.httpCode == 404)) {
+    if (response.httpCode == 404) {
+      consecutiveFailures = 0;  // The backend answered; not a link failure
+    }
+    JsonObject user = body["data"]["user"];
+    completion.hasVerdict = true;
+    completion.registered = response.result == API_SUCCESS;
+    strlcpy(completion.userName, user["name"] | "", sizeof(completion.userName));
+    strlcpy(completion.userRole, user["role"] | "", sizeof(completion.userRole));
+  }
+  
+  if (scanCallback) {
+    scanCallback(completion);
+  } else if (xQueueSend(scanCompletions, &completion, 0) != pdTRUE) {
+    LOG_WARNING("Scan completion queue full - result dropped");
+  }
+}
+
+bool ApiModule::pollScanCompletion(ScanCompletion& completion) {
+  if (!scanCompletions) {
+    return false;
+  }
+  return xQueueReceive(scanCompletions, &completion, 0) == pdTRUE;
+}
+
+int ApiModule::getPendingScanCount() const {
+  int queued = scanIntake ? (int)uxQueueMessagesWaiting(scanIntake) : 0;
+  return pendingScanCount + queued;
+}
+
+void ApiModule::fillHeartbeat(JsonDocument& doc, bool includeStats) {
   doc["status"] = "online";
   doc["uptime"] = millis() / 1000;
   doc["freeHeap"] = ESP.getFreeHeap();
-  doc["location"] = deviceConfig.location;
+  doc["location"] = deviceState.location;
   doc["firmwareVersion"] = FIRMWARE_VERSION;
   // Sync key device flags so server UI reflects current state without waiting for poll
-  doc["registrationMode"] = registrationMode;
-  doc["scanMode"] = deviceConfig.scanMode;
-  if (expectedRegistrationTagId.length() > 0) {
-    doc["pendingRegistrationTagId"] = expectedRegistrationTagId;
+  doc["registrationMode"] = deviceState.registrationMode;
+  doc["scanMode"] = deviceState.scanMode;
+  if (deviceState.pendingTagId[0] != '\0') {
+    doc["pendingRegistrationTagId"] = deviceState.pendingTagId;
   }
   
   if (includeStats) {
     JsonObject stats = doc.createNestedObject("stats");
     stats["totalScans"] = systemStatus.scanCount;
     stats["errorCount"] = systemStatus.errorCount;
+    stats["duplicateScans"] = systemStatus.duplicateScans;
+    if (scanJournal.isReady()) {
+      stats["offlinePending"] = scanJournal.getPendingCount();
+    }
+    connection.report(stats.createNestedObject("http"));
+    reportCircuits(stats.createNestedObject("circuits"));
+    if (useWebSocket) {
+      JsonObject websocket = stats.createNestedObject("websocket");
+      wsModule.report(websocket);
+      networkTask.reportWsScans(websocket.createNestedObject("scans"));
+      networkTask.reportTransport(stats.createNestedObject("transport"));
+    }
+    JsonObject cache = stats.createNestedObject("scanCache");
+    cache["hits"] = scanCache.getHits();
+    cache["misses"] = scanCache.getMisses();
+    cache["expired"] = scanCache.getExpired();
+    cache["corrected"] = scanCache.getCorrected();
+    JsonObject polls = stats.createNestedObject("commandPolls");
+    polls["changed"] = commandPoll.changed;
+    polls["unchanged"] = commandPoll.unchanged;
+    polls["pushed"] = commandPoll.pushed;
     stats["apiSuccessRate"] = getSuccessRate();
     stats["avgResponseTime"] = (totalRequests > 0) ? (totalResponseTime / totalRequests) : 0;
+    scanLatency.report(stats.createNestedObject("latency"));
+    networkTask.reportQueues(stats.createNestedObject("queues"));
   }
+}
+
+ApiResponse ApiModule::sendHeartbeat(bool includeStats, bool useRetry) {
+  String endpoint = "/api/devices/" + deviceId + "/heartbeat";
   
+  // On the heap, not the 12 KB network task stack, and freed before the
+  // request so it is not held across the connect and response wait
   String payload;
-  serializeJson(doc, payload);
+  {
+    DynamicJsonDocument doc(3584);  // Latency histograms and counters add up
+    fillHeartbeat(doc, includeStats);
+    serializeJson(doc, payload);
+  }
   
   LOG_DEBUG("Sending heartbeat");
   
-  return sendRequest("POST", endpoint, payload);
+  return sendRequest("POST", endpoint, payload, useRetry);
+}
+
+ApiResponse ApiModule::sendSync(bool includeStats, const TelemetryEvent* events, int count,
+                               const char* commandsVersion, ApiBody* body) {
+  String endpoint = "/api/devices/" + deviceId + "/sync";
+  
+  // Scoped like sendHeartbeat(): only the serialized payload outlives it
+  String payload;
+  {
+    DynamicJsonDocument doc(4096);  // Heartbeat plus up to SYNC_TELEMETRY_MAX reports
+    fillHeartbeat(doc, includeStats);
+    
+    if (count > 0) {
+      JsonArray telemetry = doc.createNestedArray("telemetry");
+      unsigned long now = millis();
+      for (int i = 0; i < count; i++) {
+        JsonObject event = telemetry.createNestedObject();
+        event["type"] = "status";
+        event["reason"] = (const char*)events[i].reason;
+        event["ageMs"] = now - events[i].at;  // The device clock may not be set
+      }
+    }
+    
+    serializeJson(doc, payload);
+  }
+  
+  LOG_DEBUG("Sending sync (" + String(count) + " telemetry event(s))");
+  
+  return sendRequest("POST", endpoint, payload, false, commandsVersion, body);
 }
 
 ApiResponse ApiModule::checkConnection() {
   LOG_DEBUG("Checking API connection");
-  return sendRequest("GET", "/api/health", "", false);  // No retry for health check
+  return sendRequest("GET", API_HEALTH_ENDPOINT, "", false);  // No retry for health check
 }
 
-ApiResponse ApiModule::getRegistrationStatus() {
+ApiResponse ApiModule::getRegistrationStatus(ApiBody* body) {
   String endpoint = "/api/devices/" + deviceId + "/registration-status";
   LOG_DEBUG("Checking registration status");
-  return sendRequest("GET", endpoint, "");
+  return sendRequest("GET", endpoint, "", false, nullptr, body);
 }
 
 ApiResponse ApiModule::sendQueueOverride(int queueNumber, const String& reason) {
@@ -285,7 +637,6 @@ ApiResponse ApiModule::sendQueueOverride(int queueNumber, const String& reason)
     response.result = API_JSON_ERROR;
     response.error = "Invalid queue number";
     response.httpCode = 0;
-    response.data = "";
     return response;
   }
   
@@ -304,7 +655,8 @@ ApiResponse ApiModule::sendQueueOverride(int queueNumber, const String& reason)
   return sendRequest("POST", endpoint, payload);
 }
 
-ApiResponse ApiModule::reportStatus(const String& status, const String& reason) {
+ApiResponse ApiModule::reportStatus(const String& status, const String& reason,
+                                    const DeviceStateSnapshot& state) {
   String endpoint = "/api/devices/" + deviceId + "/status";
   
   StaticJsonDocument<512> doc;
@@ -313,11 +665,11 @@ ApiResponse ApiModule::reportStatus(const String& status, const String& reason)
   doc["timestamp"] = millis();
   doc["uptime"] = millis() / 1000;
   doc["freeHeap"] = ESP.getFreeHeap();
-  doc["location"] = deviceConfig.location;
+  doc["location"] = state.location;
   doc["firmwareVersion"] = FIRMWARE_VERSION;
-  doc["wifiConnected"] = systemStatus.wifiConnected;
-  doc["rfidInitialized"] = systemStatus.rfidInitialized;
-  doc["offlineMode"] = systemStatus.offlineMode;
+  doc["wifiConnected"] = state.wifiConnected;
+  doc["rfidInitialized"] = state.rfidInitialized;
+  doc["offlineMode"] = state.offlineMode;
   
   String payload;
   serializeJson(doc, payload);
@@ -349,12 +701,12 @@ ApiResponse ApiModule::updateDeviceConfig(const String& config) {
   return sendRequest("PUT", endpoint, config);
 }
 
-ApiResponse ApiModule::getDeviceConfig() {
+ApiResponse ApiModule::getDeviceConfig(ApiBody* body) {
   String endpoint = "/api/devices/" + deviceId + "/config";
   
   LOG_DEBUG("Fetching device configuration");
   
-  return sendRequest("GET", endpoint, "");
+  return sendRequest("GET", endpoint, "", false, nullptr, body);
 }
 
 ApiResponse ApiModule::reportError(const String& errorType, const String& errorMessage) {
@@ -375,48 +727,40 @@ ApiResponse ApiModule::reportError(const String& errorType, const String& errorM
   return sendRequest("POST", endpoint, payload, false);  // Don't retry error reports
 }
 
-ApiResponse ApiModule::syncTime() {
+ApiResponse ApiModule::syncTime(ApiBody* body) {
   LOG_DEBUG("Syncing time from server");
-  return sendRequest("GET", "/api/time", "");
+  return sendRequest("GET", "/api/time", "", false, nullptr, body);
 }
 
-ApiResponse ApiModule::sendBatchScans(const String scans[], int count) {
-  if (count == 0 || count > MAX_SCAN_QUEUE_SIZE) {
+ApiResponse ApiModule::sendBatchScans(uint32_t journalId, const JournalRecord* records, int count,
+                                      int& sent) {
+  sent = 0;
+  if (count <= 0) {
     ApiResponse response;
     response.result = API_JSON_ERROR;
     response.error = "Invalid batch size";
     response.httpCode = 0;
-    response.data = "";
     return response;
   }
   
-  DynamicJsonDocument doc(2048);  // Larger buffer for batch
-  JsonArray scanArray = doc.createNestedArray("scans");
-  
-  for (int i = 0; i < count; i++) {
-    JsonObject scan = scanArray.createNestedObject();
-    
-    // Parse scan string (format: "tagId|timestamp")
-    int separatorPos = scans[i].indexOf('|');
-    if (separatorPos > 0) {
-      scan["tagId"] = scans[i].substring(0, separatorPos);
-      scan["timestamp"] = scans[i].substring(separatorPos + 1).toInt();
-    } else {
-      scan["tagId"] = scans[i];
-      scan["timestamp"] = millis();
-    }
-    scan["deviceId"] = deviceId;
+  char body[SCAN_BATCH_MAX_BYTES];
+  ScanBatchWriter batch(body, sizeof(body), journalId);
+  while (sent < count && batch.add(records[sent])) {
+    sent++;
   }
+  if (sent == 0) {
+    ApiResponse response;
+    response.result = API_JSON_ERROR;
+    response.error = "Unreadable journal record";
+    response.httpCode = 0;
+    return response;
+  }
+  batch.finish();
   
-  doc["deviceId"] = deviceId;
-  doc["count"] = count;
-  
-  String payload;
-  serializeJson(doc, payload);
-  
-  LOG_INFO("Sending batch scans: " + String(count) + " items");
+  LOG_INFOF("Sending batch scans: %d items (%u bytes)\n", sent, (unsigned)batch.getLength());
   
-  return sendRequest("POST", "/api/rfid/batch-scan", payload);
+  // No retry loop here: the drain worker owns pacing and backoff
+  return sendRequest("POST", "/api/rfid/batch-scan", String(body), false);
 }
 
 void ApiModule::getStatistics(unsigned long& total, unsigned long& success, 
@@ -444,6 +788,79 @@ float ApiModule::getSuccessRate() const {
   return (float)successfulRequests / (float)totalRequests * 100.0f;
 }
 
+ApiCircuit ApiModule::circuitFor(const String& endpoint) {
+  if (endpoint == API_HEALTH_ENDPOINT) {
+    return API_CIRCUIT_COUNT;  // The probe itself is never refused
+  }
+  if (endpoint.startsWith("/api/rfid/batch-scan") || endpoint.startsWith("/api/rfid/filter")) {
+    return API_CIRCUIT_BULK;
+  }
+  if (endpoint.startsWith("/api/rfid/")) {
+    return API_CIRCUIT_SCAN;
+  }
+  return API_CIRCUIT_CONTROL;
+}
+
+void ApiModule::probeCircuits() {
+  if (!initialized) {
+    return;
+  }
+  
+  unsigned long now = millis();
+  bool due = false;
+  for (int i = 0; i < API_CIRCUIT_COUNT; i++) {
+    due = due || circuits[i].probeDue(now);
+  }
+  if (!due) {
+    return;
+  }
+  
+  // One cheap request answers for every due circuit. Any answer counts: the
+  // real requests that follow decide whether each class recovered.
+  ApiResponse response = sendRequest("GET", API_HEALTH_ENDPOINT, "", false);
+  bool answered = response.httpCode > 0 && response.httpCode < 500;
+  LOG_INFOF("Circuit probe: %s (%d)\n", answered ? "answered" : "failed", response.httpCode);
+  
+  if (xSemaphoreTake(requestLock, pdMS_TO_TICKS(2 * API_TIMEOUT_MS)) != pdTRUE) {
+    return;  // Still due; the next call probes again
+  }
+  now = millis();
+  for (int i = 0; i < API_CIRCUIT_COUNT; i++) {
+    if (!circuits[i].probeDue(now)) {
+      continue;
+    }
+    if (answered) {
+      circuits[i].probeAnswered();
+    } else {
+      circuits[i].probeFailed(now);
+    }
+  }
+  xSemaphoreGive(requestLock);
+}
+
+void ApiModule::openCircuits() {
+  if (!requestLock || xSemaphoreTake(requestLock, pdMS_TO_TICKS(2 * API_TIMEOUT_MS)) != pdTRUE) {
+    return;
+  }
+  unsigned long now = millis();
+  for (int i = 0; i < API_CIRCUIT_COUNT; i++) {
+    circuits[i].forceOpen(now);
+  }
+  xSemaphoreGive(requestLock);
+}
+
+void ApiModule::reportCircuits(JsonObject obj) const {
+  for (int i = 0; i < API_CIRCUIT_COUNT; i++) {
+    circuits[i].report(obj.createNestedObject(circuitNames[i]));
+  }
+}
+
+void ApiModule::printCircuitStatus() {
+  for (int i = 0; i < API_CIRCUIT_COUNT; i++) {
+    circuits[i].printStatus(circuitNames[i]);
+  }
+}
+
 bool ApiModule::testEndpoint(const String& endpoint) {
   LOG_INFO("Testing endpoint: " + endpoint);
   ApiResponse response = sendRequest("GET", endpoint, "", false);
@@ -3,9 +3,26 @@
 
 #include <Arduino.h>
 #include <HTTPClient.h>
+#include "HttpConnection.h"
 #include <ArduinoJson.h>
 #include "Config.h"
 #include "NetworkModule.h"  // Use ApiResponse from NetworkModule
+#include "LatencyStats.h"
+#include "TagUid.h"
+#include "ScanJournal.h"
+#include "CircuitBreaker.h"
+
+// Endpoint classes with their own circuit breaker: a failing batch upload
+// must not take live scans offline, and the reverse
+enum ApiCircuit {
+  API_CIRCUIT_SCAN,       // Live scans and registrations
+  API_CIRCUIT_CONTROL,    // Sync, heartbeat, commands, time, config
+  API_CIRCUIT_BULK,       // Journal batch uploads, filter downloads
+  API_CIRCUIT_COUNT
+};
+
+// httpCode of a request refused locally because its circuit is open
+#define HTTP_CODE_CIRCUIT_OPEN -100
 
 // Request retry configuration
 struct RetryConfig {
@@ -14,9 +31,63 @@ struct RetryConfig {
   bool exponentialBackoff;
 };
 
+// Device state captured on the UI core for outgoing payloads. ApiModule runs
+// on the network core and must not read the String globals directly.
+struct DeviceStateSnapshot {
+  bool registrationMode;
+  bool scanMode;
+  char pendingTagId[MAX_TAG_ID_LENGTH + 1];
+  char location[32];
+  bool wifiConnected;
+  bool rfidInitialized;
+  bool offlineMode;
+};
+
+// Asynchronous scan submission: submitScan() returns a ticket at once and the
+// network task delivers (and retries) the scan from serviceScanQueue().
+typedef uint32_t ScanTicket;
+#define SCAN_TICKET_NONE 0
+
+struct QueuedScan {
+  ScanTicket ticket;
+  bool registration;
+  uint8_t attempts;
+  unsigned long submittedAt;
+  unsigned long nextAttempt;
+  ScanTiming timing;
+  TagUid tag;
+  char location[32];
+};
+
+struct ScanCompletion {
+  ScanTicket ticket;
+  bool registration;
+  ApiResult result;
+  int httpCode;
+  uint8_t attempts;
+  unsigned long elapsedMs;     // Submit to final result, including retries
+  ScanTiming timing;           // Caller's timing with sent/received stamped
+  TagUid tag;
+  bool hasVerdict;             // Server said whether the tag is registered
+  bool registered;
+  char userName[32];
+  char userRole[16];
+  char error[40];
+};
+
+// Status report held on the network core until the next sync uploads it
+struct TelemetryEvent {
+  char reason[32];
+  unsigned long at;            // millis() when reported
+};
+
+// Invoked on the network core once a scan succeeds or exhausts its retries
+typedef void (*ScanCompletionCallback)(const ScanCompletion& completion);
+
 class ApiModule {
 private:
-  HTTPClient http;
+  HttpConnection connection;        // Kept-alive socket to the API host
+  SemaphoreHandle_t requestLock;     // One request in flight on the connection
   String apiKey;
   String deviceId;
   String baseUrl;
@@ -24,6 +95,18 @@ private:
   unsigned long lastRequestTime;
   int consecutiveFailures;
   RetryConfig retryConfig;
+  DeviceStateSnapshot deviceState;
+
+  // Async scan queue
+  QueueHandle_t scanIntake;          // submitScan() -> serviceScanQueue()
+  QueueHandle_t scanCompletions;     // Finished scans when no callback is set
+  QueuedScan pendingScans[API_SCAN_QUEUE_SIZE];
+  int pendingScanCount;
+  ScanTicket nextTicket;
+  ScanCompletionCallback scanCallback;
+
+  // Circuit breakers (guarded by requestLock)
+  CircuitBreaker circuits[API_CIRCUIT_COUNT];
   
   // Statistics
   unsigned long totalRequests;
@@ -32,11 +115,20 @@ private:
   unsigned long totalResponseTime;
   
   String buildUrl(const String& endpoint);
+  // One attempt unless useRetry; the retry loop blocks in delay(), so the
+  // network task leaves retries to its scheduler
   ApiResponse sendRequest(const String& method, const String& endpoint, 
-                         const String& payload, bool useRetry = true);
+                         const String& payload, bool useRetry = false,
+                         const char* ifNoneMatch = nullptr, ApiBody* body = nullptr);
   ApiResponse sendRequestWithRetry(const String& method, const String& endpoint, 
-                                   const String& payload);
-  bool validateResponse(const String& response);
+                                   const String& payload, const char* ifNoneMatch,
+                                   ApiBody* body);
+  bool parseBody(Stream& input, JsonDocument& doc, const char* filter);
+  String buildScanPayload(const TagUid& tag, const char* location);
+  void fillHeartbeat(JsonDocument& doc, bool includeStats);
+  static ApiCircuit circuitFor(const String& endpoint);
+  ScanTicket enqueueScan(QueuedScan& scan);
+  void completeScan(const QueuedScan& scan, const ApiResponse& response, JsonDocument& body);
   
 public:
   ApiModule();
@@ -44,24 +136,47 @@ public:
   // Initialization
   bool initialize(const String& url, const String& key, const String& devId);
   void setRetryConfig(int maxRetries, unsigned long retryDelay, bool exponentialBackoff = true);
+  void updateDeviceState(const DeviceStateSnapshot& state) { deviceState = state; }
+  
+  // Generic request on the shared connection, for endpoints without a
+  // dedicated wrapper (safe from either core; callers queue on the lock).
+  // With ifNoneMatch set, an unchanged resource returns notModified. The
+  // body is parsed into body->doc when given (see ApiBody).
+  ApiResponse request(const String& method, const String& endpoint,
+                      const String& payload = "", bool useRetry = false,
+                      const char* ifNoneMatch = nullptr, ApiBody* body = nullptr);
   
   // Core endpoints
-  ApiResponse sendScan(const String& tagId, const String& location = "");
-  ApiResponse sendHeartbeat(bool includeStats = true);
+  ApiResponse sendScan(const TagUid& tag, const char* location = "");
+
+  // Non-blocking scan submission (safe from either core)
+  ScanTicket submitScan(const TagUid& tag, const char* location = "", bool registration = false,
+                        const ScanTiming* timing = nullptr);
+  void setScanCompletionCallback(ScanCompletionCallback callback) { scanCallback = callback; }
+  bool pollScanCompletion(ScanCompletion& completion);
+  void serviceScanQueue();           // Network core: deliver due scans
+  int getPendingScanCount() const;
+  ApiResponse sendHeartbeat(bool includeStats = true, bool useRetry = false);
   ApiResponse checkConnection();
-  ApiResponse getRegistrationStatus();
+  
+  // Heartbeat (stats only when includeStats), buffered status reports and
+  // the command poll in one request. Single attempt: the next sync retries.
+  ApiResponse sendSync(bool includeStats, const TelemetryEvent* events, int count,
+                       const char* commandsVersion, ApiBody* body = nullptr);
+  ApiResponse getRegistrationStatus(ApiBody* body = nullptr);
   ApiResponse sendQueueOverride(int queueNumber, const String& reason);
-  ApiResponse reportStatus(const String& status, const String& reason);
+  ApiResponse reportStatus(const String& status, const String& reason, const DeviceStateSnapshot& state);
   
   // New endpoints
   ApiResponse registerDevice(const String& macAddress, const String& name, const String& location);
   ApiResponse updateDeviceConfig(const String& config);
-  ApiResponse getDeviceConfig();
+  ApiResponse getDeviceConfig(ApiBody* body = nullptr);
   ApiResponse reportError(const String& errorType, const String& errorMessage);
-  ApiResponse syncTime();
+  ApiResponse syncTime(ApiBody* body = nullptr);
   
-  // Batch operations (for offline queue)
-  ApiResponse sendBatchScans(const String scans[], int count);
+  // Batch operations (for offline queue). Sends records in order until the
+  // SCAN_BATCH_MAX_BYTES body is full; sent is how many were included.
+  ApiResponse sendBatchScans(uint32_t journalId, const JournalRecord* records, int count, int& sent);
   
   // State management
   bool isInitialized() const { return initialized; }
@@ -69,6 +184,15 @@ public:
   void resetFailureCount() { consecutiveFailures = 0; }
   unsigned long getLastRequestTime() const { return lastRequestTime; }
   
+  // Circuit breakers. While a circuit is open its requests fail at once with
+  // HTTP_CODE_CIRCUIT_OPEN; probeCircuits() (network core) sends one health
+  // check when a probe is due and half-opens every due circuit it answers.
+  void probeCircuits();
+  void openCircuits();               // Known outage: WiFi lost, boot check failed
+  CircuitState getCircuitState(ApiCircuit circuit) const { return circuits[circuit].getState(); }
+  void reportCircuits(JsonObject obj) const;
+  void printCircuitStatus();
+  
   // Statistics
   void getStatistics(unsigned long& total, unsigned long& success, 
                     unsigned long& failed, unsigned long& avgResponseTime);
@@ -76,8 +200,11 @@ public:
   float getSuccessRate() const;
   
   // Diagnostics
+  HttpConnection& getConnection() { return connection; }
   bool testEndpoint(const String& endpoint);
   String getLastError() const;
 };
 
+extern ApiModule apiModule;
+
 #endif // API_MODULE_H
@@ -0,0 +1,111 @@
+#include "CircuitBreaker.h"
+
+static const char* circuitStateNames[] = {"closed", "open", "half-open"};
+
+CircuitBreaker::CircuitBreaker()
+  : state(CIRCUIT_CLOSED), failures(0), trips(0), trialInFlight(false), retryAt(0),
+    openedAt(0), opened(0), rejected(0), probes(0), lastOutageMs(0) {}
+
+bool CircuitBreaker::allow() {
+  switch (state) {
+    case CIRCUIT_CLOSED:
+      return true;
+
+    case CIRCUIT_HALF_OPEN:
+      if (!trialInFlight) {
+        trialInFlight = true;
+        return true;
+      }
+      break;
+
+    case CIRCUIT_OPEN:
+      break;
+  }
+  rejected++;
+  return false;
+}
+
+void CircuitBreaker::recordSuccess(unsigned long now) {
+  if (state != CIRCUIT_CLOSED) {
+    lastOutageMs = now - openedAt;
+    Serial.printf("[BREAKER] Closed after %lums\n", (unsigned long)lastOutageMs);
+  }
+  state = CIRCUIT_CLOSED;
+  failures = 0;
+  trips = 0;
+  trialInFlight = false;
+}
+
+void CircuitBreaker::recordFailure(unsigned long now) {
+  switch (state) {
+    case CIRCUIT_CLOSED:
+      if (++failures >= BREAKER_FAILURE_THRESHOLD) {
+        trip(now);
+      }
+      break;
+
+    case CIRCUIT_HALF_OPEN:
+      trip(now);  // The trial failed: back off further
+      break;
+
+    case CIRCUIT_OPEN:
+      break;      // Sent before the circuit opened
+  }
+}
+
+void CircuitBreaker::probeAnswered() {
+  probes++;
+  if (state == CIRCUIT_OPEN) {
+    state = CIRCUIT_HALF_OPEN;
+    trialInFlight = false;
+  }
+}
+
+void CircuitBreaker::probeFailed(unsigned long now) {
+  probes++;
+  trip(now);
+}
+
+void CircuitBreaker::forceOpen(unsigned long now) {
+  if (state != CIRCUIT_OPEN) {
+    trip(now);
+  }
+}
+
+void CircuitBreaker::trip(unsigned long now) {
+  if (state == CIRCUIT_CLOSED) {
+    openedAt = now;
+    opened++;
+  }
+  state = CIRCUIT_OPEN;
+  failures = 0;
+  trialInFlight = false;
+  if (trips < 255) trips++;
+
+  unsigned long ceiling = BREAKER_PROBE_BASE;
+  for (uint8_t i = 1; i < trips && ceiling < BREAKER_PROBE_MAX; i++) {
+    ceiling *= 2;
+  }
+  if (ceiling > BREAKER_PROBE_MAX) {
+    ceiling = BREAKER_PROBE_MAX;
+  }
+
+  // Half fixed, half random, so a fleet does not probe a recovering backend in step
+  unsigned long delayMs = ceiling / 2 + esp_random() % (ceiling / 2 + 1);
+  retryAt = now + delayMs;
+  Serial.printf("[BREAKER] Open - probing in %lums\n", delayMs);
+}
+
+void CircuitBreaker::report(JsonObject obj) const {
+  obj["state"] = circuitStateNames[state];
+  obj["opened"] = opened;
+  obj["rejected"] = rejected;
+  obj["probes"] = probes;
+  obj["lastOutageMs"] = lastOutageMs;
+}
+
+void CircuitBreaker::printStatus(const char* name) {
+  Serial.printf("[BREAKER] %s state=%s opened=%lu rejected=%lu probes=%lu lastOutage=%lums\n",
+                name, circuitStateNames[state], (unsigned long)opened, (unsigned long)rejected,
+                (unsigned long)probes, (unsigned long)lastOutageMs);
+}
@@ -0,0 +1,61 @@
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "Config.h"
+
+enum CircuitState {
+  CIRCUIT_CLOSED,     // Requests flow; failures are counted
+  CIRCUIT_OPEN,       // Requests refused at once until a probe succeeds
+  CIRCUIT_HALF_OPEN   // Probe answered: one real request decides
+};
+
+// Failure gate for one class of API endpoints. BREAKER_FAILURE_THRESHOLD
+// consecutive failures (no answer, or 5xx) open it; while open, requests
+// fail immediately instead of each waiting out API_TIMEOUT_MS. The owner
+// probes the backend once probeDue(); a probe that gets an answer half-opens
+// the circuit and the next real request closes it (or opens it again).
+// Probe delays back off from BREAKER_PROBE_BASE to BREAKER_PROBE_MAX with
+// jitter. Not thread-safe: ApiModule only touches it under its request lock.
+class CircuitBreaker {
+private:
+  CircuitState state;
+  uint8_t failures;           // Consecutive, while closed
+  uint8_t trips;              // Opens since the last close (backoff exponent)
+  bool trialInFlight;         // Half-open: the one request let through
+  unsigned long retryAt;      // Open: when the next probe is due
+  unsigned long openedAt;
+
+  // Statistics
+  uint32_t opened;
+  uint32_t rejected;          // Requests refused while open
+  uint32_t probes;
+  uint32_t lastOutageMs;      // Open to closed, last time
+
+  void trip(unsigned long now);
+
+public:
+  CircuitBreaker();
+
+  // Whether a request may be sent now. A true in half-open makes it the trial.
+  bool allow();
+  void recordSuccess(unsigned long now);
+  void recordFailure(unsigned long now);
+  void abandon() { trialInFlight = false; }   // Allowed request never sent
+
+  bool probeDue(unsigned long now) const {
+    return state == CIRCUIT_OPEN && (long)(now - retryAt) >= 0;
+  }
+  void probeAnswered();
+  void probeFailed(unsigned long now);
+  void forceOpen(unsigned long now);          // Known outage (e.g. WiFi gave up)
+
+  CircuitState getState() const { return state; }
+  uint32_t getOpened() const { return opened; }
+  uint32_t getRejected() const { return rejected; }
+  void report(JsonObject obj) const;
+  void printStatus(const char* name);
+};
+
+#endif // CIRCUIT_BREAKER_H
@@ -18,6 +18,7 @@
 #define PN532_MISO 12
 #define PN532_MOSI 13
 #define PN532_SS 27
+#define PN532_IRQ 34  // PN532 IRQ (active low, input-only pin, needs the board's pull-up); used when RFID_USE_IRQ is true
 
 // UART Communication to LED Matrix ESP32
 #define UART_TX 17
@@ -64,6 +65,12 @@
 
 #define HEARTBEAT_INTERVAL 30000  // 30 seconds
 #define COMMAND_POLL_INTERVAL 5000 // 5 seconds - poll server commands
+#define SYNC_IDLE_INTERVAL HEARTBEAT_INTERVAL  // Poll period once the device is idle
+#define SYNC_IDLE_AFTER 60000  // Idle: no tap for a minute and not registering
+// Safety-net poll while commands arrive over WebSocket. The backend pushes a
+// change at once only from the isolate that made it; its socket re-checks
+// for others every 60 s, so this poll bounds the delay at 30 s instead.
+#define SYNC_PUSH_INTERVAL SYNC_IDLE_INTERVAL
 #define REGISTRATION_MODE_TIMEOUT 120000  // 2 minutes
 #define KEY_INPUT_TIMEOUT 5000  // 5 seconds
 #define TEST_MODE_TIMEOUT 10000  // 10 seconds
@@ -73,6 +80,22 @@
 #define HEARTBEAT_INTERVAL_MS HEARTBEAT_INTERVAL
 #define MENU_REMINDER_INTERVAL 30000  // 30 seconds
 
+// Cooperative scheduler (main loop task periods)
+#define MAX_SCHEDULED_TASKS 16
+#define RFID_POLL_INTERVAL 20  // PN532 poll period
+#define KEYPAD_POLL_INTERVAL 10  // Keypad matrix scan period
+#define WS_LOOP_INTERVAL 10  // WebSocket service period
+#define NETWORK_CHECK_INTERVAL 1000  // WiFi link check period
+#define SERIAL_POLL_INTERVAL 50  // Serial command check period
+#define TIMEOUT_CHECK_INTERVAL 250  // Keypad/registration timeout checks
+#define DISPLAY_EFFECT_INTERVAL 50  // Non-blocking display animations
+#define REGISTRATION_EXIT_DELAY 2000  // Keep "REGISTERED" visible before leaving reg mode
+#define HEARTBEAT_BLINK_MS 100  // Heartbeat indicator on-time
+#define SCHEDULER_MAX_IDLE_SLICE 5  // Max ms the loop yields when nothing is due
+
+// Scan latency histograms (bucket bounds live in LatencyStats.cpp)
+#define LATENCY_BUCKET_COUNT 16
+
 // =======================
 // API Configuration
 // =======================
@@ -123,10 +146,56 @@
 #define API_TIMEOUT_MS 5000
 #define API_RETRY_ATTEMPTS 3
 #define MAX_CONSECUTIVE_FAILURES 5
-
-#define WS_RECONNECT_INTERVAL 5000   // Reconnect every 5 seconds if disconnected
+#define API_RETRY_BASE_DELAY 1000    // First retry after 1s, doubling per attempt
+#define API_SCAN_QUEUE_SIZE 8        // Scans awaiting delivery or retry in ApiModule
+#define HTTP_KEEPALIVE_IDLE_MS 45000 // Reconnect rather than reuse a socket idle this long (heartbeats keep it warm)
+
+// Circuit breakers per endpoint class (scan, control, bulk) in ApiModule
+#define API_HEALTH_ENDPOINT "/health"   // Cheap probe while a circuit is open
+#define BREAKER_FAILURE_THRESHOLD MAX_CONSECUTIVE_FAILURES  // Consecutive failures that open a circuit
+#define BREAKER_PROBE_BASE 2000      // First probe after ~2s open; doubles per failed probe (jittered)
+#define BREAKER_PROBE_MAX 15000      // Probe interval ceiling, so recovery is seen within seconds
+
+#define WS_RECONNECT_INTERVAL 5000   // First reconnect delay; doubles per failed attempt (jittered)
+#define WS_RECONNECT_MAX 120000      // Backoff ceiling
 #define WS_PING_INTERVAL 30000       // Send heartbeat every 30 seconds
+#define WS_HEARTBEAT_ACK_TIMEOUT 10000  // Unanswered heartbeat: the socket is dropped and reopened
+#define WS_FLAP_WINDOW 60000         // A connection lost sooner than this counts as a flap
+#define WS_SCAN_WINDOW 4             // Live scans awaiting their scan_result at once
+#define WS_SCAN_ACK_TIMEOUT 2000     // Unanswered this long: resend, then fall back to HTTP
+#define WS_SCAN_RETRANSMITS 1        // Resends over the socket before a scan moves to HTTP
+
+// Live scan transport choice (TransportSelector)
+#define TRANSPORT_EWMA_SHIFT 3       // RTT/loss smoothing weight 1/8
+#define TRANSPORT_MIN_SAMPLES 3      // Per path before costs are compared (until then: WebSocket)
+#define TRANSPORT_SWITCH_MARGIN_PCT 25  // The other path must be this much cheaper to switch
+#define TRANSPORT_MIN_DWELL 15000    // Time on a path before a measured switch back
 #define WS_ENABLED true              // Enable WebSocket (set false to use HTTP only)
+#define WS_BINARY_FRAMES false       // MessagePack frames with integer keys (backend must support them)
+
+// =======================
+// Network Task (core 0)
+// =======================
+
+// All HTTP/WebSocket I/O runs in a dedicated FreeRTOS task so a slow backend
+// never stalls RFID, keypad or display work in loop() (core 1).
+#define NET_TASK_CORE 0
+#define NET_TASK_PRIORITY 1
+#define NET_TASK_STACK_SIZE 12288
+#define NET_REQUEST_QUEUE_SIZE 8  // UI -> network scan requests
+#define NET_CONTROL_QUEUE_SIZE 4  // UI -> network, each other priority class
+#define NET_EVENT_QUEUE_SIZE 8  // Network -> UI results
+#define NET_EVENT_POLL_INTERVAL 10  // UI drains network events every 10ms
+#define MAX_SERVER_COMMANDS 4  // Commands kept from one poll response
+#define SYNC_TELEMETRY_MAX 8  // Status reports held for the next sync
+#define SYNC_REPROBE_INTERVAL 600000  // Backend without /sync: try it again this often (ms)
+
+// Requests are served strictly by priority class (live scan > registration >
+// commands > heartbeat > telemetry). One still queued past its class
+// deadline is dropped; taps and keypad actions have none and always go out.
+#define NET_DEADLINE_COMMANDS COMMAND_POLL_INTERVAL  // The next poll supersedes it
+#define NET_DEADLINE_HEARTBEAT HEARTBEAT_INTERVAL   // Likewise the next heartbeat
+#define NET_DEADLINE_TELEMETRY 60000
 
 // =======================
 // Network Configuration
@@ -140,7 +209,18 @@
 // =======================
 
 #define RFID_RETRY_ATTEMPTS 3
-#define RFID_SCAN_TIMEOUT 50  // milliseconds
+#define RFID_RETRY_DELAY 100  // Backoff between PN532 init attempts (ms)
+#define RFID_INIT_TIMEOUT 3000  // Upper bound for the boot-time init sequence (ms)
+#define RFID_USE_IRQ false  // true: wait on PN532_IRQ instead of polling the SPI status byte
+#define RFID_REARM_INTERVAL 5000  // Re-arm detection if no card shows up (recovers from chip resets)
+#define RFID_MAX_UID_LENGTH 10  // ISO14443A triple-size UID
+
+// PN532 SPI driver timing
+#define PN532_SPI_CLOCK 1000000  // 1 MHz
+#define PN532_WAKE_MS 2  // SS held low to wake the chip
+#define PN532_ACK_TIMEOUT 20  // ms
+#define PN532_COMMAND_TIMEOUT 100  // ms, response wait for configuration commands
+#define PN532_FRAME_MAX 64  // Largest frame body (TFI + data) handled
 
 // =======================
 // Error Codes
@@ -208,8 +288,35 @@
 // =======================
 
 #define MIN_SCAN_INTERVAL 1000  // minimum 1 second between scans
-#define MAX_TAG_ID_LENGTH 16
+#define MAX_TAG_ID_LENGTH 20  // Hex characters; a full 10-byte UID
 #define DUPLICATE_SCAN_WINDOW 3000  // 3 seconds
+#define SCAN_DEDUP_TABLE_SIZE 32  // Recent-tag slots (power of two)
+#define SCAN_DEDUP_MAX_PROBE 8  // Slots examined per lookup
+#define SCAN_CACHE_SIZE 16  // Recent server verdicts kept for repeat taps
+#define SCAN_CACHE_TTL 600000  // Cached verdicts older than 10 minutes are not shown
+
+// =======================
+// Offline Scan Journal
+// =======================
+
+#define SCAN_JOURNAL_DIR "/littlefs"  // LittleFS VFS mount point
+#define SCAN_JOURNAL_MAX_RECORDS 1024  // 32 bytes each
+#define SCAN_JOURNAL_GROUP_SIZE 8  // Records per group commit
+#define SCAN_JOURNAL_COMMIT_INTERVAL 1000  // Commit a partial group after this long (ms)
+#define SCAN_JOURNAL_RETRY_DELAY 30000  // Wait after a failed batch upload (ms)
+#define SCAN_BATCH_MAX_RECORDS 16  // Records per batch upload
+#define SCAN_BATCH_MAX_BYTES 1536  // Request body cap (a full batch of 10-byte UIDs fits)
+#define SCAN_BATCH_MIN_INTERVAL 250  // Minimum gap between batches (ms)
+#define SCAN_BATCH_RTT_FACTOR 4  // Gap between batches in round trips (link <= 1/4 busy)
+
+// =======================
+// Offline Tag Filter
+// =======================
+
+#define TAG_FILTER_DIR "/littlefs"  // Same LittleFS mount as the journal
+#define TAG_FILTER_REFRESH_INTERVAL 900000  // Check for a new filter every 15 min
+#define TAG_FILTER_RETRY_DELAY 60000  // After a failed download (ms)
+#define TAG_FILTER_MAX_AGE 1800000  // Older (or unconfirmed since boot): no "not listed" verdict offline
 
 // =======================
 // Queue System Configuration
@@ -236,7 +343,7 @@
 
 #define FEATURE_OFFLINE_MODE true
 #define FEATURE_AUTO_RECONNECT true
-#define FEATURE_LOCAL_STORAGE false  // SPIFFS/LittleFS not implemented yet
+#define FEATURE_LOCAL_STORAGE true  // LittleFS offline scan journal
 #define FEATURE_OTA_UPDATE false  // OTA not implemented yet
 #define FEATURE_KEYPAD_MENU true
 #define FEATURE_TEST_MODE true
@@ -286,6 +393,8 @@ struct SystemStatus {
   int scanCount;
   int errorCount;
   unsigned long lastHeartbeat;
+  unsigned long loopIdleMs;  // Scheduler idle budget left in the last loop cycle
+  uint32_t duplicateScans;   // Taps suppressed by the duplicate-scan window
 };
 
 // =======================
@@ -321,6 +430,11 @@ extern unsigned long lastScanTime;
 #define LOG_WARNING(msg) if(CURRENT_LOG_LEVEL <= LOG_LEVEL_WARNING) { Serial.print("[WARNING] "); Serial.println(msg); }
 #define LOG_ERROR(msg) if(CURRENT_LOG_LEVEL <= LOG_LEVEL_ERROR) { Serial.print("[ERROR] "); Serial.println(msg); }
 
+// printf-style variants for hot paths (no String concatenation); include the trailing \n
+#define LOG_INFOF(...) if(CURRENT_LOG_LEVEL <= LOG_LEVEL_INFO) { Serial.print("[INFO] "); Serial.printf(__VA_ARGS__); }
+#define LOG_WARNINGF(...) if(CURRENT_LOG_LEVEL <= LOG_LEVEL_WARNING) { Serial.print("[WARNING] "); Serial.printf(__VA_ARGS__); }
+#define LOG_ERRORF(...) if(CURRENT_LOG_LEVEL <= LOG_LEVEL_ERROR) { Serial.print("[ERROR] "); Serial.printf(__VA_ARGS__); }
+
 // Memory check macro
 #define CHECK_MEMORY() (ESP.getFreeHeap() > LOW_MEMORY_THRESHOLD)
 
@@ -0,0 +1,36 @@
+#ifndef DEVICE_WIRE_H
+#define DEVICE_WIRE_H
+
+#include <stdint.h>
+
+// Binary frame layout (WS_BINARY_FRAMES): one map, integer keys. Must match
+// backend-workers/src/lib/deviceWire.ts; tests/wire_vectors.txt holds frames
+// both sides are checked against.
+enum WireAction : uint8_t {
+  WIRE_HEARTBEAT = 1,
+  WIRE_HEARTBEAT_ACK,
+  WIRE_SCAN,
+  WIRE_SCAN_RESULT,
+  WIRE_COMMAND_ACK,
+  WIRE_CONFIG,
+  WIRE_COMMANDS      // Mode flags and pending tag; the command list is rebuilt
+};
+
+enum WireKey : uint8_t {
+  WIRE_KEY_ACTION,
+  WIRE_KEY_TIMESTAMP,
+  WIRE_KEY_SEQ,
+  WIRE_KEY_TAG_ID,
+  WIRE_KEY_LOCATION,
+  WIRE_KEY_SUCCESS,
+  WIRE_KEY_REGISTERED,
+  WIRE_KEY_USER_NAME,
+  WIRE_KEY_USER_ROLE,
+  WIRE_KEY_ERROR,
+  WIRE_KEY_ID,
+  WIRE_KEY_VERSION,
+  WIRE_KEY_REGISTRATION_MODE,
+  WIRE_KEY_SCAN_MODE
+};
+
+#endif // DEVICE_WIRE_H
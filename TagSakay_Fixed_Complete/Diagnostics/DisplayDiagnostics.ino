@@ -23,6 +23,10 @@ const char* WIFI_PASSWORD = "PASSWORD";
 const char* API_BASE_URL = "https://api.tagsakay.com";
 const char* API_KEY = "API_KEY";  // Set your device API key here
 
+// Every API call shares this client: with reuse on, requests to the same
+// host ride one kept-alive connection instead of a fresh handshake each
+HTTPClient apiHttp;
+
 // System state
 bool wifiConnected = false;
 bool rfidInitialized = false;
@@ -162,6 +166,7 @@ void pollCommands();
 void setup() {
   Serial.begin(115200);
   delay(500);
+  apiHttp.setReuse(true);
   printIntro();
 
   tft.init();
@@ -1070,7 +1075,7 @@ void handleRFIDScanning() {
   else if (currentStage == STAGE_FULL_SYSTEM && wifiConnected) {
         Serial.println("[FULL SYSTEM] Sending scan via HTTP...");
         
-        HTTPClient http;
+        HTTPClient& http = apiHttp;
         String url = "http://" + String(API_HOST) + ":" + String(API_PORT) + "/api/rfid/scan";
         
         http.begin(url);
@@ -1113,7 +1118,7 @@ bool testAPIHealth() {
     return false;
   }
   
-  HTTPClient http;
+  HTTPClient& http = apiHttp;
   String url = String(API_BASE_URL) + "/health";
   
   Serial.print("[API] Testing health endpoint: ");
@@ -1155,7 +1160,7 @@ bool testAPIHeartbeat() {
     return false;
   }
   
-  HTTPClient http;
+  HTTPClient& http = apiHttp;
   String url = String(API_BASE_URL) + "/api/devices/" + deviceMac + "/heartbeat";
   
   Serial.print("[API] Testing heartbeat endpoint: ");
@@ -1273,7 +1278,7 @@ bool sendRFIDScanToAPI(const String& tagId) {
     return false;
   }
   
-  HTTPClient http;
+  HTTPClient& http = apiHttp;
   String url = String(API_BASE_URL) + "/api/rfid/scan";
   
   Serial.print("[API] Sending RFID scan to: ");
@@ -1437,7 +1442,7 @@ void initializePolling() {
 void pollCommands() {
   if (!wifiConnected || deviceMac.isEmpty()) return;
   
-  HTTPClient http;
+  HTTPClient& http = apiHttp;
   String url = String(API_BASE_URL) + "/api/devices/" + deviceMac + "/commands";
   
   http.begin(url);
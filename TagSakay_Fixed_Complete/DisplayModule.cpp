@@ -153,45 +153,58 @@ void updateConnectionStatus(const String& wifi, const String& time, const String
   }
 }
 
-void updateScanSection(const String& tagId, const String& status, const String& userInfo, uint16_t color) {
-  // Always clear the scan section area first
-  tft.fillRect(LEFT_MARGIN, SCAN_SECTION_Y + 15, getContentWidth(), SCAN_SECTION_HEIGHT - 20, TFT_BLACK);
-  
-  // Only draw content if tagId is provided
-  if (tagId.length() > 0) {
-    tft.setTextSize(1);
-    tft.setTextColor(TFT_CYAN, TFT_BLACK);
-    tft.setCursor(LEFT_MARGIN, SCAN_SECTION_Y + 15);
-    tft.print("Tag: ");
-    tft.println(tagId.substring(0, 20));
+namespace {
+  void drawScanSection(const char* tagId, const String& status, const String& userInfo, uint16_t color) {
+    // Always clear the scan section area first
+    tft.fillRect(LEFT_MARGIN, SCAN_SECTION_Y + 15, getContentWidth(), SCAN_SECTION_HEIGHT - 20, TFT_BLACK);
+  
+    // Only draw content if tagId is provided
+    if (tagId[0] != '\0') {
+      char shown[21];
+      strlcpy(shown, tagId, sizeof(shown));
+      tft.setTextSize(1);
+      tft.setTextColor(TFT_CYAN, TFT_BLACK);
+      tft.setCursor(LEFT_MARGIN, SCAN_SECTION_Y + 15);
+      tft.print("Tag: ");
+      tft.println(shown);
     
-    tft.setTextSize(2);
-    tft.setTextColor(color, TFT_BLACK);
-    tft.setCursor(LEFT_MARGIN, SCAN_SECTION_Y + 30);
-    tft.println(status.substring(0, 20));
+      tft.setTextSize(2);
+      tft.setTextColor(color, TFT_BLACK);
+      tft.setCursor(LEFT_MARGIN, SCAN_SECTION_Y + 30);
+      tft.println(status.substring(0, 20));
     
-    if (userInfo.length() > 0) {
-      tft.setTextSize(1);
-      tft.setTextColor(TFT_WHITE, TFT_BLACK);
-      tft.setCursor(LEFT_MARGIN, SCAN_SECTION_Y + 55);
-      tft.println(userInfo.substring(0, 36));
-    }
+      if (userInfo.length() > 0) {
+        tft.setTextSize(1);
+        tft.setTextColor(TFT_WHITE, TFT_BLACK);
+        tft.setCursor(LEFT_MARGIN, SCAN_SECTION_Y + 55);
+        tft.println(userInfo.substring(0, 36));
+      }
     
-    String timestamp = getCurrentTimestamp();
-    if (timestamp.length() > 0) {
+      String timestamp = getCurrentTimestamp();
+      if (timestamp.length() > 0) {
+        tft.setTextSize(1);
+        tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
+        tft.setCursor(LEFT_MARGIN, SCAN_SECTION_Y + 70);
+        tft.println(timestamp.substring(11, 19));
+      }
+    } else {
       tft.setTextSize(1);
       tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
-      tft.setCursor(LEFT_MARGIN, SCAN_SECTION_Y + 70);
-      tft.println(timestamp.substring(11, 19));
+      tft.setCursor(LEFT_MARGIN, SCAN_SECTION_Y + 35);
+      tft.println("Waiting for RFID card...");
     }
-  } else {
-    tft.setTextSize(1);
-    tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
-    tft.setCursor(LEFT_MARGIN, SCAN_SECTION_Y + 35);
-    tft.println("Waiting for RFID card...");
   }
 }
 
+void updateScanSection(const String& tagId, const String& status, const String& userInfo, uint16_t color) {
+  drawScanSection(tagId.c_str(), status, userInfo, color);
+}
+
+void updateScanSection(const TagUid& tag, const String& status, const String& userInfo, uint16_t color) {
+  TagIdText tagId = tag.toText();
+  drawScanSection(tagId.c_str(), status, userInfo, color);
+}
+
 void updateFooter(const String& msg) {
   tft.fillRect(0, FOOTER_Y + 2, SCREEN_WIDTH, FOOTER_HEIGHT - 2, TFT_BLACK);
   
@@ -295,18 +308,54 @@ void indicateRegistrationTagDetected() {
   Serial.println("✓ Registration tag detected");
 }
 
-void blinkError(int times) {
-  for (int i = 0; i < times; i++) {
-    updateStatusSection("ERROR " + String(i + 1) + "/" + String(times), TFT_RED);
-    delay(500);
-    updateStatusSection("", TFT_BLACK);
-    delay(200);
+// Error blink sequence state (advanced by serviceDisplayEffects)
+namespace {
+  int blinkTotal = 0;
+  int blinkIndex = 0;
+  bool blinkLit = false;
+  unsigned long blinkNextStep = 0;
+  String blinkFinalStatus;
+}
+
+void blinkError(int times, const String& finalStatus) {
+  if (times <= 0) {
+    return;
   }
-  updateStatusSection("SYSTEM READY", TFT_GREEN);
-  updateFooter("Error sequence completed");
+
+  blinkTotal = times;
+  blinkIndex = 0;
+  blinkLit = true;
+  blinkFinalStatus = finalStatus;
+  updateStatusSection("ERROR 1/" + String(times), TFT_RED);
+  blinkNextStep = millis() + 500;
   Serial.println("✗ Error occurred (" + String(times) + " times)");
 }
 
+void serviceDisplayEffects() {
+  if (blinkTotal == 0 || (long)(millis() - blinkNextStep) < 0) {
+    return;
+  }
+
+  if (blinkLit) {
+    updateStatusSection("", TFT_BLACK);
+    blinkLit = false;
+    blinkIndex++;
+    blinkNextStep = millis() + 200;
+  } else if (blinkIndex < blinkTotal) {
+    updateStatusSection("ERROR " + String(blinkIndex + 1) + "/" + String(blinkTotal), TFT_RED);
+    blinkLit = true;
+    blinkNextStep = millis() + 500;
+  } else {
+    blinkTotal = 0;
+    if (blinkFinalStatus.length() > 0) {
+      updateStatusSection(blinkFinalStatus, TFT_RED);
+    } else {
+      updateStatusSection("SYSTEM READY", TFT_GREEN);
+      updateFooter("Error sequence completed");
+    }
+  }
+}
+
 void displayKeypadPrompt(const String& prompt, const String& buffer) {
   tft.fillRect(LEFT_MARGIN, SCAN_SECTION_Y + 15, getContentWidth(), SCAN_SECTION_HEIGHT - 20, TFT_BLACK);
   
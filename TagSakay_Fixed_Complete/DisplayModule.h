@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <TFT_eSPI.h>
 #include "Config.h"
+#include "TagUid.h"
 
 // TFT Display object
 extern TFT_eSPI tft;
@@ -18,6 +19,7 @@ void drawSectionBorders();
 void updateStatusSection(const String& msg, uint16_t color);
 void updateConnectionStatus(const String& wifi, const String& time, const String& device);
 void updateScanSection(const String& tagId, const String& status, const String& userInfo, uint16_t color);
+void updateScanSection(const TagUid& tag, const String& status, const String& userInfo, uint16_t color);
 void updateFooter(const String& msg);
 void showHeartbeat(bool active);
 
@@ -32,7 +34,8 @@ void indicateUnregisteredTag();
 void indicateRegistrationMode();
 void indicateReady();
 void indicateRegistrationTagDetected();
-void blinkError(int times);
+void blinkError(int times, const String& finalStatus = "");
+void serviceDisplayEffects();  // Advances non-blocking effects such as blinkError
 
 // Keypad display
 void displayKeypadPrompt(const String& prompt, const String& buffer);
@@ -0,0 +1,161 @@
+#include "HttpBodyStream.h"
+
+HttpBodyStream::HttpBodyStream()
+  : socket(nullptr), mode(BODY_LENGTH), state(STATE_DONE), remaining(0), lineLength(0),
+    consumed(0) {}
+
+void HttpBodyStream::begin(WiFiClient& client, int contentLength, bool chunked) {
+  socket = &client;
+  consumed = 0;
+  lineLength = 0;
+  remaining = 0;
+
+  if (chunked) {
+    mode = BODY_CHUNKED;
+    state = STATE_CHUNK_SIZE;
+  } else if (contentLength >= 0) {
+    mode = BODY_LENGTH;
+    remaining = (uint32_t)contentLength;
+    state = remaining > 0 ? STATE_DATA : STATE_DONE;
+  } else {
+    mode = BODY_UNTIL_CLOSE;
+    state = STATE_DATA;
+  }
+}
+
+int HttpBodyStream::available() {
+  if (!socket || state != STATE_DATA) {
+    return 0;
+  }
+  int ready = socket->available();
+  if (mode != BODY_UNTIL_CLOSE && (uint32_t)ready > remaining) {
+    ready = (int)remaining;
+  }
+  return ready;
+}
+
+int HttpBodyStream::peek() {
+  if (!socket || state != STATE_DATA) {
+    return -1;
+  }
+  return socket->peek();
+}
+
+int HttpBodyStream::read() {
+  if (!socket) {
+    return -1;
+  }
+
+  for (;;) {
+    if (state == STATE_DONE || state == STATE_ERROR) {
+      return -1;
+    }
+
+    int c = socket->read();
+    if (c < 0) {
+      if (mode == BODY_UNTIL_CLOSE && !socket->connected()) {
+        state = STATE_DONE;
+      }
+      return -1;  // Nothing yet; timedRead() waits and asks again
+    }
+
+    if (state != STATE_DATA) {
+      frame((char)c);
+      continue;
+    }
+
+    consumed++;
+    if (mode != BODY_UNTIL_CLOSE && --remaining == 0) {
+      endOfChunkData();
+    }
+    return c;
+  }
+}
+
+size_t HttpBodyStream::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  unsigned long lastByte = millis();
+  while (count < length) {
+    int c = read();
+    if (c >= 0) {
+      buffer[count++] = (char)c;
+      lastByte = millis();
+      continue;
+    }
+    if (state == STATE_DONE || state == STATE_ERROR || millis() - lastByte >= _timeout) {
+      break;
+    }
+    delay(1);  // Nothing yet: let the idle task run while the server is slow
+  }
+  return count;
+}
+
+void HttpBodyStream::endOfChunkData() {
+  state = mode == BODY_CHUNKED ? STATE_DATA_END : STATE_DONE;
+}
+
+// Chunk framing: "<hex>[;ext]\r\n<data>\r\n" ... "0\r\n[trailers]\r\n"
+void HttpBodyStream::frame(char c) {
+  switch (state) {
+    case STATE_CHUNK_SIZE:
+      if (isxdigit((unsigned char)c)) {
+        if (remaining > 0x0FFFFFFF) {
+          state = STATE_ERROR;
+          break;
+        }
+        remaining = remaining * 16 + (isdigit((unsigned char)c) ? c - '0' : (tolower(c) - 'a' + 10));
+      } else if (c == ';' || c == ' ' || c == '\t') {
+        state = STATE_CHUNK_EXT;
+      } else if (c == '\n') {
+        state = remaining > 0 ? STATE_DATA : STATE_TRAILER;
+        lineLength = 0;
+      } else if (c != '\r') {
+        state = STATE_ERROR;
+      }
+      break;
+
+    case STATE_CHUNK_EXT:
+      if (c == '\n') {
+        state = remaining > 0 ? STATE_DATA : STATE_TRAILER;
+        lineLength = 0;
+      }
+      break;
+
+    case STATE_DATA_END:
+      if (c == '\n') {
+        state = STATE_CHUNK_SIZE;
+        remaining = 0;
+      } else if (c != '\r') {
+        state = STATE_ERROR;
+      }
+      break;
+
+    case STATE_TRAILER:
+      if (c == '\n') {
+        if (lineLength == 0) {
+          state = STATE_DONE;
+        }
+        lineLength = 0;
+      } else if (c != '\r' && lineLength < 255) {
+        lineLength++;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+bool HttpBodyStream::finish(unsigned long timeoutMs) {
+  unsigned long started = millis();
+  while (state != STATE_DONE && state != STATE_ERROR) {
+    if (read() >= 0) {
+      continue;
+    }
+    if (state == STATE_DONE || millis() - started >= timeoutMs) {
+      break;
+    }
+    delay(1);
+  }
+  return state == STATE_DONE && mode != BODY_UNTIL_CLOSE;
+}
@@ -0,0 +1,67 @@
+#ifndef HTTP_BODY_STREAM_H
+#define HTTP_BODY_STREAM_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+// Response body read straight off the socket, for deserializeJson() to parse
+// as it arrives instead of buffering it whole with HTTPClient::getString().
+// Yields body bytes only: stops at Content-Length, undoes chunked transfer
+// encoding, or (no length, not chunked) reads until the server closes.
+//
+// read() never blocks; readBytes() waits up to setTimeout() for more. It is
+// overridden because the core's timedRead() spins on read() without
+// yielding: on the network task a slow server would starve IDLE0 and trip
+// the task watchdog. ArduinoJson pulls every byte through readBytes().
+// The parser stops at the end of the JSON value, so finish() skips whatever
+// is left: on a kept-alive socket the next response must start clean.
+class HttpBodyStream : public Stream {
+private:
+  enum Mode : uint8_t {
+    BODY_LENGTH,        // Content-Length
+    BODY_CHUNKED,       // Transfer-Encoding: chunked
+    BODY_UNTIL_CLOSE    // Neither: the connection cannot be reused
+  };
+
+  enum State : uint8_t {
+    STATE_DATA,         // Body bytes; remaining left in this chunk (or body)
+    STATE_CHUNK_SIZE,   // Hex size digits
+    STATE_CHUNK_EXT,    // ";ext" up to the end of the size line
+    STATE_DATA_END,     // CRLF after a chunk's data
+    STATE_TRAILER,      // Trailer lines after the last chunk, up to an empty one
+    STATE_DONE,
+    STATE_ERROR         // Malformed framing
+  };
+
+  WiFiClient* socket;
+  Mode mode;
+  State state;
+  uint32_t remaining;
+  uint8_t lineLength;   // Trailer line being skipped (CR not counted)
+  size_t consumed;      // Body bytes delivered or skipped
+
+  void frame(char c);
+  void endOfChunkData();
+
+public:
+  HttpBodyStream();
+
+  // contentLength as HTTPClient::getSize() reports it (-1: not given)
+  void begin(WiFiClient& client, int contentLength, bool chunked);
+
+  // Skips the rest of the body (up to timeoutMs). True when the socket is
+  // left at the start of the next response and may be reused.
+  bool finish(unsigned long timeoutMs);
+
+  size_t getConsumed() const { return consumed; }
+
+  using Stream::readBytes;
+  size_t readBytes(char* buffer, size_t length) override;
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t) override { return 0; }
+};
+
+#endif // HTTP_BODY_STREAM_H
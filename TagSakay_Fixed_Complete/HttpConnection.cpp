@@ -0,0 +1,126 @@
+#include "HttpConnection.h"
+
+HttpConnection::HttpConnection()
+  : secure(false), port(80), lastUsed(0), handshakes(0), reused(0), staleRetries(0),
+    lastHandshakeMs(0), maxHandshakeMs(0), totalHandshakeMs(0), bodies(0), maxBodyBytes(0),
+    totalBodyUs(0), maxBodyUs(0), undrained(0) {}
+
+bool HttpConnection::begin(const String& baseUrl) {
+  int schemeEnd = baseUrl.indexOf("://");
+  if (schemeEnd < 0) {
+    return false;
+  }
+
+  secure = baseUrl.substring(0, schemeEnd).equalsIgnoreCase("https");
+  String authority = baseUrl.substring(schemeEnd + 3);
+  int pathStart = authority.indexOf('/');
+  if (pathStart >= 0) {
+    authority = authority.substring(0, pathStart);
+  }
+
+  int colon = authority.indexOf(':');
+  if (colon >= 0) {
+    host = authority.substring(0, colon);
+    port = (uint16_t)authority.substring(colon + 1).toInt();
+  } else {
+    host = authority;
+    port = secure ? 443 : 80;
+  }
+
+  if (secure) {
+    // Same trust as HTTPClient::begin(url) without a CA, which this replaces
+    secureClient.setInsecure();
+    secureClient.setHandshakeTimeout(API_TIMEOUT_MS / 1000);
+  }
+
+  http.setReuse(true);
+
+  // HTTPClient keeps only the response headers it was told to collect;
+  // bodies are read past it, so the framing header is needed too
+  static const char* collected[] = { "ETag", "Transfer-Encoding" };
+  http.collectHeaders(collected, 2);
+  return host.length() > 0;
+}
+
+bool HttpConnection::open(const String& url, bool& wasReused) {
+  WiFiClient& client = transport();
+
+  // Idle keep-alives are closed by the server sooner or later; reconnecting
+  // up front is cheaper than finding out on a failed send
+  if (client.connected() && millis() - lastUsed > HTTP_KEEPALIVE_IDLE_MS) {
+    close();
+  }
+
+  wasReused = client.connected();
+  if (!wasReused) {
+    // connect() with a timeout is not virtual: call it on the concrete client
+    unsigned long started = millis();
+    bool ok = secure ? secureClient.connect(host.c_str(), port, API_TIMEOUT_MS)
+                     : plainClient.connect(host.c_str(), port, API_TIMEOUT_MS);
+    if (!ok) {
+      return false;
+    }
+    lastHandshakeMs = millis() - started;
+    totalHandshakeMs += lastHandshakeMs;
+    if (lastHandshakeMs > maxHandshakeMs) {
+      maxHandshakeMs = lastHandshakeMs;
+    }
+    handshakes++;
+    LOG_DEBUG("HTTP connection opened in " + String(lastHandshakeMs) + "ms");
+  } else {
+    reused++;
+  }
+
+  // HTTPClient sees the connected client and sends on it as-is
+  return http.begin(client, url);
+}
+
+void HttpConnection::release() {
+  http.end();  // With setReuse(true) this keeps the socket open
+  lastUsed = millis();
+}
+
+void HttpConnection::close() {
+  http.end();
+  transport().stop();
+}
+
+void HttpConnection::noteBody(size_t bytes, uint32_t elapsedUs, bool drained) {
+  bodies++;
+  totalBodyUs += elapsedUs;
+  if (bytes > maxBodyBytes) {
+    maxBodyBytes = bytes;
+  }
+  if (elapsedUs > maxBodyUs) {
+    maxBodyUs = elapsedUs;
+  }
+  if (!drained) {
+    undrained++;
+  }
+}
+
+void HttpConnection::report(JsonObject obj) const {
+  obj["handshakes"] = handshakes;
+  obj["reused"] = reused;
+  obj["staleRetries"] = staleRetries;
+  obj["handshakeAvgMs"] = getAvgHandshakeMs();
+  obj["handshakeMaxMs"] = maxHandshakeMs;
+  obj["bodyMaxBytes"] = maxBodyBytes;
+  obj["bodyAvgUs"] = bodies ? totalBodyUs / bodies : 0;
+  obj["bodyMaxUs"] = maxBodyUs;
+  obj["undrained"] = undrained;
+}
+
+void HttpConnection::printStatus() {
+  Serial.printf("[HTTP] %s://%s:%u connected=%s handshakes=%lu reused=%lu stale=%lu "
+                "handshake last=%lums avg=%lums max=%lums\n",
+                secure ? "https" : "http", host.c_str(), port,
+                isConnected() ? "yes" : "no",
+                (unsigned long)handshakes, (unsigned long)reused, (unsigned long)staleRetries,
+                (unsigned long)lastHandshakeMs, (unsigned long)getAvgHandshakeMs(),
+                (unsigned long)maxHandshakeMs);
+  Serial.printf("[HTTP] bodies=%lu max=%luB read+parse avg=%luus max=%luus undrained=%lu\n",
+                (unsigned long)bodies, (unsigned long)maxBodyBytes,
+                (unsigned long)(bodies ? totalBodyUs / bodies : 0), (unsigned long)maxBodyUs,
+                (unsigned long)undrained);
+}
@@ -0,0 +1,73 @@
+#ifndef HTTP_CONNECTION_H
+#define HTTP_CONNECTION_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include "Config.h"
+
+// One kept-alive connection to the API host. HTTPClient::begin(url) builds
+// and tears down its own client on every request, so each call paid a TCP
+// (and for https, a TLS) handshake. Here the socket lives across requests:
+// open() connects only when the previous connection is gone or has sat idle
+// past HTTP_KEEPALIVE_IDLE_MS (servers drop idle keep-alives), and times
+// that handshake so the saving shows up in the stats.
+//
+// The Arduino WiFiClientSecure does not expose mbedTLS session tickets, so a
+// dropped connection costs a full TLS handshake; keeping the one connection
+// warm is what avoids them. Not thread-safe: ApiModule serializes every
+// request on it behind its request lock.
+class HttpConnection {
+private:
+  WiFiClient plainClient;
+  WiFiClientSecure secureClient;
+  HTTPClient http;
+  bool secure;
+  String host;
+  uint16_t port;
+  unsigned long lastUsed;
+
+  // Statistics
+  uint32_t handshakes;        // New connections opened
+  uint32_t reused;            // Requests sent on an existing connection
+  uint32_t staleRetries;      // Reused sockets found dead and reopened
+  uint32_t lastHandshakeMs;
+  uint32_t maxHandshakeMs;
+  uint32_t totalHandshakeMs;
+  uint32_t bodies;            // Response bodies parsed off the socket
+  uint32_t maxBodyBytes;
+  uint32_t totalBodyUs;       // Read and parse, together
+  uint32_t maxBodyUs;
+  uint32_t undrained;         // Bodies not read to the end (socket closed after)
+
+  WiFiClient& transport() { return secure ? (WiFiClient&)secureClient : plainClient; }
+
+public:
+  HttpConnection();
+
+  // Parses scheme, host and port from the API base URL
+  bool begin(const String& baseUrl);
+
+  // Connects if needed and prepares a request; wasReused tells whether the
+  // request rides an existing connection (only those may be retried stale)
+  bool open(const String& url, bool& wasReused);
+  HTTPClient& client() { return http; }
+  WiFiClient& socket() { return transport(); }  // Response body after the headers
+  void release();             // Request done; the socket stays open
+  void close();               // Drop the socket (stale or on error)
+  void noteStaleRetry() { staleRetries++; }
+  void noteBody(size_t bytes, uint32_t elapsedUs, bool drained);
+
+  bool isConnected() { return transport().connected(); }
+  uint32_t getHandshakes() const { return handshakes; }
+  uint32_t getReused() const { return reused; }
+  uint32_t getLastHandshakeMs() const { return lastHandshakeMs; }
+  uint32_t getAvgHandshakeMs() const { return handshakes ? totalHandshakeMs / handshakes : 0; }
+
+  void report(JsonObject obj) const;
+  void printStatus();
+};
+
+#endif // HTTP_CONNECTION_H
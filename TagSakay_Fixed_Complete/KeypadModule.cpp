@@ -1,6 +1,7 @@
 #include "KeypadModule.h"
 #include "DisplayModule.h"
 #include "NetworkModule.h"
+#include "ApiModule.h"
 #include "UARTModule.h"
 
 // Keypad pin configuration
@@ -58,7 +59,17 @@ void processKeypadKey(char key) {
       Serial.print("Processing keypad input: ");
       Serial.println(keypadBuffer);
 
-      processQueueOverride(keypadBuffer);
+      NetRequest request;
+      memset(&request, 0, sizeof(request));
+      request.type = NET_REQ_QUEUE_OVERRIDE;
+      request.queueNumber = keypadBuffer.toInt();
+      if (networkTask.post(request)) {
+        updateStatusSection("OVERRIDE...", TFT_YELLOW);
+        updateFooter("Sending queue override");
+      } else {
+        updateStatusSection("NET BUSY", TFT_RED);
+        updateFooter("Queue override not sent");
+      }
       clearKeypadInput();
     }
   } else if (key == '*') {
@@ -79,47 +90,35 @@ void processKeypadKey(char key) {
 }
 
 void handleKeypadMenuSelection(char key) {
+  NetRequest request;
+  memset(&request, 0, sizeof(request));
+
   switch (key) {
     case '1':
       Serial.println("Menu: Send heartbeat");
-      sendHeartbeat();
+      networkTask.post(makeHeartbeatRequest(true));
       showKeypadMenu(false);
       break;
 
     case '2':
-      Serial.println("Menu: Enable registration mode");
-      if (updateDeviceMode(true, false)) {
-        indicateRegistrationMode();
-        updateScanSection("", "Waiting for tag", expectedRegistrationTagId, TFT_MAGENTA);
-        sendToLEDMatrix("REG", "WAITING", expectedRegistrationTagId.substring(0, 8));
-      } else {
-        updateStatusSection("REG MODE FAIL", TFT_RED);
-        updateFooter("Unable to enable registration mode");
-      }
-      showKeypadMenu(false);
-      break;
-
     case '3':
-      Serial.println("Menu: Disable registration mode");
-      if (updateDeviceMode(false, true)) {
-        updateStatusSection("REG MODE OFF", TFT_GREEN);
-        updateScanSection("", "", "", TFT_WHITE);
-        updateFooter("Registration mode disabled");
-        sendToLEDMatrix("REG", "OFF", "");
-      } else {
-        updateStatusSection("REG MODE FAIL", TFT_RED);
-        updateFooter("Unable to disable registration mode");
+      Serial.println(key == '2' ? "Menu: Enable registration mode" : "Menu: Disable registration mode");
+      request.type = NET_REQ_SET_MODE;
+      request.mode.registrationMode = (key == '2');
+      request.mode.scanMode = (key == '3');
+      if (!networkTask.post(request)) {
+        updateStatusSection("NET BUSY", TFT_RED);
+        updateFooter("Mode change not sent");
       }
       showKeypadMenu(false);
       break;
 
     case '4':
       Serial.println("Menu: Sync device profile");
-      if (syncDeviceProfile()) {
-        updateScanSection("", "", "", TFT_WHITE);
-      } else {
-        updateStatusSection("SYNC FAILED", TFT_RED);
-        updateFooter("Unable to sync device profile");
+      request.type = NET_REQ_SYNC_PROFILE;
+      if (!networkTask.post(request)) {
+        updateStatusSection("NET BUSY", TFT_RED);
+        updateFooter("Profile sync not sent");
       }
       showKeypadMenu(false);
       break;
@@ -137,51 +136,64 @@ void handleKeypadMenuSelection(char key) {
   }
 }
 
-void processQueueOverride(const String& queueNumber) {
-  Serial.print("Processing queue override for number: ");
-  Serial.println(queueNumber);
-
-  HTTPClient http;
-  String url = String(serverConfig.baseUrl) + "/api/devices/" + deviceId + "/queue-override";
-
-  http.begin(url);
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("x-api-key", serverConfig.apiKey);
+// Results of menu requests, delivered by the network task
+void handleDeviceModeResult(const ProfileOutcome& outcome) {
+  if (!outcome.ok) {
+    updateStatusSection("REG MODE FAIL", TFT_RED);
+    updateFooter(outcome.requestedRegistration ? "Unable to enable registration mode"
+                                               : "Unable to disable registration mode");
+    return;
+  }
 
-  StaticJsonDocument<200> doc;
-  doc["queueNumber"] = queueNumber.toInt();
-  doc["reason"] = "Manual keypad override";
+  applyDeviceMode(outcome.profile);
 
-  String payload;
-  serializeJson(doc, payload);
+  if (outcome.requestedRegistration) {
+    indicateRegistrationMode();
+    updateScanSection("", "Waiting for tag", expectedRegistrationTagId, TFT_MAGENTA);
+    sendToLEDMatrix("REG", "WAITING", expectedRegistrationTagId.substring(0, 8));
+  } else {
+    updateStatusSection("REG MODE OFF", TFT_GREEN);
+    updateScanSection("", "", "", TFT_WHITE);
+    updateFooter("Registration mode disabled");
+    sendToLEDMatrix("REG", "OFF", "");
+  }
+}
 
-  Serial.println("Sending queue override request:");
-  Serial.println(payload);
+void handleProfileSyncResult(const ProfileOutcome& outcome) {
+  if (outcome.ok) {
+    applyDeviceProfile(outcome.profile);
+    updateScanSection("", "", "", TFT_WHITE);
+  } else {
+    updateStatusSection("SYNC FAILED", TFT_RED);
+    updateFooter("Unable to sync device profile");
+  }
+}
 
-  int httpCode = http.POST(payload);
+// Runs on the network task, one attempt; the scheduler retries transient
+// failures and showQueueOverrideResult() shows the final result
+ApiResponse processQueueOverride(const String& queueNumber) {
+  Serial.print("Processing queue override for number: ");
+  Serial.println(queueNumber);
 
-  if (httpCode > 0) {
-    String response = http.getString();
-    Serial.print("HTTP Response: ");
-    Serial.println(httpCode);
-    Serial.println(response);
+  ApiResponse response = apiModule.sendQueueOverride(queueNumber.toInt(), "Manual keypad override");
+  if (response.result != API_SUCCESS) {
+    Serial.println("Queue override failed: " + response.error);
+  }
+  return response;
+}
 
-    if (httpCode == 200) {
-      updateStatusSection("OVERRIDE OK", TFT_GREEN);
-      updateFooter("Queue override successful");
-      sendToLEDMatrix("OVERRIDE", queueNumber, "");
-    } else {
-      updateStatusSection("OVERRIDE FAIL", TFT_RED);
-      updateFooter("Queue override failed");
-    }
+void showQueueOverrideResult(int queueNumber, int httpCode) {
+  if (httpCode == 200) {
+    updateStatusSection("OVERRIDE OK", TFT_GREEN);
+    updateFooter("Queue override successful");
+    sendToLEDMatrix("OVERRIDE", String(queueNumber), "");
+  } else if (httpCode > 0) {
+    updateStatusSection("OVERRIDE FAIL", TFT_RED);
+    updateFooter("Queue override failed");
   } else {
-    Serial.print("HTTP Error: ");
-    Serial.println(http.errorToString(httpCode));
     updateStatusSection("NET ERROR", TFT_RED);
     updateFooter("Network error during override");
   }
-
-  http.end();
 }
 
 void clearKeypadInput() {
@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <Keypad.h>
 #include "Config.h"
+#include "NetworkTask.h"
 
 class KeypadModule {
 private:
@@ -64,7 +65,10 @@ void initializeKeypad();
 void handleKeypadInput();
 void processKeypadKey(char key);
 void handleKeypadMenuSelection(char key);
-void processQueueOverride(const String& queueNumber);
+ApiResponse processQueueOverride(const String& queueNumber);  // Network task
+void showQueueOverrideResult(int queueNumber, int httpCode);
+void handleDeviceModeResult(const ProfileOutcome& outcome);
+void handleProfileSyncResult(const ProfileOutcome& outcome);
 void clearKeypadInput();
 bool checkKeypadTimeout(unsigned long currentMillis);
 
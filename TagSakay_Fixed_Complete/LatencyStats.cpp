@@ -0,0 +1,156 @@
+#include "LatencyStats.h"
+
+// Bucket upper bounds (ms); the last bucket catches everything above
+static const uint32_t bucketUpperMs[LATENCY_BUCKET_COUNT - 1] = {
+  1, 2, 5, 10, 20, 50, 100, 200, 300, 500, 750, 1000, 2000, 5000, 10000
+};
+
+static const char* transportNames[SCAN_TRANSPORT_COUNT] = { "websocket", "http", "cache" };
+
+// record() and report() run on different cores
+static portMUX_TYPE latencyLock = portMUX_INITIALIZER_UNLOCKED;
+
+// ===================================
+// LatencyHistogram
+// ===================================
+
+LatencyHistogram::LatencyHistogram() {
+  reset();
+}
+
+void LatencyHistogram::record(uint32_t ms) {
+  int bucket = 0;
+  while (bucket < LATENCY_BUCKET_COUNT - 1 && ms > bucketUpperMs[bucket]) {
+    bucket++;
+  }
+  buckets[bucket]++;
+  count++;
+  if (ms > maxMs) {
+    maxMs = ms;
+  }
+}
+
+uint32_t LatencyHistogram::percentile(uint8_t pct) const {
+  if (count == 0) {
+    return 0;
+  }
+
+  // Rank of the sample at this percentile (1-based, rounded up)
+  uint32_t rank = (count * pct + 99) / 100;
+  if (rank == 0) {
+    rank = 1;
+  }
+
+  uint32_t seen = 0;
+  for (int i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      if (i == LATENCY_BUCKET_COUNT - 1) {
+        return maxMs;
+      }
+      // Never report more than was actually observed
+      return min(bucketUpperMs[i], maxMs);
+    }
+  }
+  return maxMs;
+}
+
+void LatencyHistogram::reset() {
+  memset(buckets, 0, sizeof(buckets));
+  count = 0;
+  maxMs = 0;
+}
+
+void LatencyHistogram::toJson(JsonObject obj) const {
+  obj["n"] = count;
+  obj["p50"] = percentile(50);
+  obj["p95"] = percentile(95);
+  obj["p99"] = percentile(99);
+  obj["max"] = maxMs;
+}
+
+// ===================================
+// ScanLatencyTracker
+// ===================================
+
+void ScanLatencyTracker::record(const ScanTiming& timing, ScanTransport transport) {
+  // Only complete pipelines are comparable; the LED stage is optional and
+  // cache hits never touch the network
+  bool networked = transport != SCAN_TRANSPORT_CACHE;
+  if (!timing.detectedUs || !timing.formattedUs || !timing.displayedUs ||
+      (networked && (!timing.sentUs || !timing.receivedUs))) {
+    return;
+  }
+  uint32_t doneUs = timing.ledUs ? timing.ledUs : timing.displayedUs;
+
+  portENTER_CRITICAL(&latencyLock);
+  total[transport].record(elapsedMs(timing.detectedUs, doneUs));
+  read.record(elapsedMs(timing.detectedUs, timing.formattedUs));
+  if (networked) {
+    network[transport].record(elapsedMs(timing.sentUs, timing.receivedUs));
+    dispatch.record(elapsedMs(timing.formattedUs, timing.sentUs));
+    render.record(elapsedMs(timing.receivedUs, timing.displayedUs));
+  }
+  if (timing.ledUs) {
+    led.record(elapsedMs(timing.displayedUs, timing.ledUs));
+  }
+  portEXIT_CRITICAL(&latencyLock);
+}
+
+void ScanLatencyTracker::report(JsonObject latency) {
+  // Copy under the lock, serialize outside it (JSON allocates)
+  portENTER_CRITICAL(&latencyLock);
+  ScanLatencyTracker snapshot = *this;
+  portEXIT_CRITICAL(&latencyLock);
+
+  for (int t = 0; t < SCAN_TRANSPORT_COUNT; t++) {
+    JsonObject transport = latency.createNestedObject(transportNames[t]);
+    snapshot.total[t].toJson(transport.createNestedObject("total"));
+    snapshot.network[t].toJson(transport.createNestedObject("network"));
+  }
+
+  JsonObject stages = latency.createNestedObject("stages");
+  snapshot.read.toJson(stages.createNestedObject("read"));
+  snapshot.dispatch.toJson(stages.createNestedObject("dispatch"));
+  snapshot.render.toJson(stages.createNestedObject("render"));
+  snapshot.led.toJson(stages.createNestedObject("led"));
+}
+
+void ScanLatencyTracker::reset() {
+  portENTER_CRITICAL(&latencyLock);
+  for (int t = 0; t < SCAN_TRANSPORT_COUNT; t++) {
+    total[t].reset();
+    network[t].reset();
+  }
+  read.reset();
+  dispatch.reset();
+  render.reset();
+  led.reset();
+  portEXIT_CRITICAL(&latencyLock);
+}
+
+void ScanLatencyTracker::printStatus() {
+  portENTER_CRITICAL(&latencyLock);
+  ScanLatencyTracker snapshot = *this;
+  portEXIT_CRITICAL(&latencyLock);
+
+  Serial.println("[LATENCY] Tap-to-display (ms):");
+  for (int t = 0; t < SCAN_TRANSPORT_COUNT; t++) {
+    const LatencyHistogram& h = snapshot.total[t];
+    const LatencyHistogram& n = snapshot.network[t];
+    Serial.printf("  %-9s n=%lu  p50=%lu p95=%lu p99=%lu max=%lu  (network p50=%lu p95=%lu)\n",
+                  transportNames[t],
+                  (unsigned long)h.getCount(),
+                  (unsigned long)h.percentile(50),
+                  (unsigned long)h.percentile(95),
+                  (unsigned long)h.percentile(99),
+                  (unsigned long)h.getMax(),
+                  (unsigned long)n.percentile(50),
+                  (unsigned long)n.percentile(95));
+  }
+  Serial.printf("  stages p95: read=%lu dispatch=%lu render=%lu led=%lu\n",
+                (unsigned long)snapshot.read.percentile(95),
+                (unsigned long)snapshot.dispatch.percentile(95),
+                (unsigned long)snapshot.render.percentile(95),
+                (unsigned long)snapshot.led.percentile(95));
+}
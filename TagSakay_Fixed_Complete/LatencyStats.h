@@ -0,0 +1,68 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "Config.h"
+
+// Per-scan pipeline timestamps (micros()). A zero stamp means "not reached".
+// The tag was physically tapped up to RFID_POLL_INTERVAL before detectedUs
+// (polling mode); that part is bounded by the poll rate, not measured.
+struct ScanTiming {
+  uint32_t detectedUs;   // PN532 returned a UID
+  uint32_t formattedUs;  // UID packed into a TagUid
+  uint32_t sentUs;       // Transport send started (last attempt for HTTP)
+  uint32_t receivedUs;   // Response received on the network core
+  uint32_t displayedUs;  // TFT updated with the result
+  uint32_t ledUs;        // LED matrix command written (0 if the result sends none)
+};
+
+enum ScanTransport {
+  SCAN_TRANSPORT_WEBSOCKET,
+  SCAN_TRANSPORT_HTTP,
+  SCAN_TRANSPORT_CACHE,    // Repeat tap answered from ScanResultCache (no network stages)
+  SCAN_TRANSPORT_COUNT
+};
+
+// Fixed-bucket histogram in milliseconds. Percentiles resolve to the upper
+// bound of the bucket holding the rank (the observed max for the last bucket).
+class LatencyHistogram {
+private:
+  uint32_t buckets[LATENCY_BUCKET_COUNT];
+  uint32_t count;
+  uint32_t maxMs;
+
+public:
+  LatencyHistogram();
+
+  void record(uint32_t ms);
+  uint32_t percentile(uint8_t pct) const;
+  uint32_t getCount() const { return count; }
+  uint32_t getMax() const { return maxMs; }
+  void reset();
+  void toJson(JsonObject obj) const;
+};
+
+// Tap-to-display latency, split per transport and per pipeline stage.
+// record() runs on the UI core; report() on the network core (heartbeat).
+class ScanLatencyTracker {
+private:
+  LatencyHistogram total[SCAN_TRANSPORT_COUNT];    // detected -> last output (LED or TFT)
+  LatencyHistogram network[SCAN_TRANSPORT_COUNT];  // sent -> received
+  LatencyHistogram read;                           // detected -> formatted
+  LatencyHistogram dispatch;                       // formatted -> sent
+  LatencyHistogram render;                         // received -> TFT updated
+  LatencyHistogram led;                            // TFT updated -> LED command
+
+  static uint32_t elapsedMs(uint32_t fromUs, uint32_t toUs) { return (toUs - fromUs) / 1000; }
+
+public:
+  void record(const ScanTiming& timing, ScanTransport transport);
+  void report(JsonObject latency);
+  void reset();
+  void printStatus();
+};
+
+extern ScanLatencyTracker scanLatency;
+
+#endif // LATENCY_STATS_H
@@ -0,0 +1,149 @@
+#include "MsgPack.h"
+
+MsgPackWriter::MsgPackWriter(uint8_t* buffer, size_t capacity)
+  : buffer(buffer), capacity(capacity), length(0), overflowed(false) {}
+
+void MsgPackWriter::put(uint8_t byte) {
+  if (length >= capacity) {
+    overflowed = true;
+    return;
+  }
+  buffer[length++] = byte;
+}
+
+void MsgPackWriter::putBigEndian(uint64_t value, uint8_t bytes) {
+  for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+    put((uint8_t)(value >> shift));
+  }
+}
+
+void MsgPackWriter::map(uint8_t entries) {
+  if (entries < 16) {
+    put(0x80 | entries);
+  } else {
+    put(0xde);
+    putBigEndian(entries, 2);
+  }
+}
+
+void MsgPackWriter::uint(uint64_t value) {
+  if (value < 0x80) {
+    put((uint8_t)value);
+  } else if (value <= 0xff) {
+    put(0xcc);
+    put((uint8_t)value);
+  } else if (value <= 0xffff) {
+    put(0xcd);
+    putBigEndian(value, 2);
+  } else if (value <= 0xffffffffULL) {
+    put(0xce);
+    putBigEndian(value, 4);
+  } else {
+    put(0xcf);
+    putBigEndian(value, 8);
+  }
+}
+
+void MsgPackWriter::boolean(bool value) {
+  put(value ? 0xc3 : 0xc2);
+}
+
+void MsgPackWriter::str(const char* value) {
+  size_t n = value ? strlen(value) : 0;
+  if (n > 0xffff) {
+    n = 0xffff;
+  }
+  if (n < 32) {
+    put(0xa0 | n);
+  } else if (n <= 0xff) {
+    put(0xd9);
+    put((uint8_t)n);
+  } else {
+    put(0xda);
+    putBigEndian(n, 2);
+  }
+  for (size_t i = 0; i < n; i++) {
+    put((uint8_t)value[i]);
+  }
+}
+
+MsgPackReader::MsgPackReader(const uint8_t* data, size_t length)
+  : data(data), length(length), pos(0) {}
+
+bool MsgPackReader::take(uint8_t bytes, uint64_t& value) {
+  if (length - pos < bytes) {
+    return false;
+  }
+  value = 0;
+  for (uint8_t i = 0; i < bytes; i++) {
+    value = (value << 8) | data[pos++];
+  }
+  return true;
+}
+
+bool MsgPackReader::next(MsgPackValue& value) {
+  memset(&value, 0, sizeof(value));
+  value.type = MSGPACK_INVALID;
+  if (pos >= length) {
+    return false;
+  }
+
+  uint8_t tag = data[pos++];
+  uint64_t n = 0;
+
+  if (tag < 0x80) {
+    value.type = MSGPACK_UINT;
+    value.uint = tag;
+  } else if (tag >= 0xe0) {
+    value.type = MSGPACK_INT;
+    value.integer = (int8_t)tag;
+  } else if ((tag & 0xf0) == 0x80) {
+    value.type = MSGPACK_MAP;
+    value.length = tag & 0x0f;
+  } else if ((tag & 0xe0) == 0xa0) {
+    n = tag & 0x1f;
+    value.type = MSGPACK_STR;
+  } else {
+    switch (tag) {
+      case 0xc0: value.type = MSGPACK_NIL; break;
+      case 0xc2: value.type = MSGPACK_BOOL; value.boolean = false; break;
+      case 0xc3: value.type = MSGPACK_BOOL; value.boolean = true; break;
+      case 0xcc: case 0xcd: case 0xce: case 0xcf:
+        if (!take(1 << (tag - 0xcc), value.uint)) return false;
+        value.type = MSGPACK_UINT;
+        break;
+      case 0xd0: case 0xd1: case 0xd2: case 0xd3: {
+        uint8_t bytes = 1 << (tag - 0xd0);
+        if (!take(bytes, n)) return false;
+        // Sign-extend from the encoded width
+        value.integer = bytes == 8 ? (int64_t)n : (int64_t)(n << (64 - bytes * 8)) >> (64 - bytes * 8);
+        value.type = MSGPACK_INT;
+        n = 0;
+        break;
+      }
+      case 0xd9: case 0xda:
+        if (!take(tag == 0xd9 ? 1 : 2, n)) return false;
+        value.type = MSGPACK_STR;
+        break;
+      case 0xde:
+        if (!take(2, n)) return false;
+        value.type = MSGPACK_MAP;
+        value.length = (uint32_t)n;
+        n = 0;
+        break;
+      default:
+        return false;  // Arrays, floats, binary, ext: not used on this link
+    }
+  }
+
+  if (value.type == MSGPACK_STR) {
+    if (length - pos < n) {
+      value.type = MSGPACK_INVALID;
+      return false;
+    }
+    value.str = (const char*)data + pos;
+    value.length = (uint32_t)n;
+    pos += n;
+  }
+  return true;
+}
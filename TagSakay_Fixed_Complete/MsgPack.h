@@ -0,0 +1,73 @@
+#ifndef MSGPACK_H
+#define MSGPACK_H
+
+#include <Arduino.h>
+
+// Minimal MessagePack for the binary WebSocket frames: maps with small
+// integer keys holding unsigned integers, booleans and short strings. The
+// writer fills a caller's buffer (no heap); the reader walks a received
+// frame in place. Anything outside this subset is an error, not guessed at.
+
+class MsgPackWriter {
+private:
+  uint8_t* buffer;
+  size_t capacity;
+  size_t length;
+  bool overflowed;
+
+  void put(uint8_t byte);
+  void putBigEndian(uint64_t value, uint8_t bytes);
+
+public:
+  MsgPackWriter(uint8_t* buffer, size_t capacity);
+
+  void map(uint8_t entries);
+  void uint(uint64_t value);
+  void boolean(bool value);
+  void str(const char* value);
+  void nil() { put(0xc0); }
+
+  // Key and value together, the common case
+  void field(uint8_t key, uint64_t value) { uint(key); uint(value); }
+  void field(uint8_t key, bool value) { uint(key); boolean(value); }
+  void field(uint8_t key, const char* value) { uint(key); str(value); }
+
+  size_t size() const { return overflowed ? 0 : length; }  // 0: did not fit
+};
+
+enum MsgPackType : uint8_t {
+  MSGPACK_NIL,
+  MSGPACK_BOOL,
+  MSGPACK_UINT,
+  MSGPACK_INT,      // Negative
+  MSGPACK_STR,
+  MSGPACK_MAP,
+  MSGPACK_INVALID   // Unsupported type, or the frame ended early
+};
+
+// One decoded item. Strings point into the frame and are not terminated.
+struct MsgPackValue {
+  MsgPackType type;
+  bool boolean;
+  uint64_t uint;
+  int64_t integer;
+  const char* str;
+  uint32_t length;  // String bytes, or map entries
+};
+
+class MsgPackReader {
+private:
+  const uint8_t* data;
+  size_t length;
+  size_t pos;
+
+  bool take(uint8_t bytes, uint64_t& value);
+
+public:
+  MsgPackReader(const uint8_t* data, size_t length);
+
+  bool next(MsgPackValue& value);   // False at the end or on an invalid item
+  bool atEnd() const { return pos >= length; }
+};
+
+#endif // MSGPACK_H
@@ -2,6 +2,8 @@
 #include "DisplayModule.h"
 #include "UARTModule.h"
 #include "esp_mac.h"
+#include "TagFilter.h"
+#include "ApiModule.h"
 
 // NetworkModule Class Implementation
 NetworkModule::NetworkModule() 
@@ -195,72 +197,20 @@ String getCurrentTimestamp() {
   return String(timestamp);
 }
 
-ApiResponse makeApiRequest(const String& endpoint, const String& payload, const String& method) {
-  ApiResponse response;
-  response.result = API_NETWORK_ERROR;
-  response.httpCode = 0;
-
+// Legacy entry point: shares ApiModule's kept-alive connection, request lock
+// and statistics instead of opening an HTTPClient of its own per call
+ApiResponse makeApiRequest(const String& endpoint, const String& payload, const String& method,
+                           ApiBody* body) {
   if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi not connected!");
+    ApiResponse response;
+    response.result = API_NETWORK_ERROR;
+    response.httpCode = 0;
     response.error = "WiFi not connected";
+    LOG_WARNING("API request skipped - WiFi not connected");
     return response;
   }
 
-  HTTPClient http;
-  String url = String(serverConfig.baseUrl) + endpoint;
-
-  Serial.println("=== API Request ===");
-  Serial.print("URL: ");
-  Serial.println(url);
-  Serial.print("Method: ");
-  Serial.println(method);
-
-  http.begin(url);
-  http.setTimeout(serverConfig.timeout);
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("x-api-key", serverConfig.apiKey);
-
-  int httpCode;
-  if (method == "POST") {
-    Serial.print("Payload: ");
-    Serial.println(payload);
-    httpCode = http.POST(payload);
-  } else if (method == "PUT") {
-    Serial.print("Payload: ");
-    Serial.println(payload);
-    httpCode = http.PUT(payload);
-  } else {
-    httpCode = http.GET();
-  }
-
-  response.httpCode = httpCode;
-
-  if (httpCode > 0) {
-    String responseBody = http.getString();
-    Serial.print("HTTP Response Code: ");
-    Serial.println(httpCode);
-    Serial.print("Response: ");
-    Serial.println(responseBody);
-
-    response.data = responseBody;
-
-    if (httpCode >= 200 && httpCode < 300) {
-      response.result = API_SUCCESS;
-    } else {
-      response.result = API_HTTP_ERROR;
-      response.error = "HTTP " + String(httpCode);
-    }
-  } else {
-    Serial.print("HTTP Request failed: ");
-    Serial.println(http.errorToString(httpCode));
-    response.error = http.errorToString(httpCode);
-    response.result = API_NETWORK_ERROR;
-  }
-
-  http.end();
-  Serial.println("===================");
-
-  return response;
+  return apiModule.request(method, endpoint, payload, false, nullptr, body);
 }
 
 void handleRfidScan(String tagId) {
@@ -280,10 +230,13 @@ void handleRfidScan(String tagId) {
   String payload;
   serializeJson(doc, payload);
 
-  ApiResponse response = makeApiRequest(endpoint, payload, "POST");
+  StaticJsonDocument<512> reply;
+  ApiBody body{reply, "{\"message\":true,\"data\":{\"tagId\":true,\"status\":true,"
+                      "\"queueNumber\":true,\"driver\":{\"firstName\":true,\"lastName\":true}}}"};
+  ApiResponse response = makeApiRequest(endpoint, payload, "POST", &body);
 
   if (response.result == API_SUCCESS) {
-    handleScanResponse(response.data);
+    handleScanResponse(reply);
   } else {
     Serial.println("Scan request failed!");
     updateStatusSection("SCAN FAILED", TFT_RED);
@@ -294,18 +247,7 @@ void handleRfidScan(String tagId) {
   }
 }
 
-void handleScanResponse(const String& responseData) {
-  StaticJsonDocument<1024> doc;
-  DeserializationError error = deserializeJson(doc, responseData);
-
-  if (error) {
-    Serial.print("JSON parsing failed: ");
-    Serial.println(error.c_str());
-    updateStatusSection("JSON ERROR", TFT_RED);
-    blinkError(1);
-    return;
-  }
-
+void handleScanResponse(JsonDocument& doc) {
   bool success = doc["success"] | false;
   String message = doc["message"] | "Unknown response";
 
@@ -401,7 +343,7 @@ bool sendHeartbeat() {
   return success;
 }
 
-void reportDeviceStatus(String reason) {
+ApiResponse reportDeviceStatus(String reason, const DeviceStateSnapshot& state) {
   Serial.print("Reporting device status. Reason: ");
   Serial.println(reason);
 
@@ -411,8 +353,8 @@ void reportDeviceStatus(String reason) {
   doc["status"] = "active";
   doc["reason"] = reason;
   doc["timestamp"] = getCurrentTimestamp();
-  doc["location"] = serverConfig.deviceLocation;
-  doc["registrationMode"] = registrationMode;
+  doc["location"] = state.location;
+  doc["registrationMode"] = state.registrationMode;
   doc["uptime"] = millis() / 1000;
   doc["freeHeap"] = ESP.getFreeHeap();
 
@@ -426,46 +368,54 @@ void reportDeviceStatus(String reason) {
   } else {
     Serial.println("Failed to report device status");
   }
+  return response;
 }
 
 void checkRegistrationModeFromServer() {
   String endpoint = "/api/devices/" + deviceId + "/registration-status";
 
-  ApiResponse response = makeApiRequest(endpoint, "", "GET");
+  StaticJsonDocument<256> doc;
+  ApiBody body{doc, "{\"data\":{\"registrationMode\":true,\"expectedTagId\":true}}"};
+  ApiResponse response = makeApiRequest(endpoint, "", "GET", &body);
 
   if (response.result == API_SUCCESS) {
-    StaticJsonDocument<512> doc;
-    DeserializationError error = deserializeJson(doc, response.data);
-
-    if (!error) {
-      bool serverRegistrationMode = doc["data"]["registrationMode"] | false;
-      String expectedTag = doc["data"]["expectedTagId"] | "";
-
-      if (serverRegistrationMode != registrationMode) {
-        registrationMode = serverRegistrationMode;
-        expectedRegistrationTagId = expectedTag;
-
-        Serial.print("Registration mode updated from server: ");
-        Serial.println(registrationMode ? "ENABLED" : "DISABLED");
-
-        if (registrationMode) {
-          Serial.print("Expected tag ID: ");
-          Serial.println(expectedRegistrationTagId);
-          registrationModeStartTime = millis();
-          indicateRegistrationMode();
-          updateScanSection("", "Waiting for tag", expectedRegistrationTagId, TFT_MAGENTA);
-          sendToLEDMatrix("REG", "WAITING", expectedTag.substring(0, 8));
-        } else {
-          Serial.println("Registration mode disabled by server");
-          indicateReady();
-          updateScanSection("", "", "", TFT_WHITE);
-        }
+    bool serverRegistrationMode = doc["data"]["registrationMode"] | false;
+    String expectedTag = doc["data"]["expectedTagId"] | "";
+
+    if (serverRegistrationMode != registrationMode) {
+      registrationMode = serverRegistrationMode;
+      expectedRegistrationTagId = expectedTag;
+
+      Serial.print("Registration mode updated from server: ");
+      Serial.println(registrationMode ? "ENABLED" : "DISABLED");
+
+      if (registrationMode) {
+        Serial.print("Expected tag ID: ");
+        Serial.println(expectedRegistrationTagId);
+        registrationModeStartTime = millis();
+        indicateRegistrationMode();
+        updateScanSection("", "Waiting for tag", expectedRegistrationTagId, TFT_MAGENTA);
+        sendToLEDMatrix("REG", "WAITING", expectedTag.substring(0, 8));
+      } else {
+        Serial.println("Registration mode disabled by server");
+        indicateReady();
+        updateScanSection("", "", "", TFT_WHITE);
       }
     }
   }
 }
 
 bool updateDeviceMode(bool registrationModeEnabled, bool scanModeEnabled, const String& pendingTagId) {
+  DeviceProfile profile;
+  if (!requestDeviceMode(registrationModeEnabled, scanModeEnabled, pendingTagId, profile)) {
+    return false;
+  }
+  applyDeviceMode(profile);
+  return true;
+}
+
+bool requestDeviceMode(bool registrationModeEnabled, bool scanModeEnabled,
+                       const String& pendingTagId, DeviceProfile& profile) {
   String endpoint = "/api/devices/" + deviceId + "/mode";
 
   StaticJsonDocument<256> doc;
@@ -478,146 +428,298 @@ bool updateDeviceMode(bool registrationModeEnabled, bool scanModeEnabled, const
   String payload;
   serializeJson(doc, payload);
 
-  ApiResponse response = makeApiRequest(endpoint, payload, "POST");
+  StaticJsonDocument<256> resDoc;
+  ApiBody body{resDoc, "{\"data\":{\"device\":{\"registrationMode\":true,\"scanMode\":true,"
+                       "\"pendingRegistrationTagId\":true}}}"};
+  ApiResponse response = makeApiRequest(endpoint, payload, "POST", &body);
   if (response.result != API_SUCCESS) {
     Serial.println("Failed to update device mode via API");
     return false;
   }
 
-  StaticJsonDocument<512> resDoc;
-  DeserializationError error = deserializeJson(resDoc, response.data);
-  if (!error) {
-    JsonObject device = resDoc["data"]["device"];
-    if (!device.isNull()) {
-      registrationMode = device["registrationMode"] | registrationModeEnabled;
-      deviceConfig.scanMode = device["scanMode"] | scanModeEnabled;
-      expectedRegistrationTagId = device["pendingRegistrationTagId"] | expectedRegistrationTagId;
+  // Default to the requested state; the server's device record wins if present
+  memset(&profile, 0, sizeof(profile));
+  profile.registrationMode = registrationModeEnabled;
+  profile.scanMode = scanModeEnabled;
+
+  JsonObject device = resDoc["data"]["device"];
+  if (!device.isNull()) {
+    profile.registrationMode = device["registrationMode"] | registrationModeEnabled;
+    profile.scanMode = device["scanMode"] | scanModeEnabled;
+    const char* pendingTag = device["pendingRegistrationTagId"];
+    if (pendingTag) {
+      profile.hasPendingTag = true;
+      strlcpy(profile.pendingTagId, pendingTag, sizeof(profile.pendingTagId));
     }
   }
 
-  if (registrationModeEnabled) {
+  return true;
+}
+
+void applyDeviceMode(const DeviceProfile& profile) {
+  registrationMode = profile.registrationMode;
+  deviceConfig.scanMode = profile.scanMode;
+  if (profile.hasPendingTag) {
+    expectedRegistrationTagId = profile.pendingTagId;
+  }
+
+  if (registrationMode) {
     registrationModeStartTime = millis();
   } else {
     registrationModeStartTime = 0;
   }
+}
 
+bool syncDeviceProfile() {
+  DeviceProfile profile;
+  if (!fetchDeviceProfile(profile)) {
+    return false;
+  }
+  applyDeviceProfile(profile);
   return true;
 }
 
-bool syncDeviceProfile() {
+bool fetchDeviceProfile(DeviceProfile& profile) {
   String endpoint = "/api/devices/" + deviceId;
 
-  ApiResponse response = makeApiRequest(endpoint, "", "GET");
+  // The device record carries far more than the profile uses
+  StaticJsonDocument<384> doc;
+  ApiBody body{doc, "{\"data\":{\"device\":{\"name\":true,\"location\":true,\"registrationMode\":true,"
+                    "\"scanMode\":true,\"pendingRegistrationTagId\":true}}}"};
+  ApiResponse response = makeApiRequest(endpoint, "", "GET", &body);
   if (response.result != API_SUCCESS) {
     Serial.println("Failed to sync device profile from API");
     return false;
   }
 
-  StaticJsonDocument<1024> doc;
-  DeserializationError error = deserializeJson(doc, response.data);
-  if (error) {
-    Serial.print("JSON parsing error during profile sync: ");
-    Serial.println(error.c_str());
-    return false;
-  }
-
   JsonObject device = doc["data"]["device"];
   if (device.isNull()) {
     Serial.println("Device payload missing during profile sync");
     return false;
   }
 
-  deviceConfig.name = String(device["name"] | deviceConfig.name.c_str());
-  deviceConfig.location = String(device["location"] | deviceConfig.location.c_str());
-  deviceConfig.registrationMode = device["registrationMode"] | deviceConfig.registrationMode;
-  deviceConfig.scanMode = device["scanMode"] | deviceConfig.scanMode;
+  memset(&profile, 0, sizeof(profile));
+  strlcpy(profile.name, device["name"] | "", sizeof(profile.name));
+  strlcpy(profile.location, device["location"] | "", sizeof(profile.location));
+  profile.registrationMode = device["registrationMode"] | deviceConfig.registrationMode;
+  profile.scanMode = device["scanMode"] | deviceConfig.scanMode;
+
+  const char* pendingTag = device["pendingRegistrationTagId"];
+  if (pendingTag) {
+    profile.hasPendingTag = true;
+    strlcpy(profile.pendingTagId, pendingTag, sizeof(profile.pendingTagId));
+  }
+
+  return true;
+}
+
+void applyDeviceProfile(const DeviceProfile& profile) {
+  if (profile.name[0] != '\0') {
+    deviceConfig.name = profile.name;
+  }
+  if (profile.location[0] != '\0') {
+    deviceConfig.location = profile.location;
+  }
+  deviceConfig.registrationMode = profile.registrationMode;
+  deviceConfig.scanMode = profile.scanMode;
 
   registrationMode = deviceConfig.registrationMode;
-  expectedRegistrationTagId = String(device["pendingRegistrationTagId"] | expectedRegistrationTagId.c_str());
+  if (profile.hasPendingTag) {
+    expectedRegistrationTagId = profile.pendingTagId;
+  }
 
   updateStatusSection("PROFILE SYNCED", TFT_GREEN);
   updateFooter("Device profile refreshed from server");
+}
 
+bool pollServerCommands() {
+  ServerCommandSet commands;
+  if (!fetchServerCommands(commands)) {
+    return false;
+  }
+  applyServerCommands(commands);
+  markServerCommandsApplied(commands);
   return true;
 }
 
-bool pollServerCommands() {
+bool fetchTagFilter() {
+  String endpoint = "/api/rfid/filter?version=" + String(tagFilter.getVersion());
+
+  // Base64 bits take 4/3 of the filter size; the document copies them
+  DynamicJsonDocument doc(TAG_FILTER_MAX_BYTES * 4 / 3 + 512);
+  ApiBody body{doc, "{\"data\":{\"unchanged\":true,\"version\":true,\"bitCount\":true,"
+                    "\"hashCount\":true,\"tagCount\":true,\"bits\":true}}"};
+  ApiResponse response = makeApiRequest(endpoint, "", "GET", &body);
+  if (response.result != API_SUCCESS) {
+    Serial.printf("[FILTER] Download failed (HTTP %d)\n", response.httpCode);
+    return false;
+  }
+
+  JsonObject data = doc["data"];
+  if (data["unchanged"] | false) {
+    tagFilter.markCurrent(millis());
+    return true;
+  }
+
+  uint32_t version = data["version"] | 0;
+  bool installed = tagFilter.install(version, data["bitCount"] | 0, data["hashCount"] | 0,
+                                     data["tagCount"] | 0, data["bits"] | "");
+  if (!installed && tagFilter.getVersion() != version) {
+    Serial.println("[FILTER] Rejected malformed tag filter");
+    return false;
+  }
+
+  tagFilter.markCurrent(millis());
+  Serial.printf("[FILTER] Installed tag filter v%lu (%lu tags)%s\n", (unsigned long)version,
+                (unsigned long)tagFilter.getTagCount(), installed ? "" : " - not saved to flash");
+  return true;
+}
+
+bool fetchServerCommands(ServerCommandSet& commands) {
   String endpoint = "/api/devices/" + deviceId + "/commands";
 
-  ApiResponse response = makeApiRequest(endpoint, "", "GET");
+  if (WiFi.status() != WL_CONNECTED) {
+    return false;
+  }
+
+  StaticJsonDocument<512> doc;
+  ApiBody body{doc, COMMANDS_FILTER};
+  ApiResponse response = apiModule.request("GET", endpoint, "", false, commandPoll.version, &body);
   if (response.result != API_SUCCESS) {
     Serial.printf("[POLL] Command poll failed (HTTP %d)\n", response.httpCode);
     return false;
   }
 
-  StaticJsonDocument<2048> doc;
-  DeserializationError error = deserializeJson(doc, response.data);
-  if (error) {
-    Serial.print("[POLL] JSON parse error: ");
-    Serial.println(error.c_str());
+  return acceptServerCommands(response, doc, commands);
+}
+
+bool acceptServerCommands(const ApiResponse& response, JsonDocument& body,
+                          ServerCommandSet& commands) {
+  if (response.notModified) {
+    commandPoll.unchanged++;
     return false;
   }
 
+  if (!parseServerCommands(body, commands)) {
+    return false;
+  }
+
+  // The cursor moves in markServerCommandsApplied(), once the set has
+  // actually reached the UI; until then the next poll brings it again
+  strlcpy(commands.version, response.etag.c_str(), sizeof(commands.version));
+  return true;
+}
+
+void markServerCommandsApplied(const ServerCommandSet& commands) {
+  strlcpy(commandPoll.version, commands.version, sizeof(commandPoll.version));
+  commandPoll.changed++;
+}
+
+const char COMMANDS_FILTER[] =
+  "{\"message\":true,\"data\":{\"deviceStatus\":{\"registrationMode\":true,\"scanMode\":true},"
+  "\"commands\":[{\"action\":true,\"tagId\":true,\"enabled\":true}]}}";
+
+bool parseServerCommands(JsonDocument& doc, ServerCommandSet& commands) {
   if (!doc["success"]) {
     Serial.println("[POLL] Response missing success=true");
     return false;
   }
 
-  bool refreshNeeded = false;
-  JsonObject data = doc["data"];
+  parseCommandData(doc["data"], commands);
+  return true;
+}
 
-  // Sync device status flags from server if present
+void parseCommandData(JsonObject data, ServerCommandSet& commands) {
+  memset(&commands, 0, sizeof(commands));
+
+  // Device status flags from server if present
   if (!data["deviceStatus"].isNull()) {
     JsonObject status = data["deviceStatus"];
 
     if (!status["registrationMode"].isNull()) {
-      bool reg = status["registrationMode"].as<bool>();
-      if (reg != registrationMode) {
-        registrationMode = reg;
-        if (registrationMode) {
-          registrationModeStartTime = millis();
-        } else {
-          registrationModeStartTime = 0;
-          expectedRegistrationTagId = "";
-        }
-        Serial.printf("[POLL] Registration mode %s by server\n", reg ? "ENABLED" : "DISABLED");
-        refreshNeeded = true;
-      }
+      commands.hasRegistrationMode = true;
+      commands.registrationMode = status["registrationMode"].as<bool>();
     }
 
     if (!status["scanMode"].isNull()) {
-      bool scan = status["scanMode"].as<bool>();
-      if (scan != deviceConfig.scanMode) {
-        deviceConfig.scanMode = scan;
-        Serial.printf("[POLL] Scan mode %s by server\n", scan ? "ENABLED" : "DISABLED");
-        refreshNeeded = true;
-      }
+      commands.hasScanMode = true;
+      commands.scanMode = status["scanMode"].as<bool>();
     }
   }
 
-  // Process commands array
+  // Commands array (unknown actions are skipped)
   if (!data["commands"].isNull() && data["commands"].is<JsonArray>()) {
-    JsonArray commands = data["commands"].as<JsonArray>();
-    for (JsonObject cmd : commands) {
+    JsonArray list = data["commands"].as<JsonArray>();
+    for (JsonObject cmd : list) {
+      if (commands.count >= MAX_SERVER_COMMANDS) {
+        Serial.println("[POLL] Too many commands - extra entries ignored");
+        break;
+      }
+
+      ServerCommand& entry = commands.commands[commands.count];
       String action = cmd["action"].as<String>();
       if (action == "enable_registration") {
-        String tagId = cmd["tagId"].as<String>();
+        entry.action = CMD_ENABLE_REGISTRATION;
+        strlcpy(entry.tagId, cmd["tagId"] | "", sizeof(entry.tagId));
+      } else if (action == "disable_registration") {
+        entry.action = CMD_DISABLE_REGISTRATION;
+      } else if (action == "scan_mode") {
+        entry.action = CMD_SCAN_MODE;
+        entry.enabled = cmd["enabled"].isNull() ? deviceConfig.scanMode : cmd["enabled"].as<bool>();
+      } else {
+        continue;
+      }
+      commands.count++;
+    }
+  }
+}
+
+void applyServerCommands(const ServerCommandSet& commands) {
+  bool refreshNeeded = false;
+
+  // Sync device status flags from server if present
+  if (commands.hasRegistrationMode && commands.registrationMode != registrationMode) {
+    registrationMode = commands.registrationMode;
+    if (registrationMode) {
+      registrationModeStartTime = millis();
+    } else {
+      registrationModeStartTime = 0;
+      expectedRegistrationTagId = "";
+    }
+    Serial.printf("[POLL] Registration mode %s by server\n", registrationMode ? "ENABLED" : "DISABLED");
+    refreshNeeded = true;
+  }
+
+  if (commands.hasScanMode && commands.scanMode != deviceConfig.scanMode) {
+    deviceConfig.scanMode = commands.scanMode;
+    Serial.printf("[POLL] Scan mode %s by server\n", commands.scanMode ? "ENABLED" : "DISABLED");
+    refreshNeeded = true;
+  }
+
+  // Process commands array
+  for (uint8_t i = 0; i < commands.count; i++) {
+    const ServerCommand& cmd = commands.commands[i];
+    switch (cmd.action) {
+      case CMD_ENABLE_REGISTRATION:
         registrationMode = true;
-        expectedRegistrationTagId = tagId;
+        expectedRegistrationTagId = cmd.tagId;
         registrationModeStartTime = millis();
-        Serial.printf("[POLL] Enable registration for tag: %s\n", tagId.c_str());
+        Serial.printf("[POLL] Enable registration for tag: %s\n", cmd.tagId);
         refreshNeeded = true;
-      } else if (action == "disable_registration") {
+        break;
+
+      case CMD_DISABLE_REGISTRATION:
         registrationMode = false;
         expectedRegistrationTagId = "";
         Serial.println("[POLL] Disable registration");
         refreshNeeded = true;
-      } else if (action == "scan_mode") {
-        bool enabled = cmd["enabled"].isNull() ? deviceConfig.scanMode : cmd["enabled"].as<bool>();
-        deviceConfig.scanMode = enabled;
-        Serial.printf("[POLL] Scan mode set %s\n", enabled ? "ENABLED" : "DISABLED");
+        break;
+
+      case CMD_SCAN_MODE:
+        deviceConfig.scanMode = cmd.enabled;
+        Serial.printf("[POLL] Scan mode set %s\n", cmd.enabled ? "ENABLED" : "DISABLED");
         refreshNeeded = true;
-      }
+        break;
     }
   }
 
@@ -631,6 +733,4 @@ bool pollServerCommands() {
       updateFooter("Normal scanning mode");
     }
   }
-
-  return true;
-}
\ No newline at end of file
+}
@@ -3,7 +3,6 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
-#include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include "Config.h"
 
@@ -19,8 +18,66 @@ enum ApiResult {
 struct ApiResponse {
   ApiResult result;
   int httpCode;
-  String data;
   String error;
+  uint32_t handshakeMs = 0;  // Connection setup this request paid (0: reused a warm one)
+  String etag;               // ETag response header, if the server sent one
+  bool notModified = false;  // 304/204: conditional request, nothing new (no body)
+  bool hasBody = false;      // Body parsed into the request's ApiBody (any status)
+};
+
+// Where a response body goes. ApiModule parses it once, into doc, keeping
+// only the fields named in filter (ArduinoJson filter as JSON text, e.g.
+// {"data":{"user":{"name":true}}}; nullptr keeps everything). "success"
+// is always kept: it is what makes a 2xx body valid. Without an ApiBody
+// nothing of the body is kept.
+struct ApiBody {
+  JsonDocument& doc;
+  const char* filter;
+};
+
+// Plain-data views of server state. These cross the core boundary through
+// NetworkTask queues, so they must not contain String or other heap objects.
+enum ServerCommandAction {
+  CMD_ENABLE_REGISTRATION,
+  CMD_DISABLE_REGISTRATION,
+  CMD_SCAN_MODE
+};
+
+struct ServerCommand {
+  ServerCommandAction action;
+  bool enabled;                            // CMD_SCAN_MODE
+  char tagId[MAX_TAG_ID_LENGTH + 1];       // CMD_ENABLE_REGISTRATION
+};
+
+struct ServerCommandSet {
+  bool hasRegistrationMode;
+  bool registrationMode;
+  bool hasScanMode;
+  bool scanMode;
+  uint8_t count;
+  ServerCommand commands[MAX_SERVER_COMMANDS];
+  char version[24];                        // ETag of the set (polls only)
+};
+
+// Conditional command polling. version is the ETag of the command set last
+// applied; polls send it as If-None-Match and an unchanged set comes back
+// as an empty 304 (GET /commands) or 204 (POST /sync). Sets pushed over the
+// WebSocket carry the same version, so a push also satisfies the next poll.
+// Network core only.
+struct CommandPollState {
+  char version[24];
+  uint32_t changed;          // Polls that brought a new command set
+  uint32_t unchanged;        // Empty answers: nothing parsed, nothing redrawn
+  uint32_t pushed;           // New sets received over the WebSocket
+};
+
+struct DeviceProfile {
+  bool registrationMode;
+  bool scanMode;
+  bool hasPendingTag;
+  char pendingTagId[MAX_TAG_ID_LENGTH + 1];
+  char name[32];                           // Empty = unchanged
+  char location[32];                       // Empty = unchanged
 };
 
 class NetworkModule {
@@ -58,6 +115,8 @@ public:
   void updateConnectionStatus();
 };
 
+struct DeviceStateSnapshot;  // ApiModule.h
+
 // WiFi and Network
 bool connectToWiFi();
 String getDeviceMacAddress();
@@ -67,17 +126,38 @@ bool initializeTime();
 String getCurrentTimestamp();
 
 // API Communication
-ApiResponse makeApiRequest(const String& endpoint, const String& payload = "", const String& method = "GET");
+ApiResponse makeApiRequest(const String& endpoint, const String& payload = "", const String& method = "GET",
+                           ApiBody* body = nullptr);
 void handleRfidScan(String tagId);
-void handleScanResponse(const String& responseData);
+void handleScanResponse(JsonDocument& response);
 bool sendHeartbeat();
 void sendRfidScan(String tagId);
-void reportDeviceStatus(String reason);
+ApiResponse reportDeviceStatus(String reason, const DeviceStateSnapshot& state);  // Network task
 void checkRegistrationModeFromServer();
 bool updateDeviceMode(bool registrationModeEnabled, bool scanModeEnabled, const String& pendingTagId = "");
 bool syncDeviceProfile();
 
+// Network half (safe on the network core - no display or global state writes)
+bool requestDeviceMode(bool registrationModeEnabled, bool scanModeEnabled,
+                       const String& pendingTagId, DeviceProfile& profile);
+bool fetchDeviceProfile(DeviceProfile& profile);
+bool fetchServerCommands(ServerCommandSet& commands);
+extern const char COMMANDS_FILTER[];     // Fields of a /commands or /sync reply that are used
+bool parseServerCommands(JsonDocument& body, ServerCommandSet& commands);  // /commands or /sync reply
+void parseCommandData(JsonObject data, ServerCommandSet& commands);       // commands + deviceStatus
+bool acceptServerCommands(const ApiResponse& response, JsonDocument& body,
+                          ServerCommandSet& commands);                    // false: nothing new
+void markServerCommandsApplied(const ServerCommandSet& commands);         // Once delivered to the UI
+bool fetchTagFilter();
+
+// UI half (applies server state and refreshes the display)
+void applyDeviceMode(const DeviceProfile& profile);
+void applyDeviceProfile(const DeviceProfile& profile);
+void applyServerCommands(const ServerCommandSet& commands);
+
 // Command polling (HTTP-based control plane)
 bool pollServerCommands();
 
+extern CommandPollState commandPoll;
+
 #endif // NETWORK_MODULE_H
\ No newline at end of file
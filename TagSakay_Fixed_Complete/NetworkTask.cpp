@@ -0,0 +1,1074 @@
+#include "NetworkTask.h"
+#include "KeypadModule.h"
+#include "ScanJournal.h"
+#include "TagFilter.h"
+#include <time.h>
+
+// Runtime switches owned by the main sketch
+extern bool offlineMode;
+extern bool useWebSocket;
+
+NetworkTask* NetworkTask::instance = nullptr;
+
+static const char* priorityNames[NET_PRIO_COUNT] = {
+  "scan", "registration", "commands", "heartbeat", "telemetry"
+};
+
+// How long a request may wait before it is not worth sending (0 = forever)
+static const unsigned long priorityDeadlines[NET_PRIO_COUNT] = {
+  0, 0, NET_DEADLINE_COMMANDS, NET_DEADLINE_HEARTBEAT, NET_DEADLINE_TELEMETRY
+};
+
+static const uint8_t priorityQueueSizes[NET_PRIO_COUNT] = {
+  NET_REQUEST_QUEUE_SIZE, NET_CONTROL_QUEUE_SIZE, NET_CONTROL_QUEUE_SIZE,
+  NET_CONTROL_QUEUE_SIZE, NET_CONTROL_QUEUE_SIZE
+};
+
+// Classes whose failures the scheduler retries; their backoff waits are
+// spent serving other classes instead of blocking in ApiModule. Of the
+// registration class only queue overrides get here (scans retry in
+// ApiModule's scan queue, mode and profile requests report failure).
+static const bool priorityRetries[NET_PRIO_COUNT] = {
+  false, true, false, true, true
+};
+
+NetworkTask::NetworkTask()
+  : network(nullptr), api(nullptr), ws(nullptr), eventQueue(nullptr),
+    taskHandle(nullptr), lastLinkCheck(0), linkDown(false), linkFailReported(false),
+    backendOnline(true), nextDrainAt(0), drainRttMs(0),
+    nextWsSeq(1), wsScansSent(0), wsRetransmits(0), wsFallbacks(0), wsWindowFull(0),
+    wsLateResults(0), batchesSent(0), batchesFailed(0), telemetryCount(0), syncSupported(true), syncProbeAt(0),
+    nextFilterCheck(0), requestsHandled(0), requestsDropped(0), eventsDropped(0) {
+  for (int i = 0; i < NET_REQ_TYPE_COUNT; i++) {
+    pending[i] = false;
+  }
+  memset(classes, 0, sizeof(classes));
+  memset(wsInflight, 0, sizeof(wsInflight));
+  instance = this;
+}
+
+bool NetworkTask::begin(NetworkModule& networkModule, ApiModule& apiModule, WebSocketModule& wsModule) {
+  network = &networkModule;
+  api = &apiModule;
+  ws = &wsModule;
+
+  for (int i = 0; i < NET_PRIO_COUNT; i++) {
+    classes[i].queue = xQueueCreate(priorityQueueSizes[i], sizeof(NetRequest));
+    if (!classes[i].queue) {
+      LOG_ERROR("Network task: queue allocation failed");
+      return false;
+    }
+  }
+  eventQueue = xQueueCreate(NET_EVENT_QUEUE_SIZE, sizeof(NetEvent));
+  if (!eventQueue) {
+    LOG_ERROR("Network task: queue allocation failed");
+    return false;
+  }
+
+  // ws->loop() runs on the network core from now on, so its callbacks must
+  // hand results to the UI core instead of drawing directly
+  ws->setOnScanResponse(onWsScanResponse);
+  ws->setOnConfigUpdate(onWsConfigUpdate);
+  ws->setOnConnectionStatus(onWsConnectionStatus);
+  ws->setOnCommands(onWsCommands);
+  ws->setOnHeartbeatAck(onWsHeartbeatAck);
+  api->setScanCompletionCallback(onScanComplete);
+
+  BaseType_t created = xTaskCreatePinnedToCore(taskEntry, "network", NET_TASK_STACK_SIZE, this,
+                                               NET_TASK_PRIORITY, &taskHandle, NET_TASK_CORE);
+  if (created != pdPASS) {
+    taskHandle = nullptr;
+    LOG_ERROR("Network task: xTaskCreatePinnedToCore failed");
+    return false;
+  }
+
+  Serial.printf("[NET] Network task started on core %d\n", NET_TASK_CORE);
+  return true;
+}
+
+void NetworkTask::taskEntry(void* param) {
+  static_cast<NetworkTask*>(param)->run();
+}
+
+void NetworkTask::run() {
+  NetRequest request;
+  NetPriority priority;
+
+  for (;;) {
+    // Sleep until a request is posted or a parked retry falls due; the
+    // timeout doubles as the WebSocket service period
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(idleWait()));
+
+    // One request per pass, always the most urgent one
+    if (nextRequest(request, priority)) {
+      handleRequest(request);
+      classes[priority].handled++;
+      requestsHandled++;
+    }
+
+    // Probe open circuits first, so a half-open one takes a queued scan as its trial
+    serviceCircuits();
+
+    // Deliver queued HTTP scans and any retries that are now due
+    api->serviceScanQueue();
+
+    // Commit buffered offline scans and drain them once the backend is back
+    serviceJournal();
+
+    // Keep the offline tag filter current
+    serviceTagFilter();
+
+    // WebSocket loop: handles messages, and reconnects while the socket is down
+    if (useWebSocket) {
+      ws->loop();
+      serviceWsScans();
+    }
+
+    unsigned long now = millis();
+    if (now - lastLinkCheck >= NETWORK_CHECK_INTERVAL) {
+      lastLinkCheck = now;
+      checkLink();
+    }
+  }
+}
+
+bool NetworkTask::nextRequest(NetRequest& request, NetPriority& priority) {
+  unsigned long now = millis();
+
+  for (int i = 0; i < NET_PRIO_COUNT; i++) {
+    if (!takeFromClass((NetPriority)i, now, request)) {
+      continue;
+    }
+
+    // Parked retries below this class wait for the link to be free
+    for (int j = i + 1; j < NET_PRIO_COUNT; j++) {
+      if (classes[j].hasRetry && (long)(now - classes[j].retryAt) >= 0) {
+        classes[j].preempted++;
+      }
+    }
+
+    priority = (NetPriority)i;
+    return true;
+  }
+  return false;
+}
+
+bool NetworkTask::takeFromClass(NetPriority priority, unsigned long now, NetRequest& request) {
+  NetPriorityClass& cls = classes[priority];
+
+  for (;;) {
+    if (cls.hasRetry && (long)(now - cls.retryAt) >= 0) {
+      request = cls.retry;
+      cls.hasRetry = false;
+    } else if (xQueueReceive(cls.queue, &request, 0) == pdTRUE) {
+      pending[request.type] = false;
+
+      // A fresh request of the same kind carries newer state than the one
+      // parked; an override for another queue number does not replace it
+      if (cls.hasRetry && cls.retry.type == request.type && request.type != NET_REQ_QUEUE_OVERRIDE) {
+        cls.hasRetry = false;
+        cls.expired++;
+      }
+    } else {
+      return false;
+    }
+
+    unsigned long waited = now - request.postedAt;
+    unsigned long deadline = priorityDeadlines[priority];
+    if (deadline != 0 && waited > deadline) {
+      expire(request, priority);
+      continue;
+    }
+
+    if (request.attempts == 0) {
+      cls.waits++;
+      cls.totalWaitMs += waited;
+      if (waited > cls.maxWaitMs) {
+        cls.maxWaitMs = waited;
+      }
+    }
+    return true;
+  }
+}
+
+void NetworkTask::expire(const NetRequest& request, NetPriority priority) {
+  classes[priority].expired++;
+  Serial.printf("[NET] Dropped %s request after %lums in queue\n",
+                priorityNames[priority], millis() - request.postedAt);
+
+  // Someone pressed a key for this one; tell them it did not go out
+  if (request.type == NET_REQ_HEARTBEAT && request.heartbeat.manual) {
+    NetEvent event;
+    memset(&event, 0, sizeof(event));
+    event.type = NET_EVT_HEARTBEAT;
+    event.request.manual = true;
+    publish(event);
+  }
+}
+
+bool NetworkTask::retryLater(const NetRequest& request, const ApiResponse& response) {
+  NetPriority priority = priorityOf(request);
+  bool transient = response.httpCode <= 0 || response.httpCode >= 500;
+  if (!priorityRetries[priority] || !transient || request.attempts >= API_RETRY_ATTEMPTS) {
+    return false;
+  }
+
+  // One parked retry per class: a second failure is reported, not stacked
+  if (classes[priority].hasRetry) {
+    return false;
+  }
+
+  unsigned long backoff = API_RETRY_BASE_DELAY << request.attempts;
+  unsigned long deadline = priorityDeadlines[priority];
+  if (deadline != 0 && millis() + backoff - request.postedAt > deadline) {
+    return false;  // Would only expire in the queue
+  }
+
+  NetPriorityClass& cls = classes[priority];
+  cls.retry = request;
+  cls.retry.attempts++;
+  cls.retryAt = millis() + backoff;
+  cls.hasRetry = true;
+  cls.retried++;
+  LOG_DEBUG("Retrying " + String(priorityNames[priority]) + " request in " + String(backoff) + "ms");
+  return true;
+}
+
+unsigned long NetworkTask::idleWait() {
+  unsigned long wait = WS_LOOP_INTERVAL;
+  unsigned long now = millis();
+
+  for (int i = 0; i < NET_PRIO_COUNT; i++) {
+    if (uxQueueMessagesWaiting(classes[i].queue) > 0) {
+      return 0;
+    }
+    if (classes[i].hasRetry) {
+      long until = (long)(classes[i].retryAt - now);
+      if (until <= 0) {
+        return 0;
+      }
+      if ((unsigned long)until < wait) {
+        wait = until;
+      }
+    }
+  }
+  return wait;
+}
+
+void NetworkTask::handleRequest(const NetRequest& request) {
+  NetEvent event;
+  memset(&event, 0, sizeof(event));
+
+  switch (request.type) {
+    case NET_REQ_SCAN:
+      handleScan(request.scan);
+      break;
+
+    case NET_REQ_HEARTBEAT: {
+      api->updateDeviceState(request.heartbeat.state);
+      // Single attempt: a retry waits in the scheduler, behind anything more urgent
+      ApiResponse response = api->sendHeartbeat(true, false);
+      if (response.result != API_SUCCESS && retryLater(request, response)) {
+        break;
+      }
+      event.type = NET_EVT_HEARTBEAT;
+      event.request.ok = (response.result == API_SUCCESS);
+      event.request.manual = request.heartbeat.manual;
+      publish(event);
+      break;
+    }
+
+    case NET_REQ_SYNC:
+      handleSync(request.sync);
+      break;
+
+    case NET_REQ_REPORT_STATUS: {
+      if (syncSupported) {
+        bufferTelemetry(request.status.reason);  // Rides on the next sync
+        break;
+      }
+      ApiResponse response = reportDeviceStatus(request.status.reason, request.status.state);
+      if (response.result != API_SUCCESS) {
+        retryLater(request, response);
+      }
+      break;
+    }
+
+    case NET_REQ_SET_MODE:
+      event.type = NET_EVT_MODE_RESULT;
+      event.profile.requestedRegistration = request.mode.registrationMode;
+      event.profile.ok = requestDeviceMode(request.mode.registrationMode, request.mode.scanMode,
+                                           request.mode.pendingTagId, event.profile.profile);
+      publish(event);
+      break;
+
+    case NET_REQ_SYNC_PROFILE:
+      event.type = NET_EVT_PROFILE_RESULT;
+      event.profile.ok = fetchDeviceProfile(event.profile.profile);
+      publish(event);
+      break;
+
+    case NET_REQ_QUEUE_OVERRIDE: {
+      ApiResponse response = processQueueOverride(String(request.queueNumber));
+      if (response.result != API_SUCCESS && retryLater(request, response)) {
+        break;  // "OVERRIDE..." stays up until the retry settles
+      }
+      event.type = NET_EVT_OVERRIDE_RESULT;
+      event.request.queueNumber = request.queueNumber;
+      event.request.httpCode = response.httpCode;
+      event.request.ok = (response.httpCode == 200);
+      publish(event);
+      break;
+    }
+
+    case NET_REQ_PRINT_STATUS:
+      writeStatus();
+      break;
+
+    default:
+      break;
+  }
+}
+
+void NetworkTask::handleScan(const ScanRequest& scan) {
+  // Live scans take the path the selector rates faster; registrations
+  // always go over HTTP
+  if (!scan.registration && useWebSocket &&
+      transport.choose(ws->isHealthy(), millis()) == SCAN_TRANSPORT_WEBSOCKET &&
+      sendWsScan(scan)) {
+    return;  // Response will be delivered through onWsScanResponse
+  }
+
+  submitHttpScan(scan);
+}
+
+void NetworkTask::submitHttpScan(const ScanRequest& scan) {
+  if (scan.registration) {
+    Serial.println("[HTTP] Sending registration via HTTP");
+  } else {
+    Serial.println("[HTTP] Sending scan via HTTP");
+  }
+
+  // Queued, not sent: retries back off in the background instead of
+  // holding up heartbeats and other requests behind this scan
+  if (api->submitScan(scan.tag, scan.location, scan.registration, &scan.timing) != SCAN_TICKET_NONE) {
+    return;  // Result will be delivered through onScanComplete
+  }
+
+  NetEvent event;
+  memset(&event, 0, sizeof(event));
+  event.type = NET_EVT_SCAN_RESULT;
+  event.scan.registration = scan.registration;
+  event.scan.result = API_NETWORK_ERROR;
+  event.scan.consecutiveFailures = api->getConsecutiveFailures();
+  event.scan.tag = scan.tag;
+  strlcpy(event.scan.error, "Scan queue full", sizeof(event.scan.error));
+  publish(event);
+}
+
+// The backend's own 404s from /sync ("Device not found") are answers. Only
+// the router's notFound, or a 404 that is not a backend reply at all (a
+// proxy, a stale route), means the endpoint does not exist.
+static bool isRouteNotFound(const ApiResponse& response, JsonDocument& reply) {
+  if (response.httpCode != 404) {
+    return false;
+  }
+  if (!response.hasBody || !reply.containsKey("success")) {
+    return true;
+  }
+  const char* message = reply["message"] | "";
+  return strcmp(message, "Route not found") == 0;
+}
+
+void NetworkTask::handleSync(const SyncRequest& sync) {
+  NetEvent event;
+  memset(&event, 0, sizeof(event));
+  api->updateDeviceState(sync.state);
+
+  // Without /sync, it is tried again now and then: the backend may have
+  // been upgraded, or the 404 that ruled it out was a routing glitch
+  bool probing = !syncSupported && (long)(millis() - syncProbeAt) >= 0;
+  if (syncSupported || probing) {
+    StaticJsonDocument<512> reply;
+    ApiBody body{reply, COMMANDS_FILTER};
+    unsigned long startedAt = millis();
+    ApiResponse response = api->sendSync(sync.includeStats, telemetry, telemetryCount,
+                                         commandPoll.version, &body);
+
+    // Syncs keep the HTTP path measured while scans ride the socket
+    if (response.httpCode > 0 && response.httpCode < 500) {
+      transport.recordSuccess(SCAN_TRANSPORT_HTTP, millis() - startedAt, millis());
+    } else {
+      transport.recordLoss(SCAN_TRANSPORT_HTTP, millis());
+    }
+    if (isRouteNotFound(response, reply)) {
+      // Backend predates /sync: fall back to the separate requests below
+      if (syncSupported) {
+        Serial.println("[SYNC] Server has no sync endpoint - using heartbeat and command poll");
+      }
+      syncSupported = false;
+      syncProbeAt = millis() + SYNC_REPROBE_INTERVAL;
+    } else {
+      if (probing) {
+        Serial.println("[SYNC] Server sync endpoint available again");
+      }
+      syncSupported = true;
+      bool ok = response.result == API_SUCCESS;
+      if (ok) {
+        telemetryCount = 0;
+      } else {
+        Serial.printf("[SYNC] Failed (HTTP %d)\n", response.httpCode);
+      }
+
+      if (sync.includeStats) {
+        event.type = NET_EVT_HEARTBEAT;
+        event.request.ok = ok;
+        publish(event);
+      }
+
+      // An unchanged command set (204) is not parsed and not sent to the UI
+      memset(&event, 0, sizeof(event));
+      event.type = NET_EVT_COMMANDS;
+      if (ok && acceptServerCommands(response, reply, event.commands) && publish(event)) {
+        markServerCommandsApplied(event.commands);
+      }
+      return;
+    }
+  }
+
+  if (sync.includeStats) {
+    ApiResponse response = api->sendHeartbeat(true, false);
+    event.type = NET_EVT_HEARTBEAT;
+    event.request.ok = (response.result == API_SUCCESS);
+    publish(event);
+  }
+
+  for (int i = 0; i < telemetryCount; i++) {
+    reportDeviceStatus(telemetry[i].reason, sync.state);
+  }
+  telemetryCount = 0;
+
+  memset(&event, 0, sizeof(event));
+  event.type = NET_EVT_COMMANDS;
+  if (fetchServerCommands(event.commands)) {
+    if (publish(event)) {
+      markServerCommandsApplied(event.commands);
+    }
+  } else {
+    // Non-fatal; just log
+    Serial.println("[POLL] No updates or failed to poll commands");
+  }
+}
+
+void NetworkTask::bufferTelemetry(const char* reason) {
+  if (telemetryCount == SYNC_TELEMETRY_MAX) {
+    // Full: drop the oldest report
+    memmove(&telemetry[0], &telemetry[1], sizeof(TelemetryEvent) * (SYNC_TELEMETRY_MAX - 1));
+    telemetryCount--;
+  }
+  strlcpy(telemetry[telemetryCount].reason, reason, sizeof(telemetry[telemetryCount].reason));
+  telemetry[telemetryCount].at = millis();
+  telemetryCount++;
+}
+
+void NetworkTask::onScanComplete(const ScanCompletion& completion) {
+  if (!instance) return;
+
+  // Any server answer below 500 means the path works, whatever the verdict
+  if (!completion.registration) {
+    if (completion.httpCode > 0 && completion.httpCode < 500) {
+      uint32_t rttMs = (completion.timing.receivedUs - completion.timing.sentUs) / 1000;
+      instance->transport.recordSuccess(SCAN_TRANSPORT_HTTP, rttMs, millis());
+    } else {
+      instance->transport.recordLoss(SCAN_TRANSPORT_HTTP, millis());
+    }
+  }
+
+  // Live scan that never reached the backend: keep it for replay
+  if (!completion.registration && completion.result != API_SUCCESS && completion.httpCode <= 0) {
+    time_t now = time(nullptr);
+    bool clockSet = now >= 1000000000;
+    uint32_t tappedAt = clockSet ? (uint32_t)(now - completion.elapsedMs / 1000) : 0;
+    scanJournal.append(completion.tag.bytes, completion.tag.length, tappedAt, millis(),
+                       JOURNAL_FLAG_SEND_FAILED | (clockSet ? JOURNAL_FLAG_EPOCH_VALID : 0));
+  }
+
+  NetEvent event;
+  memset(&event, 0, sizeof(event));
+  event.type = NET_EVT_SCAN_RESULT;
+  event.scan.registration = completion.registration;
+  event.scan.result = completion.result;
+  event.scan.httpCode = completion.httpCode;
+  event.scan.consecutiveFailures = instance->api->getConsecutiveFailures();
+  event.scan.timing = completion.timing;
+  event.scan.tag = completion.tag;
+  event.scan.hasVerdict = completion.hasVerdict;
+  event.scan.registered = completion.registered;
+  strlcpy(event.scan.userName, completion.userName, sizeof(event.scan.userName));
+  strlcpy(event.scan.userRole, completion.userRole, sizeof(event.scan.userRole));
+  strlcpy(event.scan.error, completion.error, sizeof(event.scan.error));
+  instance->publish(event);
+}
+
+void NetworkTask::serviceJournal() {
+  if (!scanJournal.isReady()) {
+    return;
+  }
+
+  unsigned long now = millis();
+  scanJournal.service(now);  // Group commits and compaction stay off the UI core
+
+  if (offlineMode || !network->isConnected() || !api->isInitialized() ||
+      (long)(now - nextDrainAt) < 0 || liveTrafficPending()) {
+    return;
+  }
+
+  JournalRecord batch[SCAN_BATCH_MAX_RECORDS];
+  int count = scanJournal.readPending(batch, SCAN_BATCH_MAX_RECORDS);
+  if (count == 0) {
+    return;
+  }
+
+  int sent = 0;
+  unsigned long started = millis();
+  ApiResponse response = api->sendBatchScans(scanJournal.getJournalId(), batch, count, sent);
+  unsigned long rtt = millis() - started;
+  drainRttMs = drainRttMs == 0 ? rtt : (drainRttMs * 7 + rtt) / 8;
+
+  // Records leave the journal only once the backend has taken the batch
+  if (response.result == API_SUCCESS && sent > 0) {
+    scanJournal.ack(batch[sent - 1].sequence);
+    batchesSent++;
+
+    // Keep the link mostly free for live scans: idle a few round trips
+    unsigned long spacing = drainRttMs * SCAN_BATCH_RTT_FACTOR;
+    nextDrainAt = millis() + (spacing > SCAN_BATCH_MIN_INTERVAL ? spacing : SCAN_BATCH_MIN_INTERVAL);
+    LOG_INFOF("[JOURNAL] Drained %d offline scan(s) in %lums\n", sent, rtt);
+  } else {
+    batchesFailed++;
+    nextDrainAt = millis() + SCAN_JOURNAL_RETRY_DELAY;
+    Serial.printf("[JOURNAL] Batch of %d failed (%s) - retrying later\n", sent, response.error.c_str());
+  }
+}
+
+bool NetworkTask::liveTrafficPending() {
+  // Live scans (HTTP queue or a WebSocket scan waiting in the request
+  // queue) always go first; the drain resumes once they are through
+  return api->getPendingScanCount() > 0 || getQueuedRequests() > 0;
+}
+
+void NetworkTask::serviceTagFilter() {
+  unsigned long now = millis();
+  if (!IS_FEATURE_ENABLED(FEATURE_LOCAL_STORAGE) || offlineMode || !network->isConnected() ||
+      !api->isInitialized() || (long)(now - nextFilterCheck) < 0 || liveTrafficPending()) {
+    return;
+  }
+
+  bool ok = fetchTagFilter();
+  nextFilterCheck = millis() + (ok ? TAG_FILTER_REFRESH_INTERVAL : TAG_FILTER_RETRY_DELAY);
+}
+
+void NetworkTask::checkLink() {
+  network->updateConnectionStatus();
+
+  if (network->isConnected() && !linkDown) {
+    return;
+  }
+
+  NetEvent event;
+  memset(&event, 0, sizeof(event));
+  event.type = NET_EVT_LINK_STATUS;
+
+  if (!linkDown) {
+    Serial.println("[NETWORK] Connection lost - attempting reconnect...");
+    linkDown = true;
+    linkFailReported = false;
+    event.link = LINK_LOST;
+    publish(event);
+
+    // Nothing reaches the backend now; fail fast until a probe gets through
+    api->openCircuits();
+  }
+
+  // Retried every check for as long as the outage lasts (reconnect() paces
+  // its own attempts), so offline mode ends when the WiFi comes back
+  if (network->isConnected() || network->reconnect()) {
+    Serial.println("[NETWORK] Reconnected successfully");
+    linkDown = false;
+    api->resetFailureCount();
+    event.link = LINK_RECONNECTED;
+    publish(event);
+  } else if (!linkFailReported) {
+    Serial.println("[NETWORK] Reconnection failed - entering offline mode");
+    linkFailReported = true;
+    event.link = LINK_RECONNECT_FAILED;
+    publish(event);
+  }
+}
+
+void NetworkTask::serviceCircuits() {
+  if (network->isConnected()) {
+    api->probeCircuits();
+  }
+
+  // The UI goes offline (scans to the journal) while live scans cannot get
+  // through, and back online as soon as a probe half-opens the circuit
+  bool online = api->getCircuitState(API_CIRCUIT_SCAN) != CIRCUIT_OPEN;
+  if (online == backendOnline) {
+    return;
+  }
+  backendOnline = online;
+
+  NetEvent event;
+  memset(&event, 0, sizeof(event));
+  event.type = NET_EVT_BACKEND_STATUS;
+  event.online = online;
+  publish(event);
+}
+
+bool NetworkTask::post(const NetRequest& request) {
+  NetPriority priority = priorityOf(request);
+  NetPriorityClass& cls = classes[priority];
+  if (!cls.queue || !taskHandle) {
+    return false;
+  }
+
+  NetRequest stamped = request;
+  stamped.postedAt = millis();
+  stamped.attempts = 0;
+  if (xQueueSend(cls.queue, &stamped, 0) != pdTRUE) {
+    cls.dropped++;
+    requestsDropped++;
+    LOG_WARNING("Network " + String(priorityNames[priority]) + " queue full - request dropped");
+    return false;
+  }
+
+  xTaskNotifyGive(taskHandle);
+  return true;
+}
+
+bool NetworkTask::postCoalesced(const NetRequest& request) {
+  if (pending[request.type]) {
+    return true;  // Same request already queued
+  }
+  // Flag first: the network core may take the request and clear the flag
+  // before post() returns, and setting it afterwards would wedge it on
+  pending[request.type] = true;
+  if (!post(request)) {
+    pending[request.type] = false;
+    return false;
+  }
+  return true;
+}
+
+bool NetworkTask::receive(NetEvent& event) {
+  if (!eventQueue) {
+    return false;
+  }
+  return xQueueReceive(eventQueue, &event, 0) == pdTRUE;
+}
+
+bool NetworkTask::publish(const NetEvent& event) {
+  // Blocking here only delays the network core; the UI drains every few ms
+  if (xQueueSend(eventQueue, &event, pdMS_TO_TICKS(50)) != pdTRUE) {
+    eventsDropped++;
+    LOG_WARNING("Network event queue full - event dropped");
+    return false;
+  }
+  return true;
+}
+
+int NetworkTask::getQueuedRequests() const {
+  int total = 0;
+  for (int i = 0; i < NET_PRIO_COUNT; i++) {
+    total += getQueuedRequests((NetPriority)i);
+  }
+  return total;
+}
+
+int NetworkTask::getQueuedRequests(NetPriority priority) const {
+  const NetPriorityClass& cls = classes[priority];
+  return cls.queue ? (int)uxQueueMessagesWaiting(cls.queue) : 0;
+}
+
+unsigned long NetworkTask::getAverageWaitMs(NetPriority priority) const {
+  const NetPriorityClass& cls = classes[priority];
+  return cls.waits > 0 ? cls.totalWaitMs / cls.waits : 0;
+}
+
+void NetworkTask::reportQueues(JsonObject obj) const {
+  for (int i = 0; i < NET_PRIO_COUNT; i++) {
+    const NetPriorityClass& cls = classes[i];
+    JsonObject entry = obj.createNestedObject(priorityNames[i]);
+    entry["queued"] = getQueuedRequests((NetPriority)i) + (cls.hasRetry ? 1 : 0);
+    entry["waitAvgMs"] = getAverageWaitMs((NetPriority)i);
+    entry["waitMaxMs"] = cls.maxWaitMs;
+    entry["expired"] = cls.expired;
+    entry["dropped"] = cls.dropped;
+  }
+}
+
+void NetworkTask::printStatus() {
+  NetRequest request;
+  memset(&request, 0, sizeof(request));
+  request.type = NET_REQ_PRINT_STATUS;
+  // The connection, socket and poll state are only consistent on the
+  // network core; print here only when there is no task to ask
+  if (!postCoalesced(request) && !isRunning()) {
+    writeStatus();
+  }
+}
+
+void NetworkTask::writeStatus() {
+  Serial.printf("[NET] core=%d running=%s handled=%lu queued=%d dropped=%lu eventsDropped=%lu scansPending=%d\n",
+                NET_TASK_CORE,
+                isRunning() ? "yes" : "no",
+                (unsigned long)requestsHandled,
+                getQueuedRequests(),
+                (unsigned long)requestsDropped,
+                (unsigned long)eventsDropped,
+                api ? api->getPendingScanCount() : 0);
+  if (taskHandle) {
+    Serial.printf("[NET] Stack high-water mark: %u bytes\n",
+                  (unsigned)uxTaskGetStackHighWaterMark(taskHandle));
+  }
+  for (int i = 0; i < NET_PRIO_COUNT; i++) {
+    const NetPriorityClass& cls = classes[i];
+    Serial.printf("[NET]   %-12s queued=%d%s handled=%lu wait avg=%lums max=%lums "
+                  "expired=%lu dropped=%lu retried=%lu preempted=%lu\n",
+                  priorityNames[i], getQueuedRequests((NetPriority)i), cls.hasRetry ? "+1" : "",
+                  (unsigned long)cls.handled, getAverageWaitMs((NetPriority)i),
+                  (unsigned long)cls.maxWaitMs, (unsigned long)cls.expired,
+                  (unsigned long)cls.dropped, (unsigned long)cls.retried,
+                  (unsigned long)cls.preempted);
+  }
+  if (api) {
+    api->getConnection().printStatus();
+    api->printCircuitStatus();
+  }
+  if (ws && useWebSocket) {
+    ws->printStatus();
+    transport.printStatus();
+    Serial.printf("[WS] scans sent=%lu inFlight=%d retransmits=%lu fallbacks=%lu windowFull=%lu "
+                  "late=%lu rtt p50=%lums p95=%lums max=%lums\n",
+                  (unsigned long)wsScansSent, getWsScansInFlight(),
+                  (unsigned long)wsRetransmits, (unsigned long)wsFallbacks,
+                  (unsigned long)wsWindowFull, (unsigned long)wsLateResults,
+                  (unsigned long)wsScanRtt.percentile(50), (unsigned long)wsScanRtt.percentile(95),
+                  (unsigned long)wsScanRtt.getMax());
+  }
+  Serial.printf("[POLL] commands changed=%lu unchanged=%lu pushed=%lu version=%s\n",
+                (unsigned long)commandPoll.changed, (unsigned long)commandPoll.unchanged,
+                (unsigned long)commandPoll.pushed,
+                commandPoll.version[0] ? commandPoll.version : "-");
+  if (scanJournal.isReady()) {
+    Serial.printf("[JOURNAL] pending=%lu dropped=%lu corrupted=%lu batches=%lu failed=%lu rtt=%lums\n",
+                  (unsigned long)scanJournal.getPendingCount(),
+                  (unsigned long)scanJournal.getDroppedCount(),
+                  (unsigned long)scanJournal.getCorruptedCount(),
+                  (unsigned long)batchesSent,
+                  (unsigned long)batchesFailed,
+                  drainRttMs);
+  }
+  if (tagFilter.isLoaded()) {
+    Serial.printf("[FILTER] version=%lu tags=%lu bytes=%u\n",
+                  (unsigned long)tagFilter.getVersion(),
+                  (unsigned long)tagFilter.getTagCount(),
+                  (unsigned)tagFilter.getSizeBytes());
+  }
+}
+
+// ===================================
+// WebSocket scan window (network core)
+// ===================================
+
+bool NetworkTask::sendWsScan(const ScanRequest& scan) {
+  WsInflightScan* slot = nullptr;
+  for (int i = 0; i < WS_SCAN_WINDOW; i++) {
+    if (!wsInflight[i].used) {
+      slot = &wsInflight[i];
+      break;
+    }
+  }
+  if (!slot) {
+    wsWindowFull++;
+    Serial.printf("[WS] %d scans in flight - sending this one via HTTP\n", WS_SCAN_WINDOW);
+    return false;
+  }
+
+  slot->seq = nextWsSeq++;
+  if (nextWsSeq == 0) nextWsSeq = 1;  // 0 means "no seq" in a scan_result
+  slot->sends = 0;
+  slot->scan = scan;
+  slot->scan.timing.sentUs = micros();
+  if (!transmitWsScan(*slot)) {
+    return false;
+  }
+
+  slot->used = true;
+  wsScansSent++;
+  Serial.printf("[WS] Scan #%lu sent (%d in flight)\n",
+                (unsigned long)slot->seq, getWsScansInFlight());
+  return true;
+}
+
+bool NetworkTask::transmitWsScan(WsInflightScan& slot) {
+  if (!ws->sendScan(slot.scan.tag, slot.scan.location, slot.seq)) {
+    return false;
+  }
+  slot.sends++;
+  slot.sentAt = millis();
+  slot.lastSentUs = micros();
+  return true;
+}
+
+WsInflightScan* NetworkTask::findWsScan(uint32_t seq, const TagUid& tag) {
+  WsInflightScan* oldest = nullptr;
+  for (int i = 0; i < WS_SCAN_WINDOW; i++) {
+    WsInflightScan& slot = wsInflight[i];
+    if (!slot.used) continue;
+    if (seq != 0) {
+      if (slot.seq == seq) return &slot;
+      continue;
+    }
+    // A server that does not echo seq: oldest scan of the same tag
+    if (slot.scan.tag == tag && (!oldest || (int32_t)(slot.seq - oldest->seq) < 0)) {
+      oldest = &slot;
+    }
+  }
+  return oldest;
+}
+
+void NetworkTask::serviceWsScans() {
+  unsigned long now = millis();
+  for (int i = 0; i < WS_SCAN_WINDOW; i++) {
+    WsInflightScan& slot = wsInflight[i];
+    if (!slot.used || now - slot.sentAt < WS_SCAN_ACK_TIMEOUT) continue;
+
+    transport.recordLoss(SCAN_TRANSPORT_WEBSOCKET, now);
+
+    // Past the deadline: HTTP takes it over while it is answering; without
+    // it, resend. Delivery is at-least-once: the server folds a repeated seq
+    // only on the same socket, so a scan whose reply was lost can be recorded
+    // again after a reconnect or by the HTTP fallback.
+    if (transport.httpUsable()) {
+      fallBackWsScan(slot, "past its ack deadline");
+      continue;
+    }
+    if (slot.sends <= WS_SCAN_RETRANSMITS && ws->isHealthy() && transmitWsScan(slot)) {
+      wsRetransmits++;
+      Serial.printf("[WS] Scan #%lu unanswered - resent (%u)\n",
+                    (unsigned long)slot.seq, slot.sends);
+      continue;
+    }
+
+    fallBackWsScan(slot, "unanswered");
+  }
+}
+
+void NetworkTask::fallBackWsScan(WsInflightScan& slot, const char* why) {
+  slot.used = false;
+  wsFallbacks++;
+  Serial.printf("[WS] Scan #%lu %s - falling back to HTTP\n", (unsigned long)slot.seq, why);
+  submitHttpScan(slot.scan);
+}
+
+int NetworkTask::getWsScansInFlight() const {
+  int count = 0;
+  for (int i = 0; i < WS_SCAN_WINDOW; i++) {
+    if (wsInflight[i].used) count++;
+  }
+  return count;
+}
+
+void NetworkTask::reportWsScans(JsonObject obj) const {
+  obj["sent"] = wsScansSent;
+  obj["retransmits"] = wsRetransmits;
+  obj["fallbacks"] = wsFallbacks;
+  obj["windowFull"] = wsWindowFull;
+  obj["late"] = wsLateResults;
+  wsScanRtt.toJson(obj.createNestedObject("rtt"));
+}
+
+// ===================================
+// WebSocket callbacks (network core)
+// ===================================
+
+void NetworkTask::onWsScanResponse(JsonDocument& doc) {
+  if (!instance) return;
+
+  NetEvent event;
+  memset(&event, 0, sizeof(event));
+  event.type = NET_EVT_SCAN_RESULT;
+
+  ScanOutcome& outcome = event.scan;
+  outcome.viaWebSocket = true;
+  outcome.result = doc["success"] ? API_SUCCESS : API_HTTP_ERROR;
+  // An explicit isRegistered:false is a verdict even from a server that
+  // still reports it as success:false (as the HTTP path treats its 404)
+  JsonVariant isRegistered = doc["scan"]["isRegistered"];
+  outcome.hasVerdict = outcome.result == API_SUCCESS ||
+                       (isRegistered.is<bool>() && !isRegistered.as<bool>());
+  outcome.registered = (doc["scan"]["isRegistered"] | false) && doc.containsKey("user");
+  outcome.tag.parse(doc["scan"]["tagId"] | "");
+  if (outcome.registered) {
+    strlcpy(outcome.userName, doc["user"]["name"] | "Unknown", sizeof(outcome.userName));
+    strlcpy(outcome.userRole, doc["user"]["role"] | "", sizeof(outcome.userRole));
+  }
+  strlcpy(outcome.error, doc["error"] | "Unknown error", sizeof(outcome.error));
+
+  // A result for a scan already answered, or already moved to HTTP, would
+  // show the same tap twice
+  uint32_t seq = doc["seq"] | 0;
+  WsInflightScan* slot = instance->findWsScan(seq, outcome.tag);
+  if (!slot) {
+    instance->wsLateResults++;
+    Serial.printf("[WS] scan_result #%lu matches no scan in flight - ignored\n", (unsigned long)seq);
+    return;
+  }
+
+  outcome.timing = slot->scan.timing;
+  outcome.timing.receivedUs = micros();
+  uint32_t rttMs = (outcome.timing.receivedUs - slot->lastSentUs) / 1000;
+  // After a resend the answer may be to either send, so only first sends count
+  if (slot->sends == 1) {
+    instance->wsScanRtt.record(rttMs);
+    instance->transport.recordSuccess(SCAN_TRANSPORT_WEBSOCKET, rttMs, millis());
+  }
+  Serial.printf("[WS] Scan #%lu answered in %lums\n", (unsigned long)slot->seq, (unsigned long)rttMs);
+  slot->used = false;
+
+  if (outcome.result == API_SUCCESS && outcome.registered) {
+    instance->api->resetFailureCount();
+  }
+
+  instance->publish(event);
+}
+
+void NetworkTask::onWsConfigUpdate(JsonDocument& doc) {
+  if (!instance || !doc.containsKey("config")) return;
+
+  NetEvent event;
+  memset(&event, 0, sizeof(event));
+  event.type = NET_EVT_WS_CONFIG;
+  event.registrationMode = doc["config"]["registrationMode"] | false;
+  instance->publish(event);
+}
+
+bool NetworkTask::onWsCommands(JsonDocument& doc) {
+  if (!instance) return false;
+
+  // Same version as the last applied set (e.g. the push on connect after an
+  // HTTP poll already brought it): acknowledge without redrawing anything
+  const char* version = doc["version"] | "";
+  if (version[0] && strcmp(version, commandPoll.version) == 0) {
+    return true;
+  }
+
+  NetEvent event;
+  memset(&event, 0, sizeof(event));
+  event.type = NET_EVT_COMMANDS;
+  parseCommandData(doc.as<JsonObject>(), event.commands);
+  if (!instance->publish(event)) {
+    return false;  // Not acknowledged; the server sends it again
+  }
+
+  // The HTTP safety-net poll now answers 204 for this set
+  strlcpy(commandPoll.version, version, sizeof(commandPoll.version));
+  commandPoll.pushed++;
+  return true;
+}
+
+void NetworkTask::onWsHeartbeatAck(uint32_t rttMs) {
+  if (!instance) return;
+  instance->transport.recordSuccess(SCAN_TRANSPORT_WEBSOCKET, rttMs, millis());
+}
+
+void NetworkTask::onWsConnectionStatus(bool connected) {
+  if (!instance) return;
+
+  // Nothing will answer on a lost socket; send what was in flight via HTTP
+  if (!connected) {
+    for (int i = 0; i < WS_SCAN_WINDOW; i++) {
+      if (instance->wsInflight[i].used) {
+        instance->transport.recordLoss(SCAN_TRANSPORT_WEBSOCKET, millis());
+        instance->fallBackWsScan(instance->wsInflight[i], "lost with the socket");
+      }
+    }
+  }
+
+  NetEvent event;
+  memset(&event, 0, sizeof(event));
+  event.type = NET_EVT_WS_STATUS;
+  event.connected = connected;
+  instance->publish(event);
+}
+
+// ===================================
+// Request builders (UI core)
+// ===================================
+
+NetPriority priorityOf(const NetRequest& request) {
+  switch (request.type) {
+    case NET_REQ_SCAN:
+      return request.scan.registration ? NET_PRIO_REGISTRATION : NET_PRIO_LIVE_SCAN;
+    case NET_REQ_SYNC:
+      return NET_PRIO_COMMANDS;
+    case NET_REQ_HEARTBEAT:
+      return NET_PRIO_HEARTBEAT;
+    case NET_REQ_REPORT_STATUS:
+      return NET_PRIO_TELEMETRY;
+    default:
+      return NET_PRIO_REGISTRATION;  // Keypad actions: someone is waiting on them
+  }
+}
+
+DeviceStateSnapshot captureDeviceState() {
+  DeviceStateSnapshot state;
+  memset(&state, 0, sizeof(state));
+  state.registrationMode = registrationMode;
+  state.scanMode = deviceConfig.scanMode;
+  strlcpy(state.pendingTagId, expectedRegistrationTagId.c_str(), sizeof(state.pendingTagId));
+  strlcpy(state.location, deviceConfig.location.c_str(), sizeof(state.location));
+  state.wifiConnected = systemStatus.wifiConnected;
+  state.rfidInitialized = systemStatus.rfidInitialized;
+  state.offlineMode = systemStatus.offlineMode;
+  return state;
+}
+
+NetRequest makeScanRequest(const TagUid& tag, bool registration) {
+  NetRequest request;
+  memset(&request, 0, sizeof(request));
+  request.type = NET_REQ_SCAN;
+  request.scan.registration = registration;
+  request.scan.tag = tag;
+  strlcpy(request.scan.location, deviceConfig.location.c_str(), sizeof(request.scan.location));
+  return request;
+}
+
+NetRequest makeHeartbeatRequest(bool manual) {
+  NetRequest request;
+  memset(&request, 0, sizeof(request));
+  request.type = NET_REQ_HEARTBEAT;
+  request.heartbeat.manual = manual;
+  request.heartbeat.state = captureDeviceState();
+  return request;
+}
+
+NetRequest makeSyncRequest(bool includeStats) {
+  NetRequest request;
+  memset(&request, 0, sizeof(request));
+  request.type = NET_REQ_SYNC;
+  request.sync.includeStats = includeStats;
+  request.sync.state = captureDeviceState();
+  return request;
+}
+
+NetRequest makeStatusRequest(const char* reason) {
+  NetRequest request;
+  memset(&request, 0, sizeof(request));
+  request.type = NET_REQ_REPORT_STATUS;
+  strlcpy(request.status.reason, reason, sizeof(request.status.reason));
+  request.status.state = captureDeviceState();
+  return request;
+}
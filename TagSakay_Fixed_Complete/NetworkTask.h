@@ -0,0 +1,304 @@
+#ifndef NETWORK_TASK_H
+#define NETWORK_TASK_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "NetworkModule.h"
+#include "ApiModule.h"
+#include "WebSocketModule.h"
+#include "TransportSelector.h"
+
+// =======================
+// UI -> Network requests
+// =======================
+
+enum NetRequestType {
+  NET_REQ_SCAN,             // Live or registration scan (WebSocket or queued HTTP)
+  NET_REQ_HEARTBEAT,        // Periodic or manual heartbeat
+  NET_REQ_SYNC,             // Heartbeat, status reports and command poll in one
+  NET_REQ_REPORT_STATUS,    // reportDeviceStatus(reason)
+  NET_REQ_SET_MODE,         // Keypad menu: enable/disable registration
+  NET_REQ_SYNC_PROFILE,     // Keypad menu: refresh device profile
+  NET_REQ_QUEUE_OVERRIDE,   // Keypad: manual queue number
+  NET_REQ_PRINT_STATUS,     // Keypad: dump diagnostics to serial
+  NET_REQ_TYPE_COUNT
+};
+
+// Priority classes, served strictly in this order. Each has its own queue,
+// so a backlog of heartbeats never sits in front of a driver's scan.
+enum NetPriority {
+  NET_PRIO_LIVE_SCAN,       // Tap at the reader
+  NET_PRIO_REGISTRATION,    // Registration taps and keypad actions
+  NET_PRIO_COMMANDS,        // Control-plane poll
+  NET_PRIO_HEARTBEAT,
+  NET_PRIO_TELEMETRY,       // Status reports
+  NET_PRIO_COUNT
+};
+
+struct ScanRequest {
+  bool registration;
+  ScanTiming timing;        // detected/formatted stamped by the UI core
+  TagUid tag;
+  char location[32];
+};
+
+struct HeartbeatRequest {
+  bool manual;
+  DeviceStateSnapshot state;
+};
+
+struct SyncRequest {
+  bool includeStats;        // Heartbeat due: send the full stats block
+  DeviceStateSnapshot state;
+};
+
+struct StatusRequest {
+  char reason[32];
+  DeviceStateSnapshot state;  // As it was when the report was posted
+};
+
+struct ModeRequest {
+  bool registrationMode;
+  bool scanMode;
+  char pendingTagId[MAX_TAG_ID_LENGTH + 1];
+};
+
+struct NetRequest {
+  NetRequestType type;
+  unsigned long postedAt;   // Stamped by post(); deadlines and waits run from here
+  uint8_t attempts;         // Retries the scheduler has already made
+  union {
+    ScanRequest scan;
+    HeartbeatRequest heartbeat;
+    SyncRequest sync;
+    ModeRequest mode;
+    StatusRequest status;
+    int queueNumber;        // NET_REQ_QUEUE_OVERRIDE
+  };
+};
+
+// =======================
+// Network -> UI events
+// =======================
+
+enum NetEventType {
+  NET_EVT_SCAN_RESULT,      // HTTP result or WebSocket scan response
+  NET_EVT_HEARTBEAT,
+  NET_EVT_COMMANDS,
+  NET_EVT_MODE_RESULT,
+  NET_EVT_PROFILE_RESULT,
+  NET_EVT_OVERRIDE_RESULT,
+  NET_EVT_WS_CONFIG,        // Registration mode pushed over WebSocket
+  NET_EVT_WS_STATUS,        // WebSocket connected/disconnected
+  NET_EVT_LINK_STATUS,      // WiFi lost/reconnected
+  NET_EVT_BACKEND_STATUS    // Scan circuit opened (backend down) or answered again
+};
+
+struct ScanOutcome {
+  bool registration;
+  bool viaWebSocket;
+  ApiResult result;
+  int httpCode;
+  int consecutiveFailures;
+  bool hasVerdict;          // registered/userName are valid (WS success, HTTP 200/404)
+  bool registered;
+  ScanTiming timing;        // Pipeline stamps up to receivedUs (zero if unmatched)
+  TagUid tag;
+  char userName[32];
+  char userRole[16];
+  char error[40];
+};
+
+struct RequestOutcome {
+  bool ok;
+  bool manual;              // NET_EVT_HEARTBEAT
+  int httpCode;             // NET_EVT_OVERRIDE_RESULT
+  int queueNumber;          // NET_EVT_OVERRIDE_RESULT
+};
+
+struct ProfileOutcome {
+  bool ok;
+  bool requestedRegistration; // NET_EVT_MODE_RESULT
+  DeviceProfile profile;
+};
+
+enum LinkChange {
+  LINK_LOST,
+  LINK_RECONNECTED,
+  LINK_RECONNECT_FAILED
+};
+
+struct NetEvent {
+  NetEventType type;
+  union {
+    ScanOutcome scan;
+    RequestOutcome request;
+    ServerCommandSet commands;
+    ProfileOutcome profile;
+    bool connected;         // NET_EVT_WS_STATUS
+    bool registrationMode;  // NET_EVT_WS_CONFIG
+    LinkChange link;        // NET_EVT_LINK_STATUS
+    bool online;            // NET_EVT_BACKEND_STATUS
+  };
+};
+
+// =======================
+// Network Task
+// =======================
+
+// Live scan sent over the WebSocket and not yet answered. seq travels with
+// the message and comes back in its scan_result, so several can be in flight
+// and a response is matched to its tap. Network core only.
+struct WsInflightScan {
+  bool used;
+  uint32_t seq;
+  uint8_t sends;                   // First send included
+  unsigned long sentAt;            // millis() of the last send, for the ack timeout
+  uint32_t lastSentUs;             // micros() of the last send, for the RTT
+  ScanRequest scan;                // timing.sentUs is the first send
+};
+
+// Queue and statistics of one priority class
+struct NetPriorityClass {
+  QueueHandle_t queue;
+  bool hasRetry;                   // Failed request parked until retryAt (network core only)
+  unsigned long retryAt;
+  NetRequest retry;
+
+  // Statistics
+  volatile uint32_t handled;
+  volatile uint32_t dropped;       // Queue full at post()
+  volatile uint32_t expired;       // Past the class deadline, or superseded while parked
+  volatile uint32_t retried;
+  volatile uint32_t preempted;     // Due retry held back for higher-class work
+  volatile uint32_t waits;         // First sends, for the average below
+  volatile uint32_t totalWaitMs;   // Post to first send
+  volatile uint32_t maxWaitMs;
+};
+
+class NetworkTask {
+private:
+  NetworkModule* network;
+  ApiModule* api;
+  WebSocketModule* ws;
+  NetPriorityClass classes[NET_PRIO_COUNT];
+  QueueHandle_t eventQueue;
+  TaskHandle_t taskHandle;
+  unsigned long lastLinkCheck;
+  bool linkDown;                     // LINK_LOST published, reconnect not yet seen
+  bool linkFailReported;             // LINK_RECONNECT_FAILED published for this outage
+  bool backendOnline;                // Last NET_EVT_BACKEND_STATUS (scan circuit not open)
+
+  // Live scan path choice, fed by scan, heartbeat and sync round trips
+  TransportSelector transport;
+
+  // WebSocket scans awaiting their scan_result
+  WsInflightScan wsInflight[WS_SCAN_WINDOW];
+  uint32_t nextWsSeq;
+  LatencyHistogram wsScanRtt;        // Send to scan_result, first sends only
+  volatile uint32_t wsScansSent;
+  volatile uint32_t wsRetransmits;
+  volatile uint32_t wsFallbacks;     // Moved to HTTP after timeouts or a lost socket
+  volatile uint32_t wsWindowFull;    // Sent over HTTP because the window was full
+  volatile uint32_t wsLateResults;   // scan_result for a scan no longer in flight
+
+  // Offline journal drain: one batch per call, spaced by the batch RTT
+  unsigned long nextDrainAt;
+  unsigned long drainRttMs;          // EWMA of batch round trips
+  volatile unsigned long batchesSent;
+  volatile unsigned long batchesFailed;
+
+  // Status reports waiting for the next sync; sent one by one instead when
+  // the backend turns out to have no /sync endpoint
+  TelemetryEvent telemetry[SYNC_TELEMETRY_MAX];
+  int telemetryCount;
+  bool syncSupported;
+  unsigned long syncProbeAt;         // Next /sync attempt while syncSupported is false
+
+  // Registered-tag filter refresh (first check as soon as the link is up)
+  unsigned long nextFilterCheck;
+
+  // Periodic requests are coalesced: at most one of each type is queued
+  volatile bool pending[NET_REQ_TYPE_COUNT];
+
+  // Statistics
+  volatile unsigned long requestsHandled;
+  volatile unsigned long requestsDropped;
+  volatile unsigned long eventsDropped;
+
+  static NetworkTask* instance;
+  static void taskEntry(void* param);
+  void run();
+  bool nextRequest(NetRequest& request, NetPriority& priority);
+  bool takeFromClass(NetPriority priority, unsigned long now, NetRequest& request);
+  void expire(const NetRequest& request, NetPriority priority);
+  bool retryLater(const NetRequest& request, const ApiResponse& response);
+  unsigned long idleWait();
+  void handleRequest(const NetRequest& request);
+  void handleScan(const ScanRequest& scan);
+  void submitHttpScan(const ScanRequest& scan);
+  bool sendWsScan(const ScanRequest& scan);
+  bool transmitWsScan(WsInflightScan& slot);
+  WsInflightScan* findWsScan(uint32_t seq, const TagUid& tag);
+  void serviceWsScans();
+  void fallBackWsScan(WsInflightScan& slot, const char* why);
+  void handleSync(const SyncRequest& sync);
+  void bufferTelemetry(const char* reason);
+  void checkLink();
+  void serviceCircuits();
+  void serviceJournal();
+  bool liveTrafficPending();
+  void serviceTagFilter();
+  void writeStatus();
+
+  // WebSocket callbacks (invoked from ws->loop() on the network core)
+  static void onWsScanResponse(JsonDocument& doc);
+  static void onWsConfigUpdate(JsonDocument& doc);
+  static void onWsConnectionStatus(bool connected);
+  static bool onWsCommands(JsonDocument& doc);
+  static void onWsHeartbeatAck(uint32_t rttMs);
+
+  // Async HTTP scan results from ApiModule::serviceScanQueue()
+  static void onScanComplete(const ScanCompletion& completion);
+
+public:
+  NetworkTask();
+
+  bool begin(NetworkModule& networkModule, ApiModule& apiModule, WebSocketModule& wsModule);
+  bool isRunning() const { return taskHandle != nullptr; }
+
+  // UI core side (never blocks)
+  bool post(const NetRequest& request);
+  bool postCoalesced(const NetRequest& request);
+  bool isPending(NetRequestType type) const { return pending[type]; }
+  bool receive(NetEvent& event);
+
+  // Network core side
+  bool publish(const NetEvent& event);
+
+  // Diagnostics
+  unsigned long getRequestsHandled() const { return requestsHandled; }
+  unsigned long getRequestsDropped() const { return requestsDropped; }
+  unsigned long getEventsDropped() const { return eventsDropped; }
+  int getQueuedRequests() const;
+  int getQueuedRequests(NetPriority priority) const;
+  int getWsScansInFlight() const;
+  void reportWsScans(JsonObject obj) const;
+  void reportTransport(JsonObject obj) const { transport.report(obj); }
+  unsigned long getAverageWaitMs(NetPriority priority) const;
+  void reportQueues(JsonObject obj) const;
+  void printStatus();                // Printed by the network core, which owns the state
+};
+
+NetPriority priorityOf(const NetRequest& request);
+
+// Helpers for building requests on the UI core
+NetRequest makeScanRequest(const TagUid& tag, bool registration);
+NetRequest makeHeartbeatRequest(bool manual);
+NetRequest makeSyncRequest(bool includeStats);
+NetRequest makeStatusRequest(const char* reason);
+DeviceStateSnapshot captureDeviceState();
+
+extern NetworkTask networkTask;
+
+#endif // NETWORK_TASK_H
@@ -0,0 +1,235 @@
+#include "PN532Driver.h"
+
+// SPI operation byte sent at the start of every transaction
+static const uint8_t SPI_STATUS_READ = 0x02;
+static const uint8_t SPI_DATA_WRITE = 0x01;
+static const uint8_t SPI_DATA_READ = 0x03;
+
+// Frame identifiers (TFI)
+static const uint8_t TFI_HOST_TO_PN532 = 0xD4;
+static const uint8_t TFI_PN532_TO_HOST = 0xD5;
+
+static const uint8_t ACK_FRAME[6] = {0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
+
+// The PN532 shifts bytes LSB first
+static const SPISettings pn532SpiSettings(PN532_SPI_CLOCK, LSBFIRST, SPI_MODE0);
+
+PN532Driver::PN532Driver(SPIClass* spiBus, uint8_t ss, int irq)
+  : spi(spiBus), ssPin(ss), irqPin(irq), phase(PHASE_IDLE), command(0),
+    phaseStart(0), responseTimeout(0), responseLength(0), lastError(nullptr) {}
+
+void PN532Driver::begin() {
+  pinMode(ssPin, OUTPUT);
+
+  // Holding SS low for a couple of ms wakes the chip from power-down
+  digitalWrite(ssPin, LOW);
+  phase = PHASE_WAKING;
+  phaseStart = millis();
+  lastError = nullptr;
+}
+
+void PN532Driver::select() {
+  spi->beginTransaction(pn532SpiSettings);
+  digitalWrite(ssPin, LOW);
+}
+
+void PN532Driver::deselect() {
+  digitalWrite(ssPin, HIGH);
+  spi->endTransaction();
+}
+
+bool PN532Driver::sendCommand(uint8_t cmd, const uint8_t* params, uint8_t paramLength,
+                              unsigned long timeoutMs) {
+  if (isBusy()) {
+    return false;
+  }
+  if (paramLength > PN532_FRAME_MAX - 2) {
+    fail("Command too long");
+    return false;
+  }
+
+  uint8_t data[PN532_FRAME_MAX];
+  data[0] = TFI_HOST_TO_PN532;
+  data[1] = cmd;
+  if (paramLength > 0) {
+    memcpy(data + 2, params, paramLength);
+  }
+
+  command = cmd;
+  responseTimeout = timeoutMs;
+  responseLength = 0;
+  lastError = nullptr;
+
+  writeFrame(data, paramLength + 2);
+  phase = PHASE_WAIT_ACK;
+  phaseStart = millis();
+  return true;
+}
+
+PN532Status PN532Driver::poll() {
+  switch (phase) {
+    case PHASE_IDLE:
+      return PN532_STATUS_IDLE;
+
+    case PHASE_WAKING:
+      if (millis() - phaseStart < PN532_WAKE_MS) {
+        return PN532_STATUS_BUSY;
+      }
+      digitalWrite(ssPin, HIGH);
+      phase = PHASE_IDLE;
+      return PN532_STATUS_IDLE;
+
+    case PHASE_WAIT_ACK:
+      if (!isReady()) {
+        if (millis() - phaseStart > PN532_ACK_TIMEOUT) {
+          fail("ACK timeout");
+          return PN532_STATUS_ERROR;
+        }
+        return PN532_STATUS_BUSY;
+      }
+      if (!readAck()) {
+        fail("No ACK");
+        return PN532_STATUS_ERROR;
+      }
+      phase = PHASE_WAIT_RESPONSE;
+      phaseStart = millis();
+      return PN532_STATUS_BUSY;
+
+    case PHASE_WAIT_RESPONSE:
+      if (!isReady()) {
+        if (responseTimeout > 0 && millis() - phaseStart > responseTimeout) {
+          fail("Response timeout");
+          return PN532_STATUS_ERROR;
+        }
+        return PN532_STATUS_BUSY;
+      }
+      if (!readResponse()) {
+        return PN532_STATUS_ERROR;
+      }
+      phase = PHASE_DONE;
+      return PN532_STATUS_DONE;
+
+    case PHASE_DONE:
+      return PN532_STATUS_DONE;
+
+    case PHASE_ERROR:
+    default:
+      return PN532_STATUS_ERROR;
+  }
+}
+
+void PN532Driver::cancel() {
+  if (phase == PHASE_WAIT_ACK || phase == PHASE_WAIT_RESPONSE) {
+    // An ACK frame from the host aborts the command the PN532 is running
+    select();
+    spi->transfer(SPI_DATA_WRITE);
+    for (uint8_t i = 0; i < sizeof(ACK_FRAME); i++) {
+      spi->transfer(ACK_FRAME[i]);
+    }
+    deselect();
+  }
+  phase = PHASE_IDLE;
+}
+
+bool PN532Driver::isReady() {
+  if (irqPin >= 0) {
+    return digitalRead(irqPin) == LOW;
+  }
+
+  select();
+  spi->transfer(SPI_STATUS_READ);
+  uint8_t status = spi->transfer(0x00);
+  deselect();
+  return (status & 0x01) != 0;
+}
+
+void PN532Driver::writeFrame(const uint8_t* data, uint8_t length) {
+  uint8_t checksum = 0;
+
+  select();
+  spi->transfer(SPI_DATA_WRITE);
+  spi->transfer(0x00);                     // Preamble
+  spi->transfer(0x00);                     // Start code
+  spi->transfer(0xFF);
+  spi->transfer(length);                   // LEN
+  spi->transfer((uint8_t)(~length + 1));   // LCS
+  for (uint8_t i = 0; i < length; i++) {
+    spi->transfer(data[i]);
+    checksum += data[i];
+  }
+  spi->transfer((uint8_t)(~checksum + 1)); // DCS
+  spi->transfer(0x00);                     // Postamble
+  deselect();
+}
+
+bool PN532Driver::readAck() {
+  bool match = true;
+
+  select();
+  spi->transfer(SPI_DATA_READ);
+  for (uint8_t i = 0; i < sizeof(ACK_FRAME); i++) {
+    if (spi->transfer(0x00) != ACK_FRAME[i]) {
+      match = false;
+    }
+  }
+  deselect();
+  return match;
+}
+
+bool PN532Driver::readResponse() {
+  uint8_t body[PN532_FRAME_MAX];
+  uint8_t checksum = 0;
+
+  select();
+  spi->transfer(SPI_DATA_READ);
+
+  // Preamble (one or more 0x00) followed by the 0xFF start code
+  uint8_t value;
+  uint8_t zeros = 0;
+  while ((value = spi->transfer(0x00)) == 0x00 && zeros < 4) {
+    zeros++;
+  }
+  if (zeros == 0 || value != 0xFF) {
+    deselect();
+    fail("Bad preamble");
+    return false;
+  }
+
+  uint8_t length = spi->transfer(0x00);
+  uint8_t lengthChecksum = spi->transfer(0x00);
+  if ((uint8_t)(length + lengthChecksum) != 0 || length == 0 || length > PN532_FRAME_MAX) {
+    deselect();
+    fail("Bad frame length");
+    return false;
+  }
+
+  for (uint8_t i = 0; i < length; i++) {
+    body[i] = spi->transfer(0x00);
+    checksum += body[i];
+  }
+  uint8_t dataChecksum = spi->transfer(0x00);
+  spi->transfer(0x00);  // Postamble
+  deselect();
+
+  if ((uint8_t)(checksum + dataChecksum) != 0) {
+    fail("Bad checksum");
+    return false;
+  }
+  if (body[0] != TFI_PN532_TO_HOST) {
+    fail("Error frame");
+    return false;
+  }
+  if (length < 2 || body[1] != (uint8_t)(command + 1)) {
+    fail("Unexpected response");
+    return false;
+  }
+
+  responseLength = length - 2;
+  memcpy(response, body + 2, responseLength);
+  return true;
+}
+
+void PN532Driver::fail(const char* reason) {
+  lastError = reason;
+  phase = PHASE_ERROR;
+}
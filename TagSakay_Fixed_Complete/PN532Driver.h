@@ -0,0 +1,71 @@
+#ifndef PN532_DRIVER_H
+#define PN532_DRIVER_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "Config.h"
+
+// PN532 command codes used by RFIDModule
+#define PN532_CMD_GET_FIRMWARE_VERSION 0x02
+#define PN532_CMD_SAM_CONFIGURATION 0x14
+#define PN532_CMD_RF_CONFIGURATION 0x32
+#define PN532_CMD_INLIST_PASSIVE_TARGET 0x4A
+
+enum PN532Status {
+  PN532_STATUS_IDLE,   // Nothing in flight
+  PN532_STATUS_BUSY,   // Waking up or command in flight; keep calling poll()
+  PN532_STATUS_DONE,   // Response ready in getResponse()
+  PN532_STATUS_ERROR   // Timeout, NACK or malformed frame (see getLastError())
+};
+
+// Non-blocking PN532 driver over SPI. Each command is split into
+// send -> wait ACK -> wait response; poll() performs a status check plus at
+// most one frame transfer, so no call blocks for more than a few hundred
+// microseconds. With an IRQ pin the ready check is a GPIO read.
+class PN532Driver {
+private:
+  enum Phase {
+    PHASE_IDLE,
+    PHASE_WAKING,         // SS held low to wake the chip
+    PHASE_WAIT_ACK,
+    PHASE_WAIT_RESPONSE,
+    PHASE_DONE,
+    PHASE_ERROR
+  };
+
+  SPIClass* spi;
+  uint8_t ssPin;
+  int irqPin;             // -1: poll the SPI status byte instead
+  Phase phase;
+  uint8_t command;        // Command code in flight
+  unsigned long phaseStart;
+  unsigned long responseTimeout;  // 0 = wait indefinitely (card detection)
+  uint8_t response[PN532_FRAME_MAX];
+  uint8_t responseLength;
+  const char* lastError;
+
+  void select();
+  void deselect();
+  bool isReady();
+  void writeFrame(const uint8_t* data, uint8_t length);
+  bool readAck();
+  bool readResponse();
+  void fail(const char* reason);
+
+public:
+  PN532Driver(SPIClass* spiBus, uint8_t ss, int irq = -1);
+
+  void begin();           // Configures SS and starts the wake-up pulse
+  bool sendCommand(uint8_t cmd, const uint8_t* params, uint8_t paramLength,
+                   unsigned long timeoutMs = PN532_COMMAND_TIMEOUT);
+  PN532Status poll();
+  void cancel();          // Aborts the command in flight (host ACK frame)
+
+  bool isBusy() const { return phase == PHASE_WAKING || phase == PHASE_WAIT_ACK || phase == PHASE_WAIT_RESPONSE; }
+  bool isAwaitingResponse() const { return phase == PHASE_WAIT_RESPONSE; }
+  const uint8_t* getResponse() const { return response; }
+  uint8_t getResponseLength() const { return responseLength; }
+  const char* getLastError() const { return lastError; }
+};
+
+#endif // PN532_DRIVER_H
@@ -1,103 +1,303 @@
 #include "RFIDModule.h"
 #include "NetworkModule.h"
+#include "NetworkTask.h"
 #include "DisplayModule.h"
 #include "UARTModule.h"
 
 Adafruit_PN532 nfc(PN532_SCK, PN532_MISO, PN532_MOSI, PN532_SS);
 
+volatile bool RFIDModule::irqPending = false;
+volatile uint32_t RFIDModule::irqAtUs = 0;
+TaskHandle_t RFIDModule::notifyTask = nullptr;
+
 // RFIDModule Class Implementation
 RFIDModule::RFIDModule() 
-  : nfc(nullptr), hspi(nullptr), initialized(false), 
-    lastScannedTag(""), lastScanTime(0), consecutiveFailures(0) {}
+  : driver(nullptr), hspi(nullptr), state(RFID_STATE_OFF), stateSince(0),
+    initAttempts(0), firmwareVersion(0), initialized(false), 
+    lastScanTime(0), consecutiveFailures(0),
+    lastDetectUs(0), lastFormatUs(0), irqMode(false) {
+  lastScannedTag.clear();
+}
+
+void RFIDModule::begin() {
+  if (!driver) {
+    hspi = new SPIClass(HSPI);
+    hspi->begin(PN532_SCK, PN532_MISO, PN532_MOSI, PN532_SS);
+    driver = new PN532Driver(hspi, PN532_SS, RFID_USE_IRQ ? PN532_IRQ : -1);
+  }
+
+  if (RFID_USE_IRQ && !irqMode) {
+    // GPIO 34-39 have no internal pull-up, so the PN532 board must supply
+    // one (most breakouts fit a 10k on IRQ); without it the line floats
+    pinMode(PN532_IRQ, INPUT);
+    notifyTask = xTaskGetCurrentTaskHandle();  // loop() task, woken from the ISR
+    attachInterrupt(digitalPinToInterrupt(PN532_IRQ), onIrq, FALLING);
+    irqMode = true;
+    Serial.printf("[RFID] IRQ mode on GPIO %d\n", PN532_IRQ);
+  }
+
+  initialized = false;
+  initAttempts = 0;
+  driver->begin();
+  enterState(RFID_STATE_WAKING);
+}
 
 bool RFIDModule::initialize() {
   Serial.println("[RFID] Initializing PN532...");
-  
-  hspi = new SPIClass(HSPI);
-  hspi->begin(PN532_SCK, PN532_MISO, PN532_MOSI, PN532_SS);
-  
-  nfc = new Adafruit_PN532(PN532_SS, hspi);
-  nfc->begin();
+  begin();
+
+  // Only setup() waits on the sequence; each step is still a short poll
+  unsigned long start = millis();
+  TagUid unused;
+  while (!initialized && state != RFID_STATE_FAILED &&
+         millis() - start < RFID_INIT_TIMEOUT) {
+    service(unused);
+    yield();
+  }
 
-  uint32_t versiondata = nfc->getFirmwareVersion();
-  if (!versiondata) {
+  if (!initialized) {
     Serial.println("[RFID] ERROR: PN532 not found!");
-    initialized = false;
+    driver->cancel();
+    enterState(RFID_STATE_FAILED);
     return false;
   }
-  
+
   Serial.print("[RFID] Found chip PN5");
-  Serial.println((versiondata >> 24) & 0xFF, HEX);
+  Serial.println((firmwareVersion >> 24) & 0xFF, HEX);
   Serial.print("[RFID] Firmware v");
-  Serial.print((versiondata >> 16) & 0xFF, DEC);
+  Serial.print((firmwareVersion >> 16) & 0xFF, DEC);
   Serial.print(".");
-  Serial.println((versiondata >> 8) & 0xFF, DEC);
-  
-  // Configure SAM with retry logic
-  int retries = 0;
-  while (!nfc->SAMConfig() && retries < RFID_RETRY_ATTEMPTS) {
-    Serial.println("[RFID] SAMConfig failed, retrying...");
-    delay(100);
-    retries++;
+  Serial.println((firmwareVersion >> 8) & 0xFF, DEC);
+  Serial.println("[RFID] Initialized successfully");
+  return true;
+}
+
+void IRAM_ATTR RFIDModule::onIrq() {
+  irqAtUs = micros();
+  irqPending = true;
+
+  // Cut the loop's idle wait short so the card is read right away
+  if (notifyTask) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(notifyTask, &woken);
+    if (woken) {
+      portYIELD_FROM_ISR();
+    }
   }
-  
-  if (retries >= RFID_RETRY_ATTEMPTS) {
-    Serial.println("[RFID] ERROR: SAMConfig failed after retries");
+}
+
+void RFIDModule::enterState(RFIDState next) {
+  state = next;
+  stateSince = millis();
+}
+
+void RFIDModule::initStepFailed(const char* step) {
+  const char* reason = driver->getLastError();
+  Serial.printf("[RFID] %s failed (%s)\n", step, reason ? reason : "unknown");
+  driver->cancel();
+
+  initAttempts++;
+  if (initAttempts >= RFID_RETRY_ATTEMPTS) {
+    Serial.println("[RFID] ERROR: PN532 init failed after retries");
     initialized = false;
-    return false;
+    enterState(RFID_STATE_FAILED);
+    return;
   }
+  enterState(RFID_STATE_RETRY_WAIT);
+}
 
-  Serial.println("[RFID] Initialized successfully");
-  initialized = true;
+void RFIDModule::restartInit() {
+  Serial.println("[RFID] Reader not responding - reinitializing");
+  driver->cancel();
+  initAttempts = 0;
   consecutiveFailures = 0;
+  driver->begin();
+  enterState(RFID_STATE_WAKING);
+}
+
+bool RFIDModule::armDetection() {
+  // MaxTg 1, 106 kbps type A. With infinite passive activation retries the
+  // response only arrives once a card is in the field, so waiting for it
+  // costs one status poll (or nothing, in IRQ mode) per call.
+  static const uint8_t params[] = { 0x01, 0x00 };
+  if (!driver->sendCommand(PN532_CMD_INLIST_PASSIVE_TARGET, params, sizeof(params), 0)) {
+    return false;
+  }
+
+  // The ACK handshake itself pulses IRQ; only edges after arming count
+  irqPending = false;
+  enterState(RFID_STATE_DETECTING);
   return true;
 }
 
-String RFIDModule::readTag() {
+bool RFIDModule::service(TagUid& tag) {
+  if (!driver) {
+    return false;
+  }
+
+  PN532Status status = driver->poll();
+
+  switch (state) {
+    case RFID_STATE_WAKING:
+      if (status == PN532_STATUS_IDLE) {
+        driver->sendCommand(PN532_CMD_GET_FIRMWARE_VERSION, nullptr, 0);
+        enterState(RFID_STATE_GET_VERSION);
+      }
+      break;
+
+    case RFID_STATE_GET_VERSION:
+      if (status == PN532_STATUS_DONE) {
+        const uint8_t* response = driver->getResponse();
+        if (driver->getResponseLength() < 4) {
+          initStepFailed("GetFirmwareVersion");
+          break;
+        }
+        firmwareVersion = ((uint32_t)response[0] << 24) | ((uint32_t)response[1] << 16) |
+                          ((uint32_t)response[2] << 8) | response[3];
+
+        // Normal mode, 1 s virtual card timeout, drive the IRQ line
+        static const uint8_t samParams[] = { 0x01, 0x14, 0x01 };
+        driver->sendCommand(PN532_CMD_SAM_CONFIGURATION, samParams, sizeof(samParams));
+        enterState(RFID_STATE_SAM_CONFIG);
+      } else if (status == PN532_STATUS_ERROR) {
+        initStepFailed("GetFirmwareVersion");
+      }
+      break;
+
+    case RFID_STATE_SAM_CONFIG:
+      if (status == PN532_STATUS_DONE) {
+        // CfgItem 5: MxRtyATR, MxRtyPSL, MxRtyPassiveActivation (0xFF = forever)
+        static const uint8_t retryParams[] = { 0x05, 0xFF, 0x01, 0xFF };
+        driver->sendCommand(PN532_CMD_RF_CONFIGURATION, retryParams, sizeof(retryParams));
+        enterState(RFID_STATE_SET_RETRIES);
+      } else if (status == PN532_STATUS_ERROR) {
+        initStepFailed("SAMConfig");
+      }
+      break;
+
+    case RFID_STATE_SET_RETRIES:
+      if (status == PN532_STATUS_DONE) {
+        initialized = true;
+        initAttempts = 0;
+        consecutiveFailures = 0;
+        enterState(RFID_STATE_READY);
+      } else if (status == PN532_STATUS_ERROR) {
+        initStepFailed("RFConfiguration");
+      }
+      break;
+
+    case RFID_STATE_READY:
+      if (!armDetection()) {
+        Serial.println("[RFID] WARNING: Could not arm detection - will retry");
+      }
+      break;
+
+    case RFID_STATE_DETECTING:
+      if (status == PN532_STATUS_DONE) {
+        // Re-armed on the next call, after debounce has a chance to run
+        enterState(RFID_STATE_READY);
+        if (parseTarget(tag)) {
+          return true;
+        }
+      } else if (status == PN532_STATUS_ERROR) {
+        consecutiveFailures++;
+        Serial.printf("[RFID] Read failed (%s)\n",
+                      driver->getLastError() ? driver->getLastError() : "unknown");
+        driver->cancel();
+        if (consecutiveFailures >= RFID_RETRY_ATTEMPTS) {
+          restartInit();
+        } else {
+          enterState(RFID_STATE_READY);
+        }
+      } else if (millis() - stateSince > RFID_REARM_INTERVAL) {
+        // Armed so long that the PN532 may have lost the command
+        driver->cancel();
+        enterState(RFID_STATE_READY);
+      }
+      break;
+
+    case RFID_STATE_RETRY_WAIT:
+      if (millis() - stateSince >= RFID_RETRY_DELAY) {
+        driver->begin();
+        enterState(RFID_STATE_WAKING);
+      }
+      break;
+
+    case RFID_STATE_OFF:
+    case RFID_STATE_FAILED:
+    default:
+      break;
+  }
+
+  return false;
+}
+
+bool RFIDModule::parseTarget(TagUid& tag) {
+  // NbTg, Tg, SENS_RES (2), SEL_RES, NFCIDLength, NFCID1...
+  const uint8_t* response = driver->getResponse();
+  uint8_t length = driver->getResponseLength();
+  if (length < 6 || response[0] != 1) {
+    return false;
+  }
+
+  uint8_t idLength = response[5];
+  if (length < 6 + idLength) {
+    return false;
+  }
+  return tag.set(response + 6, idLength);
+}
+
+bool RFIDModule::readTag(TagUid& tag) {
   if (!initialized) {
     Serial.println("[RFID] ERROR: Not initialized");
     consecutiveFailures++;
-    return "";
+    return false;
   }
-  
-  uint8_t uid[7] = {0, 0, 0, 0, 0, 0, 0};
-  uint8_t uidLength;
 
-  bool success = nfc->readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, RFID_SCAN_TIMEOUT);
+  // Detection happened at the interrupt, not when this task got to run
+  bool irqSeen = irqPending;
+  uint32_t irqUs = irqAtUs;
+  irqPending = false;
 
-  if (success) {
-    String tagId = "";
-    for (uint8_t i = 0; i < uidLength; i++) {
-      if (uid[i] < 0x10) tagId += "0";
-      tagId += String(uid[i], HEX);
-    }
-    tagId.toUpperCase();
-    consecutiveFailures = 0;
-    return tagId;
+  if (!service(tag)) {
+    return false;
   }
 
-  return "";
+  lastDetectUs = (irqMode && irqSeen) ? irqUs : micros();
+  lastFormatUs = micros();
+  consecutiveFailures = 0;
+  return true;
+}
+
+ScanTiming RFIDModule::getLastReadTiming() const {
+  ScanTiming timing;
+  memset(&timing, 0, sizeof(timing));
+  timing.detectedUs = lastDetectUs;
+  timing.formattedUs = lastFormatUs;
+  return timing;
 }
 
-bool RFIDModule::scanWithDebounce(String& tagId, unsigned long debounceMs) {
+bool RFIDModule::scanWithDebounce(TagUid& tag, unsigned long windowMs) {
   if (!initialized) {
     Serial.println("[RFID] ERROR: Not initialized");
     return false;
   }
   
-  String scannedTag = readTag();
+  TagUid scanned;
+  if (!readTag(scanned)) {
+    return false;
+  }
   
-  if (scannedTag.length() > 0) {
-    unsigned long currentTime = millis();
-    if (scannedTag != lastScannedTag || (currentTime - lastScanTime) > debounceMs) {
-      lastScannedTag = scannedTag;
-      lastScanTime = currentTime;
-      tagId = scannedTag;
-      return true;
-    }
+  // Every tag accepted within the window is remembered, not just the last one
+  unsigned long currentTime = millis();
+  if (recentScans.isDuplicate(scanned, windowMs, currentTime)) {
+    return false;
   }
   
-  return false;
+  lastScannedTag = scanned;
+  lastScanTime = currentTime;
+  tag = scanned;
+  return true;
 }
 
 bool RFIDModule::testConnection() {
@@ -105,8 +305,8 @@ bool RFIDModule::testConnection() {
     return false;
   }
   
-  uint32_t versiondata = nfc->getFirmwareVersion();
-  return (versiondata != 0);
+  // A failing reader drops out of READY/DETECTING into re-init
+  return state == RFID_STATE_READY || state == RFID_STATE_DETECTING;
 }
 
 String RFIDModule::getFirmwareVersion() {
@@ -114,15 +314,14 @@ String RFIDModule::getFirmwareVersion() {
     return "Not initialized";
   }
   
-  uint32_t versiondata = nfc->getFirmwareVersion();
-  if (!versiondata) {
+  if (!firmwareVersion) {
     return "Error reading version";
   }
   
   String version = "v";
-  version += String((versiondata >> 16) & 0xFF, DEC);
+  version += String((firmwareVersion >> 16) & 0xFF, DEC);
   version += ".";
-  version += String((versiondata >> 8) & 0xFF, DEC);
+  version += String((firmwareVersion >> 8) & 0xFF, DEC);
   
   return version;
 }
@@ -206,7 +405,7 @@ void handleRFIDLoop() {
           expectedRegistrationTagId = "";
 
           // Report successful registration
-          reportDeviceStatus("registration_complete");
+          networkTask.post(makeStatusRequest("registration_complete"));
 
           delay(2000);
           indicateReady();
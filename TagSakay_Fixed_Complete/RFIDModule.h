@@ -6,34 +6,81 @@
 #include <SPI.h>
 #include <Adafruit_PN532.h>
 #include "Config.h"
+#include "LatencyStats.h"
+#include "PN532Driver.h"
+#include "TagUid.h"
+#include "ScanDedup.h"
+
+// Reader lifecycle. Every state is advanced by service(), which costs at most
+// one PN532Driver::poll() - there is no blocking SPI exchange after begin().
+enum RFIDState {
+  RFID_STATE_OFF,
+  RFID_STATE_WAKING,        // SS wake-up pulse
+  RFID_STATE_GET_VERSION,
+  RFID_STATE_SAM_CONFIG,
+  RFID_STATE_SET_RETRIES,   // RFConfiguration: retry passive activation forever
+  RFID_STATE_READY,         // Configured, detection not armed
+  RFID_STATE_DETECTING,     // InListPassiveTarget armed, waiting for a card
+  RFID_STATE_RETRY_WAIT,    // Init step failed, backing off
+  RFID_STATE_FAILED
+};
 
 class RFIDModule {
 private:
-  Adafruit_PN532* nfc;
+  PN532Driver* driver;
   SPIClass* hspi;
+  RFIDState state;
+  unsigned long stateSince;
+  int initAttempts;
+  uint32_t firmwareVersion;  // IC << 24 | Ver << 16 | Rev << 8 | Support
   bool initialized;
-  String lastScannedTag;
+  TagUid lastScannedTag;
   unsigned long lastScanTime;
+  ScanDedupTable recentScans;
   int consecutiveFailures;
+  uint32_t lastDetectUs;   // Pipeline timestamps of the last successful read
+  uint32_t lastFormatUs;
+  
+  // IRQ mode: the PN532 pulls IRQ low when a response (a card) is ready, so
+  // idle reads cost one GPIO read instead of an SPI status exchange
+  bool irqMode;
+  static volatile bool irqPending;
+  static volatile uint32_t irqAtUs;
+  static TaskHandle_t notifyTask;
+  static void IRAM_ATTR onIrq();
+
+  void enterState(RFIDState next);
+  void initStepFailed(const char* step);
+  void restartInit();
+  bool armDetection();
+  bool service(TagUid& tag);
+  bool parseTarget(TagUid& tag);
   
 public:
   RFIDModule();
   
-  bool initialize();
+  void begin();        // Non-blocking: starts the init sequence
+  bool initialize();   // Boot-time: begin() and pump until ready or failed
   bool isInitialized() const { return initialized; }
+  bool isIrqMode() const { return irqMode; }
+  bool isCardPending() const { return irqPending; }  // IRQ fired, UID not read yet
+  RFIDState getState() const { return state; }
   
   // Scanning operations
-  String readTag();
-  bool scanWithDebounce(String& tagId, unsigned long debounceMs = RFID_DEBOUNCE_MS);
+  bool readTag(TagUid& tag);
+  bool scanWithDebounce(TagUid& tag, unsigned long windowMs = DUPLICATE_SCAN_WINDOW);
   
   // State management
-  String getLastScannedTag() const { return lastScannedTag; }
+  const TagUid& getLastScannedTag() const { return lastScannedTag; }
   unsigned long getLastScanTime() const { return lastScanTime; }
-  void clearLastScan() { lastScannedTag = ""; lastScanTime = 0; }
+  void clearLastScan() { lastScannedTag.clear(); lastScanTime = 0; recentScans.clear(); }
+  uint32_t getDuplicatesSuppressed() const { return recentScans.getSuppressedCount(); }
+  int getRecentTagCount() const { return recentScans.getLiveCount(millis()); }
   int getConsecutiveFailures() const { return consecutiveFailures; }
+  ScanTiming getLastReadTiming() const;
   void resetFailureCount() { consecutiveFailures = 0; }
   
-  // Diagnostics
+  // Diagnostics (cached at init; no SPI traffic)
   bool testConnection();
   String getFirmwareVersion();
 };
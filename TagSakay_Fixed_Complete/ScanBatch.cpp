@@ -0,0 +1,57 @@
+#include "ScanBatch.h"
+
+static const char BATCH_OPEN[] = "{\"journal\":\"%08lx\",\"scans\":[";
+static const char BATCH_CLOSE[] = "]}";
+
+ScanBatchWriter::ScanBatchWriter(char* buffer, size_t capacity, uint32_t journalId)
+  : buffer(buffer), capacity(capacity), journalId(journalId) {
+  reset();
+}
+
+void ScanBatchWriter::reset() {
+  count = 0;
+  firstSequence = 0;
+  lastSequence = 0;
+  int opened = snprintf(buffer, capacity, BATCH_OPEN, (unsigned long)journalId);
+  length = opened > 0 && (size_t)opened < capacity ? opened : 0;
+}
+
+bool ScanBatchWriter::add(const JournalRecord& record) {
+  TagUid tag;
+  if (!tag.set(record.uid, record.uidLength)) {
+    return false;
+  }
+
+  char item[96];
+  int itemLength;
+  if (record.flags & JOURNAL_FLAG_EPOCH_VALID) {
+    itemLength = snprintf(item, sizeof(item), "%s{\"seq\":%lu,\"tagId\":\"%s\",\"scannedAt\":%lu,\"offline\":%s}",
+                          count > 0 ? "," : "", (unsigned long)record.sequence, tag.toText().c_str(),
+                          (unsigned long)record.epoch,
+                          (record.flags & JOURNAL_FLAG_OFFLINE) ? "true" : "false");
+  } else {
+    itemLength = snprintf(item, sizeof(item), "%s{\"seq\":%lu,\"tagId\":\"%s\",\"offline\":%s}",
+                          count > 0 ? "," : "", (unsigned long)record.sequence, tag.toText().c_str(),
+                          (record.flags & JOURNAL_FLAG_OFFLINE) ? "true" : "false");
+  }
+
+  // Leave room for the closing brackets and the terminator
+  if (itemLength <= 0 || length + itemLength + sizeof(BATCH_CLOSE) > capacity) {
+    return false;
+  }
+
+  memcpy(buffer + length, item, itemLength + 1);
+  length += itemLength;
+  if (count == 0) {
+    firstSequence = record.sequence;
+  }
+  lastSequence = record.sequence;
+  count++;
+  return true;
+}
+
+const char* ScanBatchWriter::finish() {
+  memcpy(buffer + length, BATCH_CLOSE, sizeof(BATCH_CLOSE));
+  length += sizeof(BATCH_CLOSE) - 1;
+  return buffer;
+}
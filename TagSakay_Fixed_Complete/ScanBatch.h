@@ -0,0 +1,43 @@
+#ifndef SCAN_BATCH_H
+#define SCAN_BATCH_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "TagUid.h"
+#include "ScanJournal.h"
+
+// Writes journal records into a caller-owned buffer as the body of
+// POST /api/rfid/batch-scan:
+//
+//   {"journal":"1a2b3c4d","scans":[{"seq":41,"tagId":"04A1B2C3","scannedAt":1718000000,"offline":true},...]}
+//
+// journal is the journal's random ID (hex); the backend deduplicates on it
+// together with seq. scannedAt is only present when the record's clock was
+// synced. The device is
+// identified by its API key, so the body does not repeat the device ID.
+// add() refuses a record that would overflow the buffer, which bounds a batch
+// by bytes as well as by count; the body is always closed and valid JSON.
+class ScanBatchWriter {
+private:
+  char* buffer;
+  size_t capacity;
+  uint32_t journalId;
+  size_t length;
+  int count;
+  uint32_t firstSequence;
+  uint32_t lastSequence;
+
+public:
+  ScanBatchWriter(char* buffer, size_t capacity, uint32_t journalId);
+
+  void reset();
+  bool add(const JournalRecord& record);
+  const char* finish();              // Closes the JSON; add() may not follow
+
+  int getCount() const { return count; }
+  size_t getLength() const { return length; }
+  uint32_t getFirstSequence() const { return firstSequence; }
+  uint32_t getLastSequence() const { return lastSequence; }
+};
+
+#endif // SCAN_BATCH_H
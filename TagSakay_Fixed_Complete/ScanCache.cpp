@@ -0,0 +1,92 @@
+#include "ScanCache.h"
+
+ScanResultCache::ScanResultCache()
+  : useClock(0), hits(0), misses(0), expired(0), corrected(0), evictions(0) {
+  clear();
+}
+
+ScanResultCache::Entry* ScanResultCache::find(const TagUid& tag) {
+  for (int i = 0; i < SCAN_CACHE_SIZE; i++) {
+    if (!entries[i].tag.isEmpty() && entries[i].tag == tag) {
+      return &entries[i];
+    }
+  }
+  return nullptr;
+}
+
+const ScanResultCache::Entry* ScanResultCache::lookup(const TagUid& tag, unsigned long now) {
+  Entry* entry = find(tag);
+  if (!entry) {
+    misses++;
+    return nullptr;
+  }
+
+  if (now - entry->storedAt >= SCAN_CACHE_TTL) {
+    // Too old to show; the slot is refilled when the server answers
+    expired++;
+    misses++;
+    entry->tag.clear();
+    return nullptr;
+  }
+
+  hits++;
+  entry->lastUsed = ++useClock;
+  entry->shown = true;
+  return entry;
+}
+
+ScanCacheUpdate ScanResultCache::store(const TagUid& tag, bool registered, const char* userName,
+                                       const char* userRole, unsigned long now) {
+  ScanCacheUpdate update = SCAN_CACHE_NOT_SHOWN;
+  Entry* entry = find(tag);
+
+  if (entry && entry->shown) {
+    bool same = entry->registered == registered &&
+                strncmp(entry->userName, userName, sizeof(entry->userName) - 1) == 0;
+    update = same ? SCAN_CACHE_CONFIRMED : SCAN_CACHE_CORRECTED;
+    if (!same) {
+      corrected++;
+    }
+  }
+
+  if (!entry) {
+    // Free slot first, otherwise the least recently used one
+    entry = &entries[0];
+    for (int i = 0; i < SCAN_CACHE_SIZE; i++) {
+      if (entries[i].tag.isEmpty()) {
+        entry = &entries[i];
+        break;
+      }
+      if (entries[i].lastUsed < entry->lastUsed) {
+        entry = &entries[i];
+      }
+    }
+    if (!entry->tag.isEmpty()) {
+      evictions++;
+    }
+  }
+
+  entry->tag = tag;
+  entry->registered = registered;
+  entry->shown = false;
+  strlcpy(entry->userName, userName, sizeof(entry->userName));
+  strlcpy(entry->userRole, userRole, sizeof(entry->userRole));
+  entry->storedAt = now;
+  entry->lastUsed = ++useClock;
+  return update;
+}
+
+void ScanResultCache::invalidate(const TagUid& tag) {
+  Entry* entry = find(tag);
+  if (entry) {
+    entry->tag.clear();
+  }
+}
+
+void ScanResultCache::clear() {
+  for (int i = 0; i < SCAN_CACHE_SIZE; i++) {
+    entries[i].tag.clear();
+    entries[i].shown = false;
+    entries[i].lastUsed = 0;
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef SCAN_CACHE_H
+#define SCAN_CACHE_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "TagUid.h"
+
+enum ScanCacheUpdate {
+  SCAN_CACHE_NOT_SHOWN,     // Nothing was shown from the cache for this tag
+  SCAN_CACHE_CONFIRMED,     // Server agreed with the result already on screen
+  SCAN_CACHE_CORRECTED      // Server disagreed; the screen must be redrawn
+};
+
+// Last server verdict per tag, so a repeat tap is answered from RAM in
+// microseconds while the authoritative request runs in the background.
+// SCAN_CACHE_SIZE entries, least recently used evicted first; entries older
+// than SCAN_CACHE_TTL are never shown. A linear scan over a handful of
+// entries beats any index at this size. UI core only; the counters are
+// plain words so the heartbeat may read them from the network core.
+class ScanResultCache {
+public:
+  struct Entry {
+    TagUid tag;               // Empty: free slot
+    bool registered;
+    bool shown;               // Shown from cache, server answer still pending
+    char userName[32];
+    char userRole[16];
+    unsigned long storedAt;
+    uint32_t lastUsed;        // LRU clock value
+  };
+
+private:
+  Entry entries[SCAN_CACHE_SIZE];
+  uint32_t useClock;
+
+  // Statistics
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t expired;           // Entry found but past its TTL (also a miss)
+  uint32_t corrected;         // Cached result shown, then contradicted
+  uint32_t evictions;
+
+  Entry* find(const TagUid& tag);
+
+public:
+  ScanResultCache();
+
+  // Fresh entry for the tag (marked as shown), or nullptr
+  const Entry* lookup(const TagUid& tag, unsigned long now);
+
+  // Record the server's verdict and compare it with what the cache showed
+  ScanCacheUpdate store(const TagUid& tag, bool registered, const char* userName,
+                        const char* userRole, unsigned long now);
+
+  void invalidate(const TagUid& tag);
+  void clear();
+
+  uint32_t getHits() const { return hits; }
+  uint32_t getMisses() const { return misses; }
+  uint32_t getExpired() const { return expired; }
+  uint32_t getCorrected() const { return corrected; }
+  uint32_t getEvictions() const { return evictions; }
+};
+
+extern ScanResultCache scanCache;
+
+#endif // SCAN_CACHE_H
@@ -0,0 +1,85 @@
+#include "ScanDedup.h"
+
+static_assert((SCAN_DEDUP_TABLE_SIZE & (SCAN_DEDUP_TABLE_SIZE - 1)) == 0,
+              "SCAN_DEDUP_TABLE_SIZE must be a power of two");
+static_assert(SCAN_DEDUP_MAX_PROBE <= SCAN_DEDUP_TABLE_SIZE,
+              "Probe window larger than the table");
+
+static const uint32_t SLOT_MASK = SCAN_DEDUP_TABLE_SIZE - 1;
+
+ScanDedupTable::ScanDedupTable() {
+  clear();
+}
+
+uint32_t ScanDedupTable::hash(const TagUid& tag) {
+  // UIDs are mostly random already; fold the words and finish with a mixer
+  uint32_t h = tag.words[0] ^ (tag.words[1] * 0x9E3779B1u) ^ (tag.words[2] * 0x85EBCA77u) ^ tag.length;
+  h ^= h >> 16;
+  h *= 0x7FEB352Du;
+  h ^= h >> 15;
+  return h;
+}
+
+bool ScanDedupTable::isDuplicate(const TagUid& tag, unsigned long windowMs, unsigned long now) {
+  uint32_t start = hash(tag) & SLOT_MASK;
+  int freeSlot = -1;
+  uint32_t oldestSlot = start;
+
+  for (uint32_t probe = 0; probe < SCAN_DEDUP_MAX_PROBE; probe++) {
+    uint32_t slot = (start + probe) & SLOT_MASK;
+    Entry& entry = entries[slot];
+
+    if (entry.tag.isEmpty()) {
+      // Never used: nothing further along this chain
+      if (freeSlot < 0) {
+        freeSlot = slot;
+      }
+      break;
+    }
+
+    if (entry.tag == tag) {
+      if (isLive(entry, now)) {
+        suppressed++;
+        return true;
+      }
+      entry.expiresAt = now + windowMs;
+      return false;
+    }
+
+    if (freeSlot < 0 && !isLive(entry, now)) {
+      freeSlot = slot;
+    }
+    if ((long)(entry.expiresAt - entries[oldestSlot].expiresAt) < 0) {
+      oldestSlot = slot;
+    }
+  }
+
+  if (freeSlot < 0) {
+    // Probe window full of live tags: displace the one closest to expiry
+    freeSlot = oldestSlot;
+    evictions++;
+  }
+
+  entries[freeSlot].tag = tag;
+  entries[freeSlot].expiresAt = now + windowMs;
+  return false;
+}
+
+void ScanDedupTable::clear() {
+  for (int i = 0; i < SCAN_DEDUP_TABLE_SIZE; i++) {
+    entries[i].tag.clear();
+    entries[i].expiresAt = 0;
+  }
+  suppressed = 0;
+  evictions = 0;
+}
+
+int ScanDedupTable::getLiveCount(unsigned long now) const {
+  int live = 0;
+  for (int i = 0; i < SCAN_DEDUP_TABLE_SIZE; i++) {
+    if (isLive(entries[i], now)) {
+      live++;
+    }
+  }
+  return live;
+}
@@ -0,0 +1,42 @@
+#ifndef SCAN_DEDUP_H
+#define SCAN_DEDUP_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "TagUid.h"
+
+// Recently accepted tags with expiry times, so any number of cards tapped
+// in turn are each suppressed for the duplicate window (a single "last tag"
+// is defeated by two passengers alternating). Open addressing with a bounded
+// linear probe: every lookup touches at most SCAN_DEDUP_MAX_PROBE slots.
+// Expired slots are reused in place; a slot that was never used ends a
+// probe chain. UI core only.
+class ScanDedupTable {
+private:
+  struct Entry {
+    TagUid tag;               // Empty: never used
+    unsigned long expiresAt;
+  };
+
+  Entry entries[SCAN_DEDUP_TABLE_SIZE];
+  uint32_t suppressed;        // Duplicate taps rejected
+  uint32_t evictions;         // Live entries displaced by a full probe window
+
+  static uint32_t hash(const TagUid& tag);
+  static bool isLive(const Entry& entry, unsigned long now) {
+    return !entry.tag.isEmpty() && (long)(entry.expiresAt - now) > 0;
+  }
+
+public:
+  ScanDedupTable();
+
+  // True if the tag was accepted less than windowMs ago; otherwise records it
+  bool isDuplicate(const TagUid& tag, unsigned long windowMs, unsigned long now);
+  void clear();
+
+  uint32_t getSuppressedCount() const { return suppressed; }
+  uint32_t getEvictionCount() const { return evictions; }
+  int getLiveCount(unsigned long now) const;
+};
+
+#endif // SCAN_DEDUP_H
@@ -0,0 +1,449 @@
+#include "ScanJournal.h"
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+static_assert(sizeof(JournalRecord) == 32, "Journal records must stay 32 bytes");
+
+static const uint32_t ACK_MAGIC = 0x4B414A53;  // "SJAK"
+static const uint32_t ID_MAGIC = 0x44494A53;   // "SJID"
+
+// Contents of scans.ack and scans.id
+struct WordRecord {
+  uint32_t magic;
+  uint32_t value;
+  uint32_t crc;
+};
+
+ScanJournal::ScanJournal()
+  : file(nullptr), mutex(nullptr), ready(false), maxRecords(0), groupSize(1),
+    commitIntervalMs(0), grouped(0), committing(0), groupStartedMs(0), recordCount(0),
+    firstPending(0), nextSequence(1), ackedSequence(0), journalId(0), dropped(0), corrupted(0) {
+  journalPath[0] = '\0';
+  journalTempPath[0] = '\0';
+  ackPath[0] = '\0';
+  ackTempPath[0] = '\0';
+  idPath[0] = '\0';
+  idTempPath[0] = '\0';
+}
+
+ScanJournal::~ScanJournal() {
+  end();
+}
+
+bool ScanJournal::begin(const char* directory, uint32_t maxRecords, uint8_t groupSize,
+                        uint32_t commitIntervalMs) {
+  end();
+
+  snprintf(journalPath, sizeof(journalPath), "%s/scans.jnl", directory);
+  snprintf(journalTempPath, sizeof(journalTempPath), "%s/scans.jnl.tmp", directory);
+  snprintf(ackPath, sizeof(ackPath), "%s/scans.ack", directory);
+  snprintf(ackTempPath, sizeof(ackTempPath), "%s/scans.ack.tmp", directory);
+  snprintf(idPath, sizeof(idPath), "%s/scans.id", directory);
+  snprintf(idTempPath, sizeof(idTempPath), "%s/scans.id.tmp", directory);
+
+  this->maxRecords = maxRecords;
+  this->groupSize = groupSize == 0 ? 1 : (groupSize > JOURNAL_GROUP_MAX ? JOURNAL_GROUP_MAX : groupSize);
+  this->commitIntervalMs = commitIntervalMs;
+  grouped = 0;
+
+#ifdef ARDUINO
+  if (!mutex) {
+    mutex = xSemaphoreCreateMutex();
+  }
+#endif
+
+  ready = recover();
+  return ready;
+}
+
+void ScanJournal::end() {
+  if (file) {
+    commitGroup();
+    fclose(file);
+    file = nullptr;
+  }
+  ready = false;
+}
+
+void ScanJournal::lock() {
+#ifdef ARDUINO
+  if (mutex) {
+    xSemaphoreTake((SemaphoreHandle_t)mutex, portMAX_DELAY);
+  }
+#endif
+}
+
+void ScanJournal::unlock() {
+#ifdef ARDUINO
+  if (mutex) {
+    xSemaphoreGive((SemaphoreHandle_t)mutex);
+  }
+#endif
+}
+
+// ===================================
+// Recovery and compaction
+// ===================================
+
+bool ScanJournal::recover() {
+  // A leftover temp file means compaction was cut short before the rename;
+  // the original journal is still intact
+  remove(journalTempPath);
+  remove(ackTempPath);
+  remove(idTempPath);
+
+  if (!readAck(ackedSequence)) {
+    ackedSequence = 0;
+  }
+
+  file = fopen(journalPath, "a+b");
+  if (!file) {
+    return false;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  uint32_t fullRecords = size > 0 ? (uint32_t)(size / sizeof(JournalRecord)) : 0;
+  bool needCompact = (size % sizeof(JournalRecord)) != 0;  // Torn final write
+
+  uint32_t lastSequence = 0;
+  uint32_t firstUnacked = fullRecords;
+  JournalRecord record;
+  for (uint32_t i = 0; i < fullRecords; i++) {
+    if (!readRecord(i, record) || !isValid(record) || record.sequence <= lastSequence) {
+      corrupted++;
+      needCompact = true;
+      continue;
+    }
+    lastSequence = record.sequence;
+    if (record.sequence > ackedSequence && firstUnacked == fullRecords) {
+      firstUnacked = i;
+    }
+  }
+
+  nextSequence = (lastSequence > ackedSequence ? lastSequence : ackedSequence) + 1;
+  recordCount = fullRecords;
+  firstPending = firstUnacked;
+  loadJournalId();
+
+  if (needCompact) {
+    return compact();
+  }
+  if (recordCount > 0 && firstPending == recordCount) {
+    reset();
+    return file != nullptr;
+  }
+  return true;
+}
+
+bool ScanJournal::compact() {
+  // Copy the valid, unacknowledged records into a new file, then swap it in
+  FILE* out = fopen(journalTempPath, "wb");
+  if (!out) {
+    return false;
+  }
+
+  fseek(file, 0, SEEK_END);
+  uint32_t total = (uint32_t)(ftell(file) / sizeof(JournalRecord));
+  uint32_t kept = 0;
+  uint32_t lastSequence = 0;
+  JournalRecord record;
+  for (uint32_t i = 0; i < total; i++) {
+    if (!readRecord(i, record) || !isValid(record) ||
+        record.sequence <= lastSequence || record.sequence <= ackedSequence) {
+      continue;
+    }
+    lastSequence = record.sequence;
+    if (fwrite(&record, sizeof(record), 1, out) != 1) {
+      fclose(out);
+      remove(journalTempPath);
+      return false;
+    }
+    kept++;
+  }
+
+  fflush(out);
+  fsync(fileno(out));
+  fclose(out);
+  fclose(file);
+  file = nullptr;
+
+  if (rename(journalTempPath, journalPath) != 0) {
+    remove(journalTempPath);
+    file = fopen(journalPath, "a+b");
+    return false;
+  }
+
+  file = fopen(journalPath, "a+b");
+  lock();
+  recordCount = kept;
+  firstPending = 0;
+  unlock();
+  return file != nullptr;
+}
+
+void ScanJournal::reset() {
+  // Everything acknowledged: start an empty file (sequence keeps counting
+  // from the ack cursor, which stays on disk)
+  if (file) {
+    fclose(file);
+  }
+  remove(journalPath);
+  file = fopen(journalPath, "a+b");
+  lock();
+  recordCount = 0;
+  firstPending = 0;
+  unlock();
+}
+
+// ===================================
+// Appending (group commit)
+// ===================================
+
+bool ScanJournal::append(const uint8_t* uid, uint8_t uidLength, uint32_t epoch, uint32_t nowMs,
+                         uint8_t flags) {
+  if (uidLength == 0 || uidLength > JOURNAL_UID_MAX) {
+    return false;
+  }
+
+  // RAM only: the network core commits the group in service()
+  lock();
+  uint32_t pending = (recordCount - firstPending) + committing + grouped;
+  if (!ready || pending >= maxRecords || grouped >= JOURNAL_GROUP_MAX) {
+    dropped++;
+    unlock();
+    return false;
+  }
+
+  JournalRecord& record = group[grouped];
+  memset(&record, 0, sizeof(record));
+  record.sequence = nextSequence++;
+  record.epoch = epoch;
+  record.uptimeMs = nowMs;
+  memcpy(record.uid, uid, uidLength);
+  record.uidLength = uidLength;
+  record.flags = flags;
+  record.crc = crc32(&record, offsetof(JournalRecord, crc));
+
+  if (grouped == 0) {
+    groupStartedMs = nowMs;
+  }
+  grouped++;
+  unlock();
+  return true;
+}
+
+bool ScanJournal::commitGroup() {
+  // Take the group under the lock and write it without: append() keeps
+  // filling the emptied group meanwhile
+  lock();
+  uint8_t count = grouped;
+  memcpy(staging, group, count * sizeof(JournalRecord));
+  grouped = 0;
+  committing = count;
+  unlock();
+
+  if (count == 0) {
+    return true;
+  }
+
+  size_t written = 0;
+  if (file) {
+    fseek(file, 0, SEEK_END);
+    written = fwrite(staging, sizeof(JournalRecord), count, file);
+    fflush(file);
+    fsync(fileno(file));
+  }
+
+  lock();
+  // Partial group: whatever reached flash is re-validated on the next boot
+  dropped += count - written;
+  recordCount += written;
+  committing = 0;
+  unlock();
+  return written == count;
+}
+
+bool ScanJournal::flush() {
+  return commitGroup();
+}
+
+void ScanJournal::service(uint32_t nowMs) {
+  lock();
+  bool due = grouped > 0 &&
+             (grouped >= groupSize || nowMs - groupStartedMs >= commitIntervalMs);
+  unlock();
+  if (due) {
+    commitGroup();
+  }
+
+  // Reclaim acknowledged records once the file reaches its cap
+  if (ready && file && firstPending > 0 && recordCount >= maxRecords) {
+    compact();
+  }
+}
+
+// ===================================
+// Replay
+// ===================================
+
+int ScanJournal::readPending(JournalRecord* out, int max) {
+  int count = 0;
+  for (uint32_t i = firstPending; i < recordCount && count < max; i++) {
+    if (readRecord(i, out[count]) && isValid(out[count]) && out[count].sequence > ackedSequence) {
+      count++;
+    }
+  }
+  return count;
+}
+
+bool ScanJournal::ack(uint32_t sequence) {
+  if (sequence <= ackedSequence) {
+    return true;
+  }
+
+  ackedSequence = sequence;
+  bool ok = writeAck(sequence);
+
+  // Move past acknowledged (and unreadable) records
+  uint32_t first = firstPending;
+  JournalRecord record;
+  while (first < recordCount) {
+    if (!readRecord(first, record) || !isValid(record)) {
+      corrupted++;
+    } else if (record.sequence > ackedSequence) {
+      break;
+    }
+    first++;
+  }
+
+  lock();
+  firstPending = first;
+  unlock();
+
+  if (first == recordCount) {
+    reset();
+  }
+  return ok;
+}
+
+uint32_t ScanJournal::getPendingCount() {
+  lock();
+  uint32_t pending = (recordCount - firstPending) + committing + grouped;
+  unlock();
+  return pending;
+}
+
+// ===================================
+// Helpers
+// ===================================
+
+bool ScanJournal::writeAck(uint32_t sequence) {
+  return writeWord(ackPath, ackTempPath, ACK_MAGIC, sequence);
+}
+
+bool ScanJournal::readAck(uint32_t& sequence) {
+  return readWord(ackPath, ACK_MAGIC, sequence);
+}
+
+void ScanJournal::loadJournalId() {
+  // Sequence starting over: a fresh ID, so the backend does not take the
+  // new sequence numbers for uploads it already holds
+  if (nextSequence == 1 || !readWord(idPath, ID_MAGIC, journalId) || journalId == 0) {
+    journalId = randomId();
+    writeWord(idPath, idTempPath, ID_MAGIC, journalId);
+  }
+}
+
+bool ScanJournal::writeWord(const char* path, const char* tempPath, uint32_t magic,
+                            uint32_t value) {
+  WordRecord word;
+  word.magic = magic;
+  word.value = value;
+  word.crc = crc32(&word, offsetof(WordRecord, crc));
+
+  // Write-then-rename: the file on flash is always either old or new
+  FILE* out = fopen(tempPath, "wb");
+  if (!out) {
+    return false;
+  }
+  bool ok = fwrite(&word, sizeof(word), 1, out) == 1;
+  fflush(out);
+  fsync(fileno(out));
+  fclose(out);
+
+  if (!ok || rename(tempPath, path) != 0) {
+    remove(tempPath);
+    return false;
+  }
+  return true;
+}
+
+bool ScanJournal::readWord(const char* path, uint32_t magic, uint32_t& value) {
+  FILE* in = fopen(path, "rb");
+  if (!in) {
+    return false;
+  }
+
+  WordRecord word;
+  bool ok = fread(&word, sizeof(word), 1, in) == 1;
+  fclose(in);
+
+  if (!ok || word.magic != magic || word.crc != crc32(&word, offsetof(WordRecord, crc))) {
+    return false;
+  }
+  value = word.value;
+  return true;
+}
+
+uint32_t ScanJournal::randomId() {
+  uint32_t id = 0;
+#ifdef ARDUINO
+  while (id == 0) {
+    id = esp_random();
+  }
+#else
+  FILE* in = fopen("/dev/urandom", "rb");
+  if (in) {
+    if (fread(&id, sizeof(id), 1, in) != 1) {
+      id = 0;
+    }
+    fclose(in);
+  }
+  if (id == 0) {
+    id = (uint32_t)time(nullptr) ^ ((uint32_t)getpid() << 16) ^ 0x5A5A5A5A;
+  }
+#endif
+  return id;
+}
+
+bool ScanJournal::readRecord(uint32_t index, JournalRecord& record) {
+  if (fseek(file, (long)index * sizeof(JournalRecord), SEEK_SET) != 0) {
+    return false;
+  }
+  return fread(&record, sizeof(record), 1, file) == 1;
+}
+
+bool ScanJournal::isValid(const JournalRecord& record) {
+  return record.uidLength > 0 && record.uidLength <= JOURNAL_UID_MAX &&
+         record.crc == crc32(&record, offsetof(JournalRecord, crc));
+}
+
+uint32_t ScanJournal::crc32(const void* data, size_t length) {
+  // CRC-32 (IEEE 802.3), bitwise: records are 28 bytes, a table isn't worth 1 KB
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= bytes[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
@@ -0,0 +1,134 @@
+#ifndef SCAN_JOURNAL_H
+#define SCAN_JOURNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Plain C stdio only, so the same code runs on the ESP32 (LittleFS mounted
+// through the VFS, e.g. "/littlefs") and on a Linux host against an ordinary
+// directory standing in for flash.
+
+#define JOURNAL_UID_MAX 10
+#define JOURNAL_GROUP_MAX 16  // Records buffered per group commit
+
+#define JOURNAL_FLAG_OFFLINE 0x01     // Recorded while the backend was unreachable
+#define JOURNAL_FLAG_EPOCH_VALID 0x02 // epoch came from a synced clock
+#define JOURNAL_FLAG_SEND_FAILED 0x04 // Live send gave up (network error)
+
+// One tap, fixed 32 bytes. Sequence numbers increase monotonically across
+// reboots; the CRC covers everything before it.
+struct JournalRecord {
+  uint32_t sequence;
+  uint32_t epoch;          // Unix seconds (see JOURNAL_FLAG_EPOCH_VALID)
+  uint32_t uptimeMs;       // millis() at the tap
+  uint8_t uid[JOURNAL_UID_MAX];
+  uint8_t uidLength;
+  uint8_t flags;
+  uint8_t reserved[4];
+  uint32_t crc;
+};
+
+// Append-only scan journal with group commit and an acknowledgement cursor.
+//
+//   <dir>/scans.jnl   records, oldest first
+//   <dir>/scans.ack   highest acknowledged sequence (written via rename)
+//   <dir>/scans.id    random journal ID (written via rename)
+//
+// Sequence numbers are only unique within one journal ID. A new ID is drawn
+// whenever the sequence starts again at 1 (first boot, or flash reformatted
+// and the ack cursor lost), so the backend, which deduplicates uploads on
+// (ID, sequence), never mistakes new scans for ones it already has.
+//
+// append() only buffers in RAM. service() writes and fsyncs the group once it
+// holds groupSize records or commitIntervalMs after its first one, so a power
+// cut loses at most one uncommitted group. On begin() every record is
+// CRC-checked: a torn tail or a corrupt record is dropped by rewriting the
+// valid, unacknowledged records. Once everything is acknowledged the journal
+// file is removed; acknowledged records are otherwise reclaimed by service()
+// when the file reaches maxRecords.
+//
+// append() may run on the UI core and never touches the file. Everything else
+// (service, flush, readPending, ack) runs on one task, the network core, and
+// does its file I/O outside the mutex, which only guards the RAM group and
+// counters, so a tap never waits on an fsync or a compaction.
+class ScanJournal {
+private:
+  char journalPath[64];
+  char journalTempPath[64];
+  char ackPath[64];
+  char ackTempPath[64];
+  char idPath[64];
+  char idTempPath[64];
+  FILE* file;
+  void* mutex;             // SemaphoreHandle_t on the ESP32
+  bool ready;
+
+  uint32_t maxRecords;
+  uint8_t groupSize;
+  uint32_t commitIntervalMs;
+
+  JournalRecord group[JOURNAL_GROUP_MAX];
+  uint8_t grouped;
+  uint8_t committing;      // Taken from the group, being written
+  JournalRecord staging[JOURNAL_GROUP_MAX];  // The group being written
+  uint32_t groupStartedMs;
+
+  uint32_t recordCount;    // Committed records in the file
+  uint32_t firstPending;   // Index of the oldest unacknowledged record
+  uint32_t nextSequence;
+  uint32_t ackedSequence;
+  uint32_t journalId;
+
+  // Statistics
+  uint32_t dropped;        // Appends refused (journal full or closed)
+  uint32_t corrupted;      // Records discarded on CRC mismatch
+
+  bool recover();
+  bool compact();
+  void reset();
+  bool commitGroup();
+  bool writeAck(uint32_t sequence);
+  bool readAck(uint32_t& sequence);
+  void loadJournalId();
+  bool readRecord(uint32_t index, JournalRecord& record);
+  void lock();
+  void unlock();
+
+  static uint32_t crc32(const void* data, size_t length);
+  static bool isValid(const JournalRecord& record);
+  static bool writeWord(const char* path, const char* tempPath, uint32_t magic, uint32_t value);
+  static bool readWord(const char* path, uint32_t magic, uint32_t& value);
+  static uint32_t randomId();
+
+public:
+  ScanJournal();
+  ~ScanJournal();
+
+  // groupSize is capped at JOURNAL_GROUP_MAX
+  bool begin(const char* directory, uint32_t maxRecords, uint8_t groupSize, uint32_t commitIntervalMs);
+  void end();
+
+  // Any task. Refused (and counted as dropped) when the journal or the
+  // RAM group is full.
+  bool append(const uint8_t* uid, uint8_t uidLength, uint32_t epoch, uint32_t nowMs, uint8_t flags);
+
+  // Network core only
+  bool flush();                         // Commit the buffered group now
+  void service(uint32_t nowMs);         // Commit a due group, reclaim acknowledged space
+
+  // Oldest committed, unacknowledged records (up to max); returns the count
+  int readPending(JournalRecord* out, int max);
+  // Acknowledge everything up to and including sequence
+  bool ack(uint32_t sequence);
+
+  uint32_t getPendingCount();           // Committed + buffered, unacknowledged
+  uint32_t getJournalId() const { return journalId; }  // Sent with every batch
+  uint32_t getDroppedCount() const { return dropped; }
+  uint32_t getCorruptedCount() const { return corrupted; }
+  bool isReady() const { return ready; }
+};
+
+extern ScanJournal scanJournal;
+
+#endif // SCAN_JOURNAL_H
@@ -0,0 +1,249 @@
+#include "TagFilter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+static const uint32_t FILTER_MAGIC = 0x46424754;  // "TGBF"
+static const uint32_t FNV_BASIS_H1 = 0x811C9DC5;
+static const uint32_t FNV_BASIS_H2 = 0x9747B28C;
+
+struct FilterFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t bitCount;
+  uint32_t tagCount;
+  uint8_t hashCount;
+  uint8_t reserved[3];
+  uint32_t checksum;        // FNV-1a of the bits
+};
+
+TagFilter::TagFilter() : active(-1), confirmed(false), confirmedAtMs(0), mutex(nullptr) {
+  path[0] = '\0';
+  tempPath[0] = '\0';
+}
+
+bool TagFilter::begin(const char* directory) {
+  snprintf(path, sizeof(path), "%s/tags.bf", directory);
+  snprintf(tempPath, sizeof(tempPath), "%s/tags.bf.tmp", directory);
+
+#ifdef ARDUINO
+  if (!mutex) {
+    mutex = xSemaphoreCreateMutex();
+  }
+#endif
+
+  remove(tempPath);  // Interrupted install; tags.bf is still the old filter
+  return load();
+}
+
+void TagFilter::lock() const {
+#ifdef ARDUINO
+  if (mutex) {
+    xSemaphoreTake((SemaphoreHandle_t)mutex, portMAX_DELAY);
+  }
+#endif
+}
+
+void TagFilter::unlock() const {
+#ifdef ARDUINO
+  if (mutex) {
+    xSemaphoreGive((SemaphoreHandle_t)mutex);
+  }
+#endif
+}
+
+// ===================================
+// Install / persistence
+// ===================================
+
+bool TagFilter::install(uint32_t version, uint32_t bitCount, uint8_t hashCount, uint32_t tagCount,
+                        const char* base64Bits) {
+  if (!isValidShape(bitCount, hashCount) || !base64Bits) {
+    return false;
+  }
+
+  // Only the network core installs, and readers never touch the idle bank
+  int idle = active == 0 ? 1 : 0;
+  Bank& bank = banks[idle];
+  if (decodeBase64(base64Bits, bank.bits, sizeof(bank.bits)) != bitCount / 8) {
+    return false;
+  }
+  bank.version = version;
+  bank.bitCount = bitCount;
+  bank.hashCount = hashCount;
+  bank.tagCount = tagCount;
+
+  // A filter that cannot be saved is still used until the next reboot
+  bool saved = persist(bank);
+
+  lock();
+  active = idle;
+  unlock();
+  return saved;
+}
+
+bool TagFilter::persist(const Bank& bank) {
+  if (path[0] == '\0') {
+    return false;
+  }
+
+  FilterFileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = FILTER_MAGIC;
+  header.version = bank.version;
+  header.bitCount = bank.bitCount;
+  header.tagCount = bank.tagCount;
+  header.hashCount = bank.hashCount;
+  header.checksum = fnv1a(bank.bits, bank.bitCount / 8, FNV_BASIS_H1);
+
+  FILE* out = fopen(tempPath, "wb");
+  if (!out) {
+    return false;
+  }
+  bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+            fwrite(bank.bits, bank.bitCount / 8, 1, out) == 1;
+  fflush(out);
+  fsync(fileno(out));
+  fclose(out);
+
+  if (!ok || rename(tempPath, path) != 0) {
+    remove(tempPath);
+    return false;
+  }
+  return true;
+}
+
+bool TagFilter::load() {
+  FILE* in = fopen(path, "rb");
+  if (!in) {
+    return false;
+  }
+
+  FilterFileHeader header;
+  Bank& bank = banks[0];
+  bool ok = fread(&header, sizeof(header), 1, in) == 1 && header.magic == FILTER_MAGIC &&
+            isValidShape(header.bitCount, header.hashCount) &&
+            fread(bank.bits, header.bitCount / 8, 1, in) == 1 &&
+            fnv1a(bank.bits, header.bitCount / 8, FNV_BASIS_H1) == header.checksum;
+  fclose(in);
+
+  if (!ok) {
+    remove(path);
+    return false;
+  }
+
+  bank.version = header.version;
+  bank.bitCount = header.bitCount;
+  bank.hashCount = header.hashCount;
+  bank.tagCount = header.tagCount;
+  lock();
+  active = 0;
+  unlock();
+  return true;
+}
+
+// ===================================
+// Lookup
+// ===================================
+
+TagFilterVerdict TagFilter::check(const uint8_t* uid, uint8_t uidLength) const {
+  if (uidLength == 0) {
+    return TAG_FILTER_UNREGISTERED;
+  }
+
+  uint32_t h1 = fnv1a(uid, uidLength, FNV_BASIS_H1);
+  uint32_t h2 = fnv1a(uid, uidLength, FNV_BASIS_H2) | 1;
+
+  lock();
+  if (active < 0) {
+    unlock();
+    return TAG_FILTER_UNKNOWN;
+  }
+
+  const Bank& bank = banks[active];
+  TagFilterVerdict verdict = TAG_FILTER_LIKELY_REGISTERED;
+  for (uint8_t i = 0; i < bank.hashCount; i++) {
+    uint32_t bit = (h1 + i * h2) % bank.bitCount;
+    if ((bank.bits[bit >> 3] & (1 << (bit & 7))) == 0) {
+      verdict = TAG_FILTER_UNREGISTERED;
+      break;
+    }
+  }
+  unlock();
+  return verdict;
+}
+
+void TagFilter::markCurrent(uint32_t nowMs) {
+  confirmedAtMs = nowMs;
+  confirmed = true;
+}
+
+uint32_t TagFilter::getAgeMs(uint32_t nowMs) const {
+  return confirmed ? nowMs - confirmedAtMs : UINT32_MAX;
+}
+
+uint32_t TagFilter::getVersion() const {
+  int bank = active;
+  return bank >= 0 ? banks[bank].version : 0;
+}
+
+uint32_t TagFilter::getTagCount() const {
+  int bank = active;
+  return bank >= 0 ? banks[bank].tagCount : 0;
+}
+
+size_t TagFilter::getSizeBytes() const {
+  int bank = active;
+  return bank >= 0 ? banks[bank].bitCount / 8 : 0;
+}
+
+// ===================================
+// Helpers
+// ===================================
+
+bool TagFilter::isValidShape(uint32_t bitCount, uint8_t hashCount) {
+  return bitCount > 0 && (bitCount % 8) == 0 && bitCount / 8 <= TAG_FILTER_MAX_BYTES &&
+         hashCount > 0 && hashCount <= TAG_FILTER_MAX_HASHES;
+}
+
+size_t TagFilter::decodeBase64(const char* text, uint8_t* out, size_t outSize) {
+  uint32_t accumulator = 0;
+  int pending = 0;
+  size_t length = 0;
+
+  for (const char* p = text; *p && *p != '='; p++) {
+    char c = *p;
+    int value;
+    if (c >= 'A' && c <= 'Z') value = c - 'A';
+    else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+    else if (c >= '0' && c <= '9') value = c - '0' + 52;
+    else if (c == '+') value = 62;
+    else if (c == '/') value = 63;
+    else return 0;
+
+    accumulator = (accumulator << 6) | value;
+    pending += 6;
+    if (pending >= 8) {
+      pending -= 8;
+      if (length >= outSize) {
+        return 0;
+      }
+      out[length++] = (uint8_t)(accumulator >> pending);
+    }
+  }
+  return length;
+}
+
+uint32_t TagFilter::fnv1a(const uint8_t* data, size_t length, uint32_t basis) {
+  uint32_t hash = basis;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= data[i];
+    hash *= 0x01000193;
+  }
+  return hash;
+}
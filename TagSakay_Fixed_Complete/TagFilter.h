@@ -0,0 +1,79 @@
+#ifndef TAG_FILTER_H
+#define TAG_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Plain C stdio like ScanJournal, so it builds on a Linux host as well.
+
+#define TAG_FILTER_MAX_BYTES 4096  // ~3400 tags at 1% false positives
+#define TAG_FILTER_MAX_HASHES 16
+
+enum TagFilterVerdict {
+  TAG_FILTER_UNKNOWN,             // No filter downloaded yet
+  TAG_FILTER_LIKELY_REGISTERED,   // Probably registered (false positives possible)
+  TAG_FILTER_UNREGISTERED         // Not an active tag as of this filter (see getAgeMs)
+};
+
+// Bloom filter of the backend's active tag UIDs, built by
+// backend-workers/src/lib/tagFilter.ts (which documents the hashing) and
+// downloaded by the network task. Gives an offline verdict in a few
+// microseconds with no network round trip.
+//
+// Two banks: install() decodes into the idle bank, persists it to
+// <dir>/tags.bf (write-then-rename), then flips the active bank under the
+// lock. Readers on the UI core always see one complete filter, old or new.
+class TagFilter {
+private:
+  struct Bank {
+    uint32_t version;
+    uint32_t bitCount;
+    uint32_t tagCount;
+    uint8_t hashCount;
+    uint8_t bits[TAG_FILTER_MAX_BYTES];
+  };
+
+  Bank banks[2];
+  volatile int active;       // -1 until a filter is loaded
+  volatile bool confirmed;   // Matched the backend's filter since boot
+  volatile uint32_t confirmedAtMs;
+  char path[64];
+  char tempPath[64];
+  void* mutex;               // SemaphoreHandle_t on the ESP32
+
+  bool persist(const Bank& bank);
+  bool load();
+  void lock() const;
+  void unlock() const;
+
+  static bool isValidShape(uint32_t bitCount, uint8_t hashCount);
+  static size_t decodeBase64(const char* text, uint8_t* out, size_t outSize);
+  static uint32_t fnv1a(const uint8_t* data, size_t length, uint32_t basis);
+
+public:
+  TagFilter();
+
+  // Loads the persisted filter, if any
+  bool begin(const char* directory);
+
+  // Network core: replace the filter (bits base64-encoded, bitCount/8 bytes)
+  bool install(uint32_t version, uint32_t bitCount, uint8_t hashCount, uint32_t tagCount,
+               const char* base64Bits);
+
+  TagFilterVerdict check(const uint8_t* uid, uint8_t uidLength) const;
+
+  // Network core: the backend's filter matched (installed or unchanged)
+  void markCurrent(uint32_t nowMs);
+  // Since the last markCurrent(); UINT32_MAX if never confirmed this boot
+  // (a filter loaded from flash may be days old)
+  uint32_t getAgeMs(uint32_t nowMs) const;
+
+  bool isLoaded() const { return active >= 0; }
+  uint32_t getVersion() const;
+  uint32_t getTagCount() const;
+  size_t getSizeBytes() const;
+};
+
+extern TagFilter tagFilter;
+
+#endif // TAG_FILTER_H
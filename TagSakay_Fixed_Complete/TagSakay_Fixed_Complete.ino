@@ -16,6 +16,13 @@
 #include "UARTModule.h"
 #include "ApiModule.h"
 #include "WebSocketModule.h"
+#include "TaskScheduler.h"
+#include "NetworkTask.h"
+#include "LatencyStats.h"
+#include "ScanJournal.h"
+#include "TagFilter.h"
+#include "ScanCache.h"
+#include <LittleFS.h>
 
 // Configuration instances (definitions)
 WiFiConfig wifiConfig = {
@@ -59,7 +66,9 @@ SystemStatus systemStatus = {
   0,      // freeHeap
   0,      // scanCount
   0,      // errorCount
-  0       // lastHeartbeat
+  0,      // lastHeartbeat
+  0,      // loopIdleMs
+  0       // duplicateScans
 };
 
 // Global state variables (definitions)
@@ -84,25 +93,59 @@ RFIDModule rfidModule;
 KeypadModule keypadModule;
 ApiModule apiModule;
 WebSocketModule wsModule;  // New: WebSocket module
+TaskScheduler scheduler;   // Cooperative main-loop scheduler (UI core)
+NetworkTask networkTask;   // Blocking network I/O (core 0)
+ScanLatencyTracker scanLatency;  // Tap-to-display histograms (heartbeat stats)
+ScanJournal scanJournal;   // Offline scans kept in flash until replayed
+TagFilter tagFilter;       // Registered-tag Bloom filter for offline verdicts
+ScanResultCache scanCache; // Last verdict per tag for instant repeat taps
+CommandPollState commandPoll = {};  // Command set version and poll counters
+
+// Task ids (one-shots are armed on demand)
+int rfidTask = -1;
+int syncTask = -1;
+int keypadBufferTimeoutTask = -1;
+int registrationExitTask = -1;
+int heartbeatBlinkTask = -1;
 
 // System state
 bool systemReady = false;
 bool offlineMode = false;
 bool useWebSocket = WS_ENABLED;  // Can be toggled at runtime
+bool wsConnected = false;        // Last NET_EVT_WS_STATUS: commands are pushed while set
 
 // Function declarations
 bool initializeSystem();
 void handleSystemError(const char* component, const char* error);
 void handleRFIDScanning();
+bool backendReachable();
 void handleKeypadInputNew();
-void sendPeriodicHeartbeat();
-void pollCommandsIfDue();
-void checkNetworkConnection();
+void syncWithServer();
 void checkSerialCommands();
+void setupScheduler();
+void initializeStorage();
+bool journalOfflineScan(const TagUid& tag);
+void showOfflineScan(const TagUid& tag, bool saved, const char* reason);
+
+// Scheduler tasks
+void processNetworkEvents();
+void pollKeypads();
+void checkInputTimeouts();
+void checkRegistrationTimeout();
+void clearRegistrationKeypadBuffer();
+void finishRegistration();
+void endHeartbeatBlink();
 
-// WebSocket callback declarations
-void handleScanResponse(JsonDocument& doc);
-void handleConfigUpdate(JsonDocument& doc);
+// Network task event handlers
+void handleScanOutcome(const ScanOutcome& outcome);
+void handleHeartbeatResult(const RequestOutcome& outcome);
+void handleLinkChange(LinkChange change);
+void handleBackendStatus(bool online);
+void handleScanResponse(const ScanOutcome& outcome);
+void showScanVerdict(const TagUid& tag, bool registered, const char* userName,
+                     const char* userRole, ScanTiming& timing);
+bool applyScanVerdict(const ScanOutcome& outcome, ScanTiming& timing);
+void handleConfigUpdate(bool regMode);
 void handleWSConnectionStatus(bool connected);
 
 void setup(void) {
@@ -130,6 +173,16 @@ void setup(void) {
     Serial.println("[SYSTEM] Press 'A' on keypad for menu\n");
     
     systemReady = true;
+
+    // Hand all blocking HTTP/WebSocket work to core 0
+    apiModule.updateDeviceState(captureDeviceState());
+    if (!networkTask.begin(networkModule, apiModule, wsModule)) {
+      Serial.println("[SYSTEM] Network task failed to start - running offline");
+      offlineMode = true;
+      systemStatus.offlineMode = true;
+    }
+
+    setupScheduler();
     indicateReady();  // Now clears scan section internally
     showKeypadMenu(false);
     sendToLEDMatrix("STATUS", "READY", "");
@@ -162,6 +215,12 @@ bool initializeSystem() {
   }
   delay(500);
 
+  // Offline scan journal and tag filter (non-critical: without them offline
+  // taps are only shown)
+  if (IS_FEATURE_ENABLED(FEATURE_LOCAL_STORAGE)) {
+    initializeStorage();
+  }
+
   // 4. Initialize Network
   Serial.println("[4/6] Initializing Network...");
   updateStatusSection("Connecting WiFi...", TFT_YELLOW);
@@ -220,28 +279,27 @@ bool initializeSystem() {
   }
   delay(500);
 
-  // 7. Initialize WebSocket (if WiFi connected and enabled)
+  // 7. Initialize WebSocket (if enabled)
   Serial.println("[7/7] Initializing WebSocket...");
-  if (useWebSocket && systemStatus.wifiConnected) {
+  if (useWebSocket) {
     updateStatusSection("Connecting WS...", TFT_YELLOW);
     
-    // Set up WebSocket callbacks
-    wsModule.setOnScanResponse(handleScanResponse);
-    wsModule.setOnConfigUpdate(handleConfigUpdate);
-    wsModule.setOnConnectionStatus(handleWSConnectionStatus);
-    
-    // Initialize WebSocket connection
-    wsModule.begin(deviceId);
-    updateStatusSection("WS: Connecting", TFT_YELLOW);
+    // Callbacks are attached by networkTask.begin(), which owns ws->loop().
+    // Started without WiFi too: the module keeps retrying with backoff and
+    // connects once the link is up.
+    wsModule.begin(deviceId, serverConfig.apiKey);
     
-    Serial.println("[WS] WebSocket module initialized");
-    Serial.println("[WS] Real-time communication enabled");
-  } else if (!useWebSocket) {
+    if (systemStatus.wifiConnected) {
+      updateStatusSection("WS: Connecting", TFT_YELLOW);
+      Serial.println("[WS] WebSocket module initialized");
+      Serial.println("[WS] Real-time communication enabled");
+    } else {
+      Serial.println("[WS] WebSocket waiting for WiFi");
+      updateStatusSection("WS: Offline", TFT_ORANGE);
+    }
+  } else {
     Serial.println("[WS] WebSocket disabled - using HTTP only");
     updateStatusSection("WS: Disabled", TFT_ORANGE);
-  } else {
-    Serial.println("[WS] WebSocket unavailable - no WiFi");
-    updateStatusSection("WS: Offline", TFT_ORANGE);
   }
   delay(500);
   
@@ -256,6 +314,7 @@ bool initializeSystem() {
     if (offlineMode || connCheck.result != API_SUCCESS) {
       Serial.println("[API] WARNING: Backend not reachable");
       updateStatusSection("API: OFFLINE", TFT_ORANGE);
+      apiModule.openCircuits();  // Probed from the network task until it answers
       offlineMode = true;
       systemStatus.apiConnected = false;
       systemStatus.offlineMode = true;
@@ -302,6 +361,21 @@ void handleSystemError(const char* component, const char* error) {
   delay(2000);
 }
 
+void setupScheduler() {
+  scheduler.addPeriodic("net-events", processNetworkEvents, NET_EVENT_POLL_INTERVAL);
+  rfidTask = scheduler.addPeriodic("rfid", handleRFIDScanning, RFID_POLL_INTERVAL);
+  scheduler.addPeriodic("keypad", pollKeypads, KEYPAD_POLL_INTERVAL);
+  scheduler.addPeriodic("serial", checkSerialCommands, SERIAL_POLL_INTERVAL);
+  syncTask = scheduler.addPeriodic("sync", syncWithServer, COMMAND_POLL_INTERVAL, COMMAND_POLL_INTERVAL);
+  scheduler.addPeriodic("timeouts", checkInputTimeouts, TIMEOUT_CHECK_INTERVAL);
+  scheduler.addPeriodic("reg-timeout", checkRegistrationTimeout, TIMEOUT_CHECK_INTERVAL);
+  scheduler.addPeriodic("display", serviceDisplayEffects, DISPLAY_EFFECT_INTERVAL);
+
+  keypadBufferTimeoutTask = scheduler.addOneShot("keybuf-clear", clearRegistrationKeypadBuffer);
+  registrationExitTask = scheduler.addOneShot("reg-exit", finishRegistration);
+  heartbeatBlinkTask = scheduler.addOneShot("hb-blink", endHeartbeatBlink);
+}
+
 void loop(void) {
   if (!systemReady) {
     // Safe mode - minimal functionality
@@ -311,91 +385,66 @@ void loop(void) {
     return;
   }
 
-  // WebSocket loop (maintains connection, handles messages)
-  if (useWebSocket && wsModule.isConnected()) {
-    wsModule.loop();
+  // Run every task whose deadline has passed; tasks never block
+  unsigned long idleMs = scheduler.run();
+  systemStatus.loopIdleMs = idleMs;
+
+  // Hand spare time to FreeRTOS, but never past the next deadline. In RFID
+  // IRQ mode the PN532 interrupt notifies this task and ends the wait early.
+  if (idleMs > 0) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(min(idleMs, (unsigned long)SCHEDULER_MAX_IDLE_SLICE)));
   }
 
-  // Check network connection and attempt reconnection
-  checkNetworkConnection();
-  
-  // Handle RFID scanning
-  handleRFIDScanning();
+  if (rfidModule.isCardPending()) {
+    scheduler.trigger(rfidTask);
+  }
+}
 
+void pollKeypads() {
   // Handle keypad input (use both old and new methods for compatibility)
   handleKeypadInput();  // Legacy function
   handleKeypadInputNew();  // New class-based function
-  
-  // Check serial commands
-  checkSerialCommands();
-
-  unsigned long currentMillis = millis();
-  
-  // Check registration mode periodically (only if online)
-  // Note: Registration mode is now controlled via WebSocket config updates
-  // TODO: Implement checkRegistrationModeFromServer() if polling is needed
-  // if (!offlineMode && currentMillis - lastRegistrationCheck > 5000) {
-  //   lastRegistrationCheck = currentMillis;
-  //   checkRegistrationModeFromServer();
-  // }
-  
-  // Send heartbeat
-  sendPeriodicHeartbeat();
+}
 
-  // Poll server commands
-  pollCommandsIfDue();
-  
-  // Clear registration keypad buffer if timeout reached (prevents accidental commands)
-  if (registrationKeypadBuffer.length() > 0 && (currentMillis - lastRegistrationKeypadInput > KEYPAD_BUFFER_TIMEOUT)) {
-    registrationKeypadBuffer = "";
-  }
-  
+void checkInputTimeouts() {
   // Handle keypad timeout
-  if (checkKeypadTimeout(currentMillis)) {
+  if (checkKeypadTimeout(millis())) {
     Serial.println("[KEYPAD] Input timeout");
     clearKeypadInput();
     indicateReady();
   }
+}
 
-  // Check registration timeout
-  if (registrationMode && (currentMillis - registrationModeStartTime > REGISTRATION_MODE_TIMEOUT)) {
+void checkRegistrationTimeout() {
+  if (registrationMode && (millis() - registrationModeStartTime > REGISTRATION_MODE_TIMEOUT)) {
     Serial.println("[REGISTRATION] Timeout reached");
     registrationMode = false;
     expectedRegistrationTagId = "";
     
     if (!offlineMode) {
-      reportDeviceStatus("registration_timeout");
+      networkTask.post(makeStatusRequest("registration_timeout"));
     }
     
-    blinkError(3);
-    updateStatusSection("REG TIMEOUT", TFT_RED);
     updateFooter("Registration mode timed out");
+    blinkError(3, "REG TIMEOUT");
   }
+}
 
-  delay(50);
+void clearRegistrationKeypadBuffer() {
+  // Clear registration keypad buffer after inactivity (prevents accidental commands)
+  registrationKeypadBuffer = "";
 }
 
-void checkNetworkConnection() {
-  networkModule.updateConnectionStatus();
-  
-  if (!networkModule.isConnected() && !offlineMode) {
-    Serial.println("[NETWORK] Connection lost - attempting reconnect...");
-    updateStatusSection("RECONNECTING", TFT_ORANGE);
-    
-    if (networkModule.reconnect()) {
-      Serial.println("[NETWORK] Reconnected successfully");
-      updateStatusSection("RECONNECTED", TFT_GREEN);
-      offlineMode = false;
-      apiModule.resetFailureCount();
-      
-      String deviceDisplay = deviceId.length() >= 4 ? deviceId.substring(deviceId.length() - 4) : deviceId;
-      updateConnectionStatus("Connected", "Synced", deviceDisplay);
-    } else {
-      Serial.println("[NETWORK] Reconnection failed - entering offline mode");
-      offlineMode = true;
-      updateStatusSection("OFFLINE MODE", TFT_ORANGE);
-    }
+void finishRegistration() {
+  if (registrationMode) {
+    return;  // Registration was re-enabled in the meantime
   }
+  updateStatusSection("NORMAL MODE", TFT_GREEN);
+  updateFooter("Ready to scan");
+}
+
+void endHeartbeatBlink() {
+  showHeartbeat(false);
 }
 
 void handleRFIDScanning() {
@@ -403,17 +452,18 @@ void handleRFIDScanning() {
     return;
   }
   
-  String tagId;
-  if (rfidModule.scanWithDebounce(tagId, RFID_DEBOUNCE_MS)) {
-    // Validate tag ID
-    if (!IS_VALID_TAG_ID(tagId)) {
-      LOG_ERROR("Invalid tag ID: " + tagId);
-      return;
-    }
+  TagUid tag;
+  bool accepted = rfidModule.scanWithDebounce(tag, DUPLICATE_SCAN_WINDOW);
+  systemStatus.duplicateScans = rfidModule.getDuplicatesSuppressed();
+  if (accepted) {
+    // Hex forms live on the stack; the tag itself stays raw bytes
+    TagIdText tagId = tag.toText();
+    char shortId[9];
+    tag.format(shortId, sizeof(shortId));
     
     systemStatus.scanCount++;
     
-    LOG_INFO("RFID Scanned: " + tagId);
+    LOG_INFOF("RFID Scanned: %s\n", tagId.c_str());
     Serial.print("[RFID] Total scans: ");
     Serial.println(systemStatus.scanCount);
     
@@ -421,119 +471,130 @@ void handleRFIDScanning() {
     updateStatusSection("TAG DETECTED", TFT_CYAN);
     
     // Send to LED matrix
-    sendToLEDMatrix("SCAN", tagId.substring(0, 8), "");
+    sendToLEDMatrix("SCAN", shortId, "");
     
     if (registrationMode) {
       // Handle registration mode scanning
       Serial.println();
       Serial.println("═══════════════════════════════════════");
       Serial.println("  REGISTRATION MODE - TAG DETECTED");
-      Serial.println("  Tag ID: " + tagId);
+      Serial.printf("  Tag ID: %s\n", tagId.c_str());
       Serial.println("═══════════════════════════════════════");
       Serial.println();
       
       updateStatusSection("REGISTERING TAG", TFT_ORANGE);
-      updateScanSection(tagId, "REGISTERING", "Please wait...", TFT_YELLOW);
-      sendToLEDMatrix("REG", tagId.substring(0, 8), "WAIT");
+      updateScanSection(tag, "REGISTERING", "Please wait...", TFT_YELLOW);
+      sendToLEDMatrix("REG", shortId, "WAIT");
       
-      // Send registration request to backend
-      if (useWebSocket && wsModule.isConnected()) {
-        // Send via WebSocket with registration flag
-        Serial.println("[WS] Sending registration via WebSocket");
-        // Note: WebSocket sendScan should be enhanced to support registration mode
-        // For now, using HTTP
-        ApiResponse response = apiModule.sendScan(tagId, deviceConfig.location);
-        
-        if (response.result == API_SUCCESS) {
-          Serial.println("[✓] Tag registered successfully!");
-          updateScanSection(tagId, "REGISTERED", "Success!", TFT_GREEN);
-          sendToLEDMatrix("REG", "SUCCESS", "");
-          indicateSuccess();
-          
-          // Auto-exit registration mode after successful registration
-          delay(2000);
-          registrationMode = false;
-          updateStatusSection("NORMAL MODE", TFT_GREEN);
-          updateFooter("Ready to scan");
-        } else {
-          Serial.println("[✗] Registration failed: " + response.error);
-          updateScanSection(tagId, "REG FAILED", response.error, TFT_RED);
-          sendToLEDMatrix("REG", "FAILED", "");
-          indicateError();
-        }
-      } else if (!offlineMode && apiModule.isInitialized()) {
-        Serial.println("[HTTP] Sending registration via HTTP");
-        ApiResponse response = apiModule.sendScan(tagId, deviceConfig.location);
-        
-        if (response.result == API_SUCCESS) {
-          Serial.println("[✓] Tag registered successfully!");
-          updateScanSection(tagId, "REGISTERED", "Success!", TFT_GREEN);
-          sendToLEDMatrix("REG", "SUCCESS", "");
-          indicateSuccess();
-          
-          // Auto-exit registration mode after successful registration
-          delay(2000);
-          registrationMode = false;
-          updateStatusSection("NORMAL MODE", TFT_GREEN);
-          updateFooter("Ready to scan");
-        } else {
-          Serial.println("[✗] Registration failed: " + response.error);
-          updateScanSection(tagId, "REG FAILED", response.error, TFT_RED);
-          sendToLEDMatrix("REG", "FAILED", "");
+      // Registration always goes over HTTP; the network task reports back
+      if (backendReachable()) {
+        if (!networkTask.post(makeScanRequest(tag, true))) {
+          updateScanSection(tag, "REG FAILED", "Network busy", TFT_RED);
           indicateError();
         }
       } else {
         Serial.println("[✗] Cannot register - offline mode");
-        updateScanSection(tagId, "OFFLINE", "Cannot register", TFT_RED);
+        updateScanSection(tag, "OFFLINE", "Cannot register", TFT_RED);
         indicateError();
       }
     } else {
-      // Normal scanning mode
-      // Try WebSocket first (if enabled and connected)
-      if (useWebSocket && wsModule.isConnected()) {
-        Serial.println("[WS] Sending scan via WebSocket");
-        wsModule.sendScan(tagId, deviceConfig.location);
-        
-        // Show processing message
-        updateStatusSection("PROCESSING...", TFT_YELLOW);
-        updateScanSection(tagId, "PROCESSING", "Sending to server", TFT_YELLOW);
-        
-        // Response will be handled by handleScanResponse callback
-      } 
-      // Fallback to HTTP if WebSocket not available
-      else if (!offlineMode && apiModule.isInitialized()) {
-        Serial.println("[HTTP] Sending scan via HTTP (WebSocket unavailable)");
-        // Send to backend via HTTP
-        ApiResponse response = apiModule.sendScan(tagId, deviceConfig.location);
-        if (response.result == API_SUCCESS) {
-          Serial.println("[API] Scan sent successfully");
-          // Parse and handle response - for now just show success
-          updateStatusSection("SCAN OK", TFT_GREEN);
-          updateScanSection(tagId, "SENT", "Via HTTP", TFT_GREEN);
+      // Normal scanning mode: the network task picks WebSocket or HTTP per
+      // scan (TransportSelector); the UI only checks the backend is reachable
+      if (backendReachable()) {
+        NetRequest request = makeScanRequest(tag, false);
+        request.scan.timing = rfidModule.getLastReadTiming();
+        if (networkTask.post(request)) {
+          // Repeat tap: show the last verdict now, the server answer follows
+          // and only redraws if it differs
+          const ScanResultCache::Entry* cached = scanCache.lookup(tag, millis());
+          if (cached) {
+            ScanTiming timing = request.scan.timing;
+            showScanVerdict(tag, cached->registered, cached->userName, cached->userRole, timing);
+            scanLatency.record(timing, SCAN_TRANSPORT_CACHE);
+          } else {
+            // Show processing message; the result arrives as a network event
+            updateStatusSection("PROCESSING...", TFT_YELLOW);
+            updateScanSection(tag, "PROCESSING", "Sending to server", TFT_YELLOW);
+          }
         } else {
-          Serial.println("[API] Failed to send scan");
-          updateStatusSection("SCAN FAILED", TFT_RED);
-          updateScanSection(tagId, "OFFLINE", "Scan not sent", TFT_ORANGE);
-          
           systemStatus.errorCount++;
-          
-          if (apiModule.getConsecutiveFailures() >= MAX_CONSECUTIVE_FAILURES) {
-            LOG_ERROR("Multiple API failures - switching to offline mode");
-            offlineMode = true;
-            systemStatus.offlineMode = true;
-            systemStatus.apiConnected = false;
-            updateFooter("Too many failures - offline mode");
-          }
+          updateStatusSection("NET BUSY", TFT_RED);
+          showOfflineScan(tag, journalOfflineScan(tag), "Network busy");
         }
       } else {
-        // Offline mode - just display
-        Serial.println("[OFFLINE] Scan recorded locally");
-        updateScanSection(tagId, "OFFLINE", "Backend unavailable", TFT_ORANGE);
-        updateFooter("Offline scan: " + tagId.substring(0, 8));
+        // Offline mode - keep the tap in flash for replay
+        bool saved = journalOfflineScan(tag);
+        Serial.println(saved ? "[OFFLINE] Scan recorded locally" : "[OFFLINE] Scan not recorded");
+        showOfflineScan(tag, saved, "Backend unavailable");
+        updateFooter(String("Offline scan: ") + shortId);
       }
     }
-    
-    delay(200);
+  }
+}
+
+void initializeStorage() {
+  if (!LittleFS.begin(true)) {
+    Serial.println("[STORAGE] LittleFS mount failed - offline scans will not be kept");
+    return;
+  }
+
+  if (tagFilter.begin(TAG_FILTER_DIR)) {
+    Serial.printf("[FILTER] Loaded tag filter v%lu (%lu tags, %u bytes)\n",
+                  (unsigned long)tagFilter.getVersion(), (unsigned long)tagFilter.getTagCount(),
+                  (unsigned)tagFilter.getSizeBytes());
+  } else {
+    Serial.println("[FILTER] No tag filter yet - downloaded once online");
+  }
+
+  if (!scanJournal.begin(SCAN_JOURNAL_DIR, SCAN_JOURNAL_MAX_RECORDS, SCAN_JOURNAL_GROUP_SIZE,
+                         SCAN_JOURNAL_COMMIT_INTERVAL)) {
+    Serial.println("[JOURNAL] Could not open scan journal");
+    return;
+  }
+
+  Serial.printf("[JOURNAL] Ready - %lu offline scan(s) awaiting replay\n",
+                (unsigned long)scanJournal.getPendingCount());
+}
+
+// Whether a tap can go to the backend at all. Which path it takes is not
+// the UI core's call: TransportSelector chooses per scan on the network core.
+bool backendReachable() {
+  return !offlineMode && networkTask.isRunning();
+}
+
+bool journalOfflineScan(const TagUid& tag) {
+  if (!scanJournal.isReady()) {
+    return false;
+  }
+
+  time_t now = time(nullptr);
+  bool clockSet = now >= 1000000000;  // NTP synced (see getCurrentTimestamp)
+  uint8_t flags = JOURNAL_FLAG_OFFLINE | (clockSet ? JOURNAL_FLAG_EPOCH_VALID : 0);
+  return scanJournal.append(tag.bytes, tag.length, clockSet ? (uint32_t)now : 0, millis(), flags);
+}
+
+void showOfflineScan(const TagUid& tag, bool saved, const char* reason) {
+  // The Bloom filter answers without the backend; "registered" can be a
+  // false positive. "Not listed" is only as current as the filter: a tag
+  // registered since the last download is missing from it, so the driver is
+  // never turned away on it, and a stale filter gives no such verdict at all
+  TagFilterVerdict verdict = tagFilter.check(tag.bytes, tag.length);
+  if (verdict == TAG_FILTER_UNREGISTERED && tagFilter.getAgeMs(millis()) > TAG_FILTER_MAX_AGE) {
+    verdict = TAG_FILTER_UNKNOWN;
+  }
+  
+  switch (verdict) {
+    case TAG_FILTER_LIKELY_REGISTERED:
+      updateScanSection(tag, "OFFLINE OK", saved ? "Registered - saved" : "Likely registered", TFT_GREEN);
+      break;
+    case TAG_FILTER_UNREGISTERED:
+      updateScanSection(tag, "NOT LISTED", saved ? "Not in offline list - saved" : "Not in offline list",
+                        TFT_YELLOW);
+      break;
+    default:
+      updateScanSection(tag, saved ? "SAVED" : "OFFLINE",
+                        saved ? "Sent when online" : reason, TFT_ORANGE);
+      break;
   }
 }
 
@@ -544,8 +605,9 @@ void handleKeypadInputNew() {
     Serial.print("[KEYPAD] Key pressed: ");
     Serial.println(key);
     
-    // Update last input time
+    // Update last input time and push back the buffer-clear deadline
     lastRegistrationKeypadInput = millis();
+    scheduler.trigger(keypadBufferTimeoutTask, KEYPAD_BUFFER_TIMEOUT);
     
     // Add key to buffer
     registrationKeypadBuffer += key;
@@ -604,6 +666,21 @@ void handleKeypadInputNew() {
       Serial.println(systemStatus.scanCount);
       Serial.print("  Error Count: ");
       Serial.println(systemStatus.errorCount);
+      Serial.print("  Duplicates Suppressed: ");
+      Serial.print(systemStatus.duplicateScans);
+      Serial.print(" (");
+      Serial.print(rfidModule.getRecentTagCount());
+      Serial.println(" tags in window)");
+      Serial.print("  Loop Idle: ");
+      Serial.print(systemStatus.loopIdleMs);
+      Serial.println(" ms");
+      Serial.printf("  Scan Cache: hits=%lu misses=%lu expired=%lu corrected=%lu evicted=%lu\n",
+                    (unsigned long)scanCache.getHits(), (unsigned long)scanCache.getMisses(),
+                    (unsigned long)scanCache.getExpired(), (unsigned long)scanCache.getCorrected(),
+                    (unsigned long)scanCache.getEvictions());
+      scheduler.printStatus();
+      networkTask.printStatus();
+      scanLatency.printStatus();
       Serial.println();
       
       updateStatusSection("STATUS CHECK", TFT_CYAN);
@@ -611,14 +688,7 @@ void handleKeypadInputNew() {
     } else if (key == '*') {
       // Force heartbeat
       if (!offlineMode && apiModule.isInitialized()) {
-        ApiResponse response = apiModule.sendHeartbeat(true);
-        if (response.result == API_SUCCESS) {
-          Serial.println("[HEARTBEAT] Manual heartbeat sent");
-          updateStatusSection("HEARTBEAT OK", TFT_GREEN);
-        } else {
-          Serial.println("[HEARTBEAT] Failed");
-          updateStatusSection("HEARTBEAT FAIL", TFT_RED);
-        }
+        networkTask.post(makeHeartbeatRequest(true));
       } else {
         Serial.println("[HEARTBEAT] Offline mode");
         updateStatusSection("OFFLINE", TFT_ORANGE);
@@ -627,50 +697,43 @@ void handleKeypadInputNew() {
   }
 }
 
-void sendPeriodicHeartbeat() {
-  unsigned long currentMillis = millis();
-  
-  if (currentMillis - lastHeartbeat >= HEARTBEAT_INTERVAL) {
-    lastHeartbeat = currentMillis;
-    
-    if (!offlineMode && networkModule.isConnected()) {
-      ApiResponse response = apiModule.sendHeartbeat(true);
-      if (response.result == API_SUCCESS) {
-        Serial.println("[HEARTBEAT] Sent successfully");
-        showHeartbeat(true);
-        delay(100);
-        showHeartbeat(false);
-      } else {
-        Serial.println("[HEARTBEAT] Failed");
-        // Note: incrementFailureCount() doesn't exist, using resetFailureCount() instead
-        // or just log the error
-      }
-    } else {
-      Serial.println("[HEARTBEAT] Skipped - offline mode");
-    }
-    
+void syncWithServer() {
+  // Runs every COMMAND_POLL_INTERVAL, stretched to SYNC_IDLE_INTERVAL while
+  // idle and to SYNC_PUSH_INTERVAL while the WebSocket pushes commands. One
+  // request carries the heartbeat (when due), buffered status reports and
+  // the command poll.
+  unsigned long now = millis();
+  lastCommandPoll = now;
+
+  bool idle = !registrationMode && now - rfidModule.getLastScanTime() >= SYNC_IDLE_AFTER;
+  unsigned long interval = idle ? SYNC_IDLE_INTERVAL : COMMAND_POLL_INTERVAL;
+  if (wsConnected) {
+    interval = SYNC_PUSH_INTERVAL;
+  }
+  scheduler.setInterval(syncTask, interval);
+
+  // A sync still waiting in the queue is not duplicated
+  if (networkTask.isPending(NET_REQ_SYNC)) {
+    return;
+  }
+
+  // Half a poll of slack, so the idle cadence (one sync per heartbeat
+  // period) carries the stats every time despite scheduling jitter
+  bool heartbeatDue = now - lastHeartbeat >= HEARTBEAT_INTERVAL - COMMAND_POLL_INTERVAL / 2;
+  if (heartbeatDue) {
+    lastHeartbeat = now;
+
     // Update connection status display
     String wifiStatus = networkModule.isConnected() ? "Connected" : "Disconnected";
     String deviceDisplay = deviceId.length() >= 4 ? deviceId.substring(deviceId.length() - 4) : deviceId;
     updateConnectionStatus(wifiStatus, "Synced", deviceDisplay);
   }
-}
-
-void pollCommandsIfDue() {
-  unsigned long now = millis();
-  if (now - lastCommandPoll < COMMAND_POLL_INTERVAL) return;
-  lastCommandPoll = now;
 
   if (offlineMode || !networkModule.isConnected() || !apiModule.isInitialized()) {
     return;
   }
 
-  // Prefer HTTP polling even if WebSocket is connected, as backend is HTTP-centric
-  bool ok = networkModule.pollServerCommands();
-  if (!ok) {
-    // Non-fatal; just log
-    Serial.println("[POLL] No updates or failed to poll commands");
-  }
+  networkTask.postCoalesced(makeSyncRequest(heartbeatDue));
 }
 
 void checkSerialCommands() {
@@ -704,92 +767,284 @@ void checkSerialCommands() {
   }
 }
 
+// ===================================
+// Network Task Events
+// ===================================
+
+void processNetworkEvents() {
+  NetEvent event;
+
+  // Bounded so a burst of events cannot starve RFID/keypad polling
+  for (int i = 0; i < NET_EVENT_QUEUE_SIZE && networkTask.receive(event); i++) {
+    switch (event.type) {
+      case NET_EVT_SCAN_RESULT:
+        handleScanOutcome(event.scan);
+        break;
+      case NET_EVT_HEARTBEAT:
+        handleHeartbeatResult(event.request);
+        break;
+      case NET_EVT_COMMANDS:
+        applyServerCommands(event.commands);
+        break;
+      case NET_EVT_MODE_RESULT:
+        handleDeviceModeResult(event.profile);
+        break;
+      case NET_EVT_PROFILE_RESULT:
+        handleProfileSyncResult(event.profile);
+        break;
+      case NET_EVT_OVERRIDE_RESULT:
+        showQueueOverrideResult(event.request.queueNumber, event.request.httpCode);
+        break;
+      case NET_EVT_WS_CONFIG:
+        handleConfigUpdate(event.registrationMode);
+        break;
+      case NET_EVT_WS_STATUS:
+        handleWSConnectionStatus(event.connected);
+        break;
+      case NET_EVT_LINK_STATUS:
+        handleLinkChange(event.link);
+        break;
+      case NET_EVT_BACKEND_STATUS:
+        handleBackendStatus(event.online);
+        break;
+    }
+  }
+}
+
+void handleScanOutcome(const ScanOutcome& outcome) {
+  if (outcome.viaWebSocket) {
+    handleScanResponse(outcome);
+    return;
+  }
+
+  const TagUid& tag = outcome.tag;
+
+  if (outcome.registration) {
+    if (outcome.result == API_SUCCESS) {
+      Serial.println("[✓] Tag registered successfully!");
+      scanCache.invalidate(tag);  // A cached "unregistered" is now wrong
+      updateScanSection(tag, "REGISTERED", "Success!", TFT_GREEN);
+      sendToLEDMatrix("REG", "SUCCESS", "");
+      indicateSuccess();
+
+      // Auto-exit registration mode; restore the idle screen once the
+      // result has been visible for a moment (taps keep being read)
+      registrationMode = false;
+      scheduler.trigger(registrationExitTask, REGISTRATION_EXIT_DELAY);
+    } else {
+      Serial.println("[✗] Registration failed: " + String(outcome.error));
+      updateScanSection(tag, "REG FAILED", outcome.error, TFT_RED);
+      sendToLEDMatrix("REG", "FAILED", "");
+      indicateError();
+    }
+    return;
+  }
+
+  ScanTiming timing = outcome.timing;
+
+  // API_SUCCESS implies a parsed body, so every delivered scan has a
+  // verdict (as over the WebSocket); without one the scan did not get through
+  if (outcome.hasVerdict) {
+    if (applyScanVerdict(outcome, timing)) {
+      scanLatency.record(timing, SCAN_TRANSPORT_HTTP);
+    }
+    return;
+  }
+
+  Serial.println("[API] Failed to send scan: " + String(outcome.error));
+  updateStatusSection("SCAN FAILED", TFT_RED);
+  updateScanSection(tag, "OFFLINE", "Scan not sent", TFT_ORANGE);
+  timing.displayedUs = micros();
+
+  systemStatus.errorCount++;
+
+  // HTTP results do not drive the LED matrix, so the pipeline ends at the TFT
+  scanLatency.record(timing, SCAN_TRANSPORT_HTTP);
+}
+
+void handleHeartbeatResult(const RequestOutcome& outcome) {
+  if (outcome.manual) {
+    if (outcome.ok) {
+      Serial.println("[HEARTBEAT] Manual heartbeat sent");
+      updateStatusSection("HEARTBEAT OK", TFT_GREEN);
+    } else {
+      Serial.println("[HEARTBEAT] Failed");
+      updateStatusSection("HEARTBEAT FAIL", TFT_RED);
+    }
+    return;
+  }
+
+  if (outcome.ok) {
+    Serial.println("[HEARTBEAT] Sent successfully");
+    showHeartbeat(true);
+    scheduler.trigger(heartbeatBlinkTask, HEARTBEAT_BLINK_MS);
+  } else {
+    Serial.println("[HEARTBEAT] Failed");
+  }
+}
+
+void handleLinkChange(LinkChange change) {
+  switch (change) {
+    case LINK_LOST:
+      updateStatusSection("RECONNECTING", TFT_ORANGE);
+      break;
+
+    case LINK_RECONNECTED: {
+      updateStatusSection("RECONNECTED", TFT_GREEN);
+      offlineMode = false;
+
+      String deviceDisplay = deviceId.length() >= 4 ? deviceId.substring(deviceId.length() - 4) : deviceId;
+      updateConnectionStatus("Connected", "Synced", deviceDisplay);
+      break;
+    }
+
+    case LINK_RECONNECT_FAILED:
+      offlineMode = true;
+      updateStatusSection("OFFLINE MODE", TFT_ORANGE);
+      break;
+  }
+}
+
+// Offline mode follows the scan circuit breaker: on when repeated failures
+// open it, off again once a health probe gets an answer (the next scan is
+// then the trial request that closes it)
+void handleBackendStatus(bool online) {
+  systemStatus.apiConnected = online;
+
+  if (online) {
+    Serial.println("[API] Backend answering again - leaving offline mode");
+    offlineMode = false;
+    systemStatus.offlineMode = false;
+    updateStatusSection("API: OK", TFT_GREEN);
+    updateFooter("Backend back online");
+
+    // Catch up on commands missed while offline
+    scheduler.trigger(syncTask);
+  } else {
+    LOG_ERROR("Backend not reachable - switching to offline mode");
+    offlineMode = true;
+    systemStatus.offlineMode = true;
+    updateFooter("Backend down - offline mode");
+  }
+}
+
 // ===================================
 // WebSocket Callback Functions
 // ===================================
 
 /**
- * Callback when scan response received from WebSocket
+ * Scan response received from WebSocket (relayed by the network task)
  */
-void handleScanResponse(JsonDocument& doc) {
-  if (doc["success"]) {
-    bool isRegistered = doc["scan"]["isRegistered"] | false;
-    String tagId = doc["scan"]["tagId"] | "";
-    
-    if (isRegistered && doc.containsKey("user")) {
-      // Registered user
-      String userName = doc["user"]["name"] | "Unknown";
-      String userRole = doc["user"]["role"] | "";
-      
-      Serial.println("✅ Registered: " + userName + " (" + userRole + ")");
-      
-      // Update display
-      updateStatusSection("REGISTERED", TFT_GREEN);
-      updateScanSection(tagId, userName, "Welcome!", TFT_GREEN);
-      updateFooter("Access granted: " + userName);
-      
-      // Send to LED matrix
-      sendToLEDMatrix("WELCOME", userName.substring(0, 8), "");
-      
-      // Reset API failure count
-      apiModule.resetFailureCount();
-      
-    } else {
-      // Unregistered tag
-      Serial.println("❌ Unregistered tag: " + tagId);
-      
-      updateStatusSection("UNREGISTERED", TFT_ORANGE);
-      updateScanSection(tagId, "NOT REGISTERED", "Please register", TFT_ORANGE);
-      updateFooter("Unregistered: " + tagId.substring(0, 8));
-      
-      // Send to LED matrix
-      sendToLEDMatrix("UNREG", tagId.substring(0, 8), "");
+void handleScanResponse(const ScanOutcome& outcome) {
+  ScanTiming timing = outcome.timing;
+
+  // Registered and unregistered are both verdicts (shown and cached)
+  if (outcome.hasVerdict) {
+    if (!applyScanVerdict(outcome, timing)) {
+      return;  // Cached result already on screen was right
     }
   } else {
     // Error occurred
-    String error = doc["error"] | "Unknown error";
+    String error = outcome.error;
     Serial.println("❌ Error: " + error);
     
     updateStatusSection("ERROR", TFT_RED);
     updateScanSection("", "ERROR", error, TFT_RED);
     updateFooter("Scan error: " + error);
+    timing.displayedUs = micros();
     
     sendToLEDMatrix("ERROR", error.substring(0, 8), "");
+    timing.ledUs = micros();
   }
+
+  scanLatency.record(timing, SCAN_TRANSPORT_WEBSOCKET);
 }
 
 /**
- * Callback when config update received from WebSocket
+ * Show a registered/unregistered verdict on the TFT and LED matrix
+ * (server response or cache hit); stamps displayedUs and ledUs
  */
-void handleConfigUpdate(JsonDocument& doc) {
-  if (doc.containsKey("config")) {
-    bool regMode = doc["config"]["registrationMode"] | false;
-    
-    // Update local registration mode
-    registrationMode = regMode;
-    deviceConfig.registrationMode = regMode;
+void showScanVerdict(const TagUid& tag, bool registered, const char* userName,
+                     const char* userRole, ScanTiming& timing) {
+  char shortId[9];
+  tag.format(shortId, sizeof(shortId));
+
+  if (registered) {
+    String name = userName[0] != '\0' ? String(userName) : String("Unknown");
     
-    Serial.println("⚙️ Config updated from server:");
-    Serial.println("  - Registration Mode: " + String(regMode ? "ON" : "OFF"));
+    Serial.println("✅ Registered: " + name + " (" + String(userRole) + ")");
     
     // Update display
-    if (regMode) {
-      indicateRegistrationMode();
-      updateFooter("Registration mode enabled");
-    } else {
-      indicateReady();
-      updateFooter("Normal scanning mode");
-    }
+    updateStatusSection("REGISTERED", TFT_GREEN);
+    updateScanSection(tag, name, "Welcome!", TFT_GREEN);
+    updateFooter("Access granted: " + name);
+    timing.displayedUs = micros();
     
     // Send to LED matrix
-    sendToLEDMatrix("CONFIG", regMode ? "REG ON" : "REG OFF", "");
+    sendToLEDMatrix("WELCOME", name.substring(0, 8), "");
+  } else {
+    Serial.printf("❌ Unregistered tag: %s\n", tag.toText().c_str());
+    
+    updateStatusSection("UNREGISTERED", TFT_ORANGE);
+    updateScanSection(tag, "NOT REGISTERED", "Please register", TFT_ORANGE);
+    updateFooter(String("Unregistered: ") + shortId);
+    timing.displayedUs = micros();
+    
+    sendToLEDMatrix("UNREG", shortId, "");
+  }
+  timing.ledUs = micros();
+}
+
+/**
+ * Cache the server's verdict and show it unless the cached copy already
+ * on screen said the same. Returns false when nothing was redrawn.
+ */
+bool applyScanVerdict(const ScanOutcome& outcome, ScanTiming& timing) {
+  switch (scanCache.store(outcome.tag, outcome.registered, outcome.userName, outcome.userRole, millis())) {
+    case SCAN_CACHE_CONFIRMED:
+      LOG_INFOF("[CACHE] Server confirmed cached result for %s\n", outcome.tag.toText().c_str());
+      return false;
+    case SCAN_CACHE_CORRECTED:
+      Serial.printf("[CACHE] Stale result for %s - corrected\n", outcome.tag.toText().c_str());
+      break;
+    default:
+      break;
+  }
+
+  showScanVerdict(outcome.tag, outcome.registered, outcome.userName, outcome.userRole, timing);
+  return true;
+}
+
+/**
+ * Config update received from WebSocket (relayed by the network task)
+ */
+void handleConfigUpdate(bool regMode) {
+  // Update local registration mode
+  registrationMode = regMode;
+  deviceConfig.registrationMode = regMode;
+  
+  Serial.println("⚙️ Config updated from server:");
+  Serial.println("  - Registration Mode: " + String(regMode ? "ON" : "OFF"));
+  
+  // Update display
+  if (regMode) {
+    indicateRegistrationMode();
+    updateFooter("Registration mode enabled");
+  } else {
+    indicateReady();
+    updateFooter("Normal scanning mode");
   }
+  
+  // Send to LED matrix
+  sendToLEDMatrix("CONFIG", regMode ? "REG ON" : "REG OFF", "");
 }
 
 /**
  * Callback when WebSocket connection status changes
  */
 void handleWSConnectionStatus(bool connected) {
+  wsConnected = connected;
+
   if (connected) {
     Serial.println("🔌 WebSocket connected - real-time mode active");
     // Don't overwrite the main status - just update footer
@@ -809,5 +1064,8 @@ void handleWSConnectionStatus(bool connected) {
       offlineMode = true;
       systemStatus.offlineMode = true;
     }
+
+    // Back to fast polling now, and catch anything pushed while dropping
+    scheduler.trigger(syncTask);
   }
 }
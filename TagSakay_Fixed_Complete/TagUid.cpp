@@ -0,0 +1,67 @@
+#include "TagUid.h"
+
+static_assert(RFID_MAX_UID_LENGTH <= 12, "TagUid holds at most 12 bytes");
+static_assert(MAX_TAG_ID_LENGTH >= RFID_MAX_UID_LENGTH * 2, "Tag ID text too short for a full UID");
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+bool TagUid::set(const uint8_t* uid, uint8_t uidLength) {
+  clear();
+  if (uidLength == 0 || uidLength > RFID_MAX_UID_LENGTH) {
+    return false;
+  }
+  memcpy(bytes, uid, uidLength);
+  length = uidLength;
+  return true;
+}
+
+bool TagUid::parse(const char* hex) {
+  clear();
+  if (!hex) {
+    return false;
+  }
+
+  size_t digits = strlen(hex);
+  if (digits == 0 || (digits % 2) != 0 || digits > RFID_MAX_UID_LENGTH * 2) {
+    return false;
+  }
+
+  for (size_t i = 0; i < digits; i += 2) {
+    int high = hexValue(hex[i]);
+    int low = hexValue(hex[i + 1]);
+    if (high < 0 || low < 0) {
+      clear();
+      return false;
+    }
+    bytes[i / 2] = (uint8_t)((high << 4) | low);
+  }
+  length = digits / 2;
+  return true;
+}
+
+size_t TagUid::format(char* out, size_t outSize) const {
+  if (outSize == 0) {
+    return 0;
+  }
+
+  size_t pos = 0;
+  for (uint8_t i = 0; i < length && pos + 2 < outSize; i++) {
+    out[pos++] = hexDigits[bytes[i] >> 4];
+    out[pos++] = hexDigits[bytes[i] & 0x0F];
+  }
+  out[pos] = '\0';
+  return pos;
+}
+
+TagIdText TagUid::toText() const {
+  TagIdText text;
+  format(text.text, sizeof(text.text));
+  return text;
+}
@@ -0,0 +1,42 @@
+#ifndef TAG_UID_H
+#define TAG_UID_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Hex form of a TagUid in a fixed buffer; lives on the caller's stack
+struct TagIdText {
+  char text[MAX_TAG_ID_LENGTH + 1];
+  const char* c_str() const { return text; }
+};
+
+// Raw card UID as read from the PN532 (up to RFID_MAX_UID_LENGTH bytes).
+// Plain data, so it is copied through FreeRTOS queues as-is, and equality
+// is three word compares instead of a string compare. Unused bytes are kept
+// zero so the word compare is exact.
+struct TagUid {
+  union {
+    uint8_t bytes[12];
+    uint32_t words[3];
+  };
+  uint8_t length;
+
+  void clear() { words[0] = 0; words[1] = 0; words[2] = 0; length = 0; }
+  bool isEmpty() const { return length == 0; }
+
+  bool set(const uint8_t* uid, uint8_t uidLength);
+  bool parse(const char* hex);  // Server-side form ("04A1B2C3", either case)
+
+  // Uppercase hex, truncated to whole bytes that fit (a 9-byte buffer gives
+  // the 8-character short form used on the LED matrix). Returns the length.
+  size_t format(char* out, size_t outSize) const;
+  TagIdText toText() const;
+
+  bool operator==(const TagUid& other) const {
+    return length == other.length && words[0] == other.words[0] &&
+           words[1] == other.words[1] && words[2] == other.words[2];
+  }
+  bool operator!=(const TagUid& other) const { return !(*this == other); }
+};
+
+#endif // TAG_UID_H
@@ -0,0 +1,154 @@
+#include "TaskScheduler.h"
+
+TaskScheduler::TaskScheduler()
+  : taskCount(0), cycleCount(0), lastIdleMs(0), minIdleMs(ULONG_MAX), totalIdleMs(0) {}
+
+int TaskScheduler::addTask(const char* name, TaskCallback callback, unsigned long interval,
+                           unsigned long firstRunDelay, bool oneShot, bool enabled) {
+  if (taskCount >= MAX_SCHEDULED_TASKS || callback == nullptr) {
+    LOG_ERROR("Scheduler: cannot add task " + String(name));
+    return -1;
+  }
+
+  ScheduledTask& task = tasks[taskCount];
+  task.name = name;
+  task.callback = callback;
+  task.interval = interval;
+  task.nextRun = millis() + firstRunDelay;
+  task.enabled = enabled;
+  task.oneShot = oneShot;
+  task.runCount = 0;
+  task.lastDurationUs = 0;
+  task.maxDurationUs = 0;
+  task.maxLatenessMs = 0;
+
+  return taskCount++;
+}
+
+int TaskScheduler::addPeriodic(const char* name, TaskCallback callback, unsigned long intervalMs,
+                               unsigned long firstRunDelayMs) {
+  return addTask(name, callback, intervalMs, firstRunDelayMs, false, true);
+}
+
+int TaskScheduler::addOneShot(const char* name, TaskCallback callback) {
+  // One-shot tasks stay dormant until trigger() gives them a deadline
+  return addTask(name, callback, 0, 0, true, false);
+}
+
+void TaskScheduler::trigger(int taskId, unsigned long delayMs) {
+  if (taskId < 0 || taskId >= taskCount) return;
+  tasks[taskId].nextRun = millis() + delayMs;
+  tasks[taskId].enabled = true;
+}
+
+void TaskScheduler::cancel(int taskId) {
+  if (taskId < 0 || taskId >= taskCount) return;
+  tasks[taskId].enabled = false;
+}
+
+void TaskScheduler::setInterval(int taskId, unsigned long intervalMs) {
+  if (taskId < 0 || taskId >= taskCount) return;
+  tasks[taskId].interval = intervalMs;
+}
+
+bool TaskScheduler::isPending(int taskId) const {
+  if (taskId < 0 || taskId >= taskCount) return false;
+  return tasks[taskId].enabled;
+}
+
+unsigned long TaskScheduler::run() {
+  for (int i = 0; i < taskCount; i++) {
+    ScheduledTask& task = tasks[i];
+    unsigned long now = millis();
+    if (!task.enabled || !isDue(now, task.nextRun)) {
+      continue;
+    }
+
+    unsigned long lateness = now - task.nextRun;
+    if (lateness > task.maxLatenessMs) {
+      task.maxLatenessMs = lateness;
+    }
+
+    // Re-arm before running so the callback may trigger/cancel itself
+    if (task.oneShot) {
+      task.enabled = false;
+    } else if (lateness >= task.interval) {
+      // Fell a full period behind - skip missed runs instead of bursting
+      task.nextRun = now + task.interval;
+    } else {
+      task.nextRun += task.interval;
+    }
+
+    unsigned long startUs = micros();
+    task.callback();
+    task.lastDurationUs = micros() - startUs;
+    if (task.lastDurationUs > task.maxDurationUs) {
+      task.maxDurationUs = task.lastDurationUs;
+    }
+    task.runCount++;
+  }
+
+  // Idle budget = time until the earliest pending deadline
+  unsigned long now = millis();
+  unsigned long idle = ULONG_MAX;
+  for (int i = 0; i < taskCount; i++) {
+    if (!tasks[i].enabled) continue;
+    if (isDue(now, tasks[i].nextRun)) {
+      idle = 0;
+      break;
+    }
+    unsigned long untilDue = tasks[i].nextRun - now;
+    if (untilDue < idle) {
+      idle = untilDue;
+    }
+  }
+  if (idle == ULONG_MAX) {
+    idle = 0;
+  }
+
+  cycleCount++;
+  lastIdleMs = idle;
+  totalIdleMs += idle;
+  if (idle < minIdleMs) {
+    minIdleMs = idle;
+  }
+
+  return idle;
+}
+
+unsigned long TaskScheduler::getAverageIdleTime() const {
+  return (cycleCount > 0) ? (totalIdleMs / cycleCount) : 0;
+}
+
+void TaskScheduler::resetStatistics() {
+  cycleCount = 0;
+  lastIdleMs = 0;
+  minIdleMs = ULONG_MAX;
+  totalIdleMs = 0;
+
+  for (int i = 0; i < taskCount; i++) {
+    tasks[i].runCount = 0;
+    tasks[i].maxDurationUs = 0;
+    tasks[i].maxLatenessMs = 0;
+  }
+}
+
+void TaskScheduler::printStatus() {
+  Serial.println("[SCHED] Task table:");
+  for (int i = 0; i < taskCount; i++) {
+    const ScheduledTask& task = tasks[i];
+    Serial.printf("  %-12s %s every %lums  runs=%lu  last=%luus  max=%luus  late=%lums\n",
+                  task.name,
+                  task.oneShot ? "once " : "     ",
+                  task.interval,
+                  task.runCount,
+                  task.lastDurationUs,
+                  task.maxDurationUs,
+                  task.maxLatenessMs);
+  }
+  Serial.printf("[SCHED] Idle: last=%lums  min=%lums  avg=%lums  cycles=%lu\n",
+                lastIdleMs,
+                (minIdleMs == ULONG_MAX) ? 0UL : minIdleMs,
+                getAverageIdleTime(),
+                cycleCount);
+}
@@ -0,0 +1,67 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Cooperative task callback. Tasks must return quickly and never call delay().
+typedef void (*TaskCallback)();
+
+struct ScheduledTask {
+  const char* name;
+  TaskCallback callback;
+  unsigned long interval;      // Period in ms (ignored for one-shot tasks)
+  unsigned long nextRun;       // Deadline (millis) of the next run
+  bool enabled;
+  bool oneShot;
+  unsigned long runCount;
+  unsigned long lastDurationUs;
+  unsigned long maxDurationUs;
+  unsigned long maxLatenessMs; // Worst observed delay past the deadline
+};
+
+class TaskScheduler {
+private:
+  ScheduledTask tasks[MAX_SCHEDULED_TASKS];
+  int taskCount;
+
+  // Idle statistics (time left before the next deadline after each cycle)
+  unsigned long cycleCount;
+  unsigned long lastIdleMs;
+  unsigned long minIdleMs;
+  unsigned long totalIdleMs;
+
+  int addTask(const char* name, TaskCallback callback, unsigned long interval,
+              unsigned long firstRunDelay, bool oneShot, bool enabled);
+  static bool isDue(unsigned long now, unsigned long deadline) {
+    return (long)(now - deadline) >= 0;
+  }
+
+public:
+  TaskScheduler();
+
+  // Registration (returns task id, or -1 if the table is full)
+  int addPeriodic(const char* name, TaskCallback callback, unsigned long intervalMs,
+                  unsigned long firstRunDelayMs = 0);
+  int addOneShot(const char* name, TaskCallback callback);
+
+  // Control
+  void trigger(int taskId, unsigned long delayMs = 0);  // Arm/re-arm with a deadline
+  void cancel(int taskId);
+  void setInterval(int taskId, unsigned long intervalMs);
+  bool isPending(int taskId) const;
+
+  // Runs every task whose deadline has passed and returns the idle budget
+  // (ms until the next deadline) left in this cycle.
+  unsigned long run();
+
+  // Statistics
+  unsigned long getLastIdleTime() const { return lastIdleMs; }
+  unsigned long getMinIdleTime() const { return minIdleMs; }
+  unsigned long getAverageIdleTime() const;
+  unsigned long getCycleCount() const { return cycleCount; }
+  void resetStatistics();
+  void printStatus();
+};
+
+#endif // TASK_SCHEDULER_H
@@ -0,0 +1,120 @@
+#include "TransportSelector.h"
+
+static const char* transportLabels[SCAN_TRANSPORT_COUNT] = {"ws", "http", "cache"};
+
+TransportSelector::TransportSelector()
+  : current(SCAN_TRANSPORT_WEBSOCKET), lastSwitchAt(0), forcedOff(false),
+    switches(0), forced(0), wsChosen(0), httpChosen(0) {
+  memset(&ws, 0, sizeof(ws));
+  memset(&http, 0, sizeof(http));
+}
+
+uint32_t TransportSelector::cost(const PathStats& stats, uint32_t timeoutMs) const {
+  // Expected time to an answer: the RTT, plus the timeout paid on a loss
+  return stats.rttMs + (uint32_t)(stats.loss * timeoutMs);
+}
+
+void TransportSelector::switchTo(ScanTransport transport, unsigned long now, const char* why) {
+  Serial.printf("[TRANSPORT] %s -> %s (%s)\n",
+                transportLabels[current], transportLabels[transport], why);
+  current = transport;
+  lastSwitchAt = now;
+}
+
+ScanTransport TransportSelector::choose(bool wsHealthy, unsigned long now) {
+  if (!wsHealthy) {
+    if (current == SCAN_TRANSPORT_WEBSOCKET) {
+      forced++;
+      switchTo(SCAN_TRANSPORT_HTTP, now, "socket not healthy");
+      forcedOff = true;
+    }
+    httpChosen++;
+    return SCAN_TRANSPORT_HTTP;
+  }
+
+  // The socket is the default until measurements say otherwise
+  ScanTransport better = SCAN_TRANSPORT_WEBSOCKET;
+  if (ws.samples >= TRANSPORT_MIN_SAMPLES && http.samples >= TRANSPORT_MIN_SAMPLES) {
+    uint32_t wsCost = cost(ws, WS_SCAN_ACK_TIMEOUT);
+    uint32_t httpCost = cost(http, API_TIMEOUT_MS);
+    better = current;
+    if (current == SCAN_TRANSPORT_WEBSOCKET &&
+        httpCost * (100 + TRANSPORT_SWITCH_MARGIN_PCT) < wsCost * 100) {
+      better = SCAN_TRANSPORT_HTTP;
+    } else if (current == SCAN_TRANSPORT_HTTP &&
+               wsCost * (100 + TRANSPORT_SWITCH_MARGIN_PCT) < httpCost * 100) {
+      better = SCAN_TRANSPORT_WEBSOCKET;
+    }
+  }
+
+  // A socket that just came back is not held off by the dwell time
+  if (better != current && (forcedOff || now - lastSwitchAt >= TRANSPORT_MIN_DWELL)) {
+    if (!forcedOff) {
+      switches++;
+    }
+    switchTo(better, now, forcedOff ? "socket healthy again" : "measured faster");
+    forcedOff = false;
+  }
+
+  if (current == SCAN_TRANSPORT_WEBSOCKET) {
+    wsChosen++;
+  } else {
+    httpChosen++;
+  }
+  return current;
+}
+
+void TransportSelector::recordSuccess(ScanTransport transport, uint32_t rttMs, unsigned long now) {
+  PathStats& stats = path(transport);
+  if (stats.samples == 0) {
+    stats.rttMs = rttMs;
+  } else {
+    // Same smoothing as TCP's SRTT: new = old + (sample - old) / 8
+    int32_t delta = (int32_t)rttMs - (int32_t)stats.rttMs;
+    stats.rttMs = (uint32_t)((int32_t)stats.rttMs + delta / (1 << TRANSPORT_EWMA_SHIFT));
+  }
+  stats.loss -= stats.loss / (1 << TRANSPORT_EWMA_SHIFT);
+  stats.samples++;
+  stats.lastSampleAt = now;
+}
+
+void TransportSelector::recordLoss(ScanTransport transport, unsigned long now) {
+  PathStats& stats = path(transport);
+  stats.loss += (1.0f - stats.loss) / (1 << TRANSPORT_EWMA_SHIFT);
+  stats.samples++;
+  stats.losses++;
+  stats.lastSampleAt = now;
+}
+
+bool TransportSelector::httpUsable() const {
+  return http.samples > http.losses && http.loss < 0.5f;
+}
+
+void TransportSelector::report(JsonObject obj) const {
+  obj["current"] = transportLabels[current];
+  obj["switches"] = switches;
+  obj["forced"] = forced;
+  obj["wsChosen"] = wsChosen;
+  obj["httpChosen"] = httpChosen;
+  const PathStats* paths[2] = {&ws, &http};
+  for (int i = 0; i < 2; i++) {
+    JsonObject entry = obj.createNestedObject(transportLabels[i]);
+    entry["rttMs"] = paths[i]->rttMs;
+    entry["lossPct"] = (int)(paths[i]->loss * 100 + 0.5f);
+    entry["samples"] = paths[i]->samples;
+    entry["losses"] = paths[i]->losses;
+  }
+}
+
+void TransportSelector::printStatus() {
+  Serial.printf("[TRANSPORT] current=%s switches=%lu forced=%lu chosen ws=%lu http=%lu\n",
+                transportLabels[current], (unsigned long)switches, (unsigned long)forced,
+                (unsigned long)wsChosen, (unsigned long)httpChosen);
+  const PathStats* paths[2] = {&ws, &http};
+  for (int i = 0; i < 2; i++) {
+    Serial.printf("[TRANSPORT] %s rtt=%lums loss=%d%% samples=%lu losses=%lu\n",
+                  transportLabels[i], (unsigned long)paths[i]->rttMs,
+                  (int)(paths[i]->loss * 100 + 0.5f),
+                  (unsigned long)paths[i]->samples, (unsigned long)paths[i]->losses);
+  }
+}
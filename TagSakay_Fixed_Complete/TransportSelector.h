@@ -0,0 +1,67 @@
+#ifndef TRANSPORT_SELECTOR_H
+#define TRANSPORT_SELECTOR_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "Config.h"
+#include "LatencyStats.h"
+
+// Chooses the path for each live scan: WebSocket or HTTP, whichever is
+// answering faster. Each path keeps a smoothed RTT and loss rate (EWMA,
+// weight 1/2^TRANSPORT_EWMA_SHIFT) fed by scans and by the background
+// traffic both paths carry anyway (WebSocket heartbeats, HTTP syncs), so
+// the path not in use is still measured. A path's cost is its RTT plus the
+// timeout it wastes on a loss; the selector moves only when the other path
+// is cheaper by TRANSPORT_SWITCH_MARGIN and the current one has been held
+// for TRANSPORT_MIN_DWELL, so it does not flap on noise. A socket that is
+// not healthy forces HTTP at once. Network core only.
+class TransportSelector {
+public:
+  struct PathStats {
+    uint32_t rttMs;           // Smoothed round trip (0 until the first sample)
+    float loss;               // Smoothed loss rate, 0..1
+    uint32_t samples;
+    uint32_t losses;
+    unsigned long lastSampleAt;
+  };
+
+private:
+  PathStats ws;
+  PathStats http;
+  ScanTransport current;
+  unsigned long lastSwitchAt;
+  bool forcedOff;             // On HTTP only because the socket was down
+
+  // Statistics
+  uint32_t switches;          // Moves on measured cost
+  uint32_t forced;            // Moves to HTTP because the socket was not healthy
+  uint32_t wsChosen;
+  uint32_t httpChosen;
+
+  PathStats& path(ScanTransport transport) { return transport == SCAN_TRANSPORT_WEBSOCKET ? ws : http; }
+  uint32_t cost(const PathStats& stats, uint32_t timeoutMs) const;
+  void switchTo(ScanTransport transport, unsigned long now, const char* why);
+
+public:
+  TransportSelector();
+
+  // Path for the next live scan
+  ScanTransport choose(bool wsHealthy, unsigned long now);
+  ScanTransport getCurrent() const { return current; }
+
+  // Measurements (scans, heartbeats, syncs)
+  void recordSuccess(ScanTransport transport, uint32_t rttMs, unsigned long now);
+  void recordLoss(ScanTransport transport, unsigned long now);
+
+  // HTTP has been answering: a scan past its WebSocket ack deadline is
+  // moved there rather than resent on the socket
+  bool httpUsable() const;
+
+  const PathStats& getStats(ScanTransport transport) const {
+    return transport == SCAN_TRANSPORT_WEBSOCKET ? ws : http;
+  }
+  void report(JsonObject obj) const;
+  void printStatus();
+};
+
+#endif // TRANSPORT_SELECTOR_H
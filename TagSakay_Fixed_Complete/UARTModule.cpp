@@ -19,8 +19,17 @@ void sendToLEDMatrix(const String& command, const String& param1, const String&
   Serial.print("Sending to LED Matrix: ");
   Serial.println(message);
 
+  // Newline-framed messages fit in the UART FIFO; no need to block on flush()
   UARTSerial.print(message);
-  UARTSerial.flush();  // Wait for transmission to complete
+}
+
+void sendToLEDMatrix(const char* command, const char* param1, const char* param2) {
+  // Scan path: formats straight into the UART without building a String
+  char message[64];
+  snprintf(message, sizeof(message), "%s|%s|%s\n", command, param1, param2);
 
-  delay(50);  // Small delay to ensure message is sent
-}
\ No newline at end of file
+  Serial.print("Sending to LED Matrix: ");
+  Serial.println(message);
+
+  UARTSerial.print(message);
+}
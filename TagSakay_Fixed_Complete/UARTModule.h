@@ -10,5 +10,6 @@ extern HardwareSerial UARTSerial;
 // UART operations
 void initializeUART();
 void sendToLEDMatrix(const String& command, const String& param1, const String& param2);
+void sendToLEDMatrix(const char* command, const char* param1, const char* param2);
 
 #endif // UART_MODULE_H
\ No newline at end of file
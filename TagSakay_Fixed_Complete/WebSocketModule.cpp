@@ -1,16 +1,39 @@
 #include "WebSocketModule.h"
+#include "DeviceWire.h"
+#include "MsgPack.h"
 
 // Static instance pointer for callback
 WebSocketModule* WebSocketModule::instance = nullptr;
 
 WebSocketModule::WebSocketModule() {
   ws = new WebSocketsClient();
+  started = false;
   connected = false;
+  healthy = false;
   lastHeartbeat = 0;
-  lastReconnectAttempt = 0;
+  awaitingAck = false;
+  heartbeatSentAt = 0;
+  failures = 0;
+  reconnectDelay = WS_RECONNECT_INTERVAL;
+  lastAttemptAt = 0;
+  connectedAt = 0;
+  connects = 0;
+  disconnects = 0;
+  flaps = 0;
+  ackTimeouts = 0;
+  attempts = 0;
+  totalUptimeMs = 0;
+  lastUptimeMs = 0;
+  txFrames = 0;
+  txBytes = 0;
+  rxFrames = 0;
+  rxBytes = 0;
+  binaryFrames = WS_BINARY_FRAMES;
   onScanResponseCallback = nullptr;
   onConfigUpdateCallback = nullptr;
   onConnectionStatusCallback = nullptr;
+  onCommandsCallback = nullptr;
+  onHeartbeatAckCallback = nullptr;
   instance = this;
 }
 
@@ -20,35 +43,129 @@ WebSocketModule::~WebSocketModule() {
   }
 }
 
-void WebSocketModule::begin(String deviceId) {
+void WebSocketModule::begin(String deviceId, const char* apiKey) {
   this->deviceId = deviceId;
   
-  // Build WebSocket path with deviceId
+  // Build WebSocket path with deviceId; binary builds ask for their command
+  // pushes in MessagePack too
   String path = String(WS_PATH) + "?deviceId=" + deviceId;
+  if (binaryFrames) {
+    path += "&encoding=msgpack";
+  }
+  
+  // The upgrade is authenticated like the HTTP API (copied by the library)
+  String authHeader = String("X-API-Key: ") + apiKey;
+  ws->setExtraHeaders(authHeader.c_str());
   
   // Connect to WebSocket server
   ws->begin(WS_HOST, WS_PORT, path);
   ws->onEvent(staticWebSocketEvent);
   
-  // Set reconnect interval
-  ws->setReconnectInterval(WS_RECONNECT_INTERVAL);
+  // First attempt happens on the next loop(); retries follow the backoff
+  failures = 0;
+  lastAttemptAt = millis();
+  scheduleReconnect();
+  started = true;
   
   Serial.println("[WS] Initializing WebSocket...");
   Serial.printf("[WS] Connecting to: %s:%d%s\n", WS_HOST, WS_PORT, path.c_str());
 }
 
 void WebSocketModule::loop() {
+  if (!started) return;
+  
+  // Always serviced: while the socket is down this is where the library
+  // makes its reconnect attempts
   ws->loop();
   
-  // Send heartbeat every 30 seconds if connected
-  if (connected && (millis() - lastHeartbeat > WS_PING_INTERVAL)) {
-    sendHeartbeat();
+  unsigned long now = millis();
+  if (connected) {
+    // An open socket the server no longer answers is as good as closed
+    if (awaitingAck && now - heartbeatSentAt >= WS_HEARTBEAT_ACK_TIMEOUT) {
+      ackTimeouts++;
+      Serial.printf("[WS] No heartbeat_ack for %lums - dropping connection\n",
+                    now - heartbeatSentAt);
+      ws->disconnect();
+      if (connected) {
+        handleDisconnected();  // In case the library raised no event for it
+      }
+      return;
+    }
+    
+    if (now - lastHeartbeat >= WS_PING_INTERVAL) {
+      sendHeartbeat();
+    }
+    return;
+  }
+  
+  // The library retries once per reconnect interval and raises no event
+  // for a failed attempt, so each interval that passes without a
+  // connection counts as one and widens the next
+  if (now - lastAttemptAt >= reconnectDelay) {
+    lastAttemptAt = now;
+    attempts++;
+    if (failures < 255) failures++;
+    scheduleReconnect();
+  }
+}
+
+void WebSocketModule::scheduleReconnect() {
+  unsigned long ceiling = WS_RECONNECT_INTERVAL;
+  for (uint8_t i = 0; i < failures && ceiling < WS_RECONNECT_MAX; i++) {
+    ceiling *= 2;
+  }
+  if (ceiling > WS_RECONNECT_MAX) {
+    ceiling = WS_RECONNECT_MAX;
+  }
+  
+  // Half fixed, half random: devices that lost the server together do not
+  // all come back in the same second
+  reconnectDelay = ceiling / 2 + esp_random() % (ceiling / 2 + 1);
+  ws->setReconnectInterval(reconnectDelay);
+}
+
+void WebSocketModule::handleConnected() {
+  connected = true;
+  healthy = false;
+  awaitingAck = false;
+  connectedAt = millis();
+  connects++;
+  
+  // Not healthy until the server answers; ask straight away
+  sendHeartbeat();
+}
+
+void WebSocketModule::handleDisconnected() {
+  unsigned long now = millis();
+  
+  if (connected) {
+    lastUptimeMs = now - connectedAt;
+    totalUptimeMs += lastUptimeMs;
+    disconnects++;
+    
+    // A stable connection resets the backoff; one that never became
+    // healthy or dropped soon after keeps it growing
+    if (!healthy || lastUptimeMs < WS_FLAP_WINDOW) {
+      flaps++;
+      if (failures < 255) failures++;
+    } else {
+      failures = 0;
+    }
+    Serial.printf("[WS] Connection lasted %lums (flaps=%lu)\n",
+                  lastUptimeMs, (unsigned long)flaps);
   }
   
-  // Attempt reconnection if disconnected
-  if (!connected && (millis() - lastReconnectAttempt > WS_RECONNECT_INTERVAL)) {
-    lastReconnectAttempt = millis();
-    Serial.println("[WS] Attempting to reconnect...");
+  connected = false;
+  awaitingAck = false;
+  lastAttemptAt = now;
+  scheduleReconnect();
+  Serial.printf("[WS] Reconnecting in %lums\n", reconnectDelay);
+  
+  if (healthy) {
+    healthy = false;
+    if (onConnectionStatusCallback) {
+      onConnectionStatusCallback(false);
+    }
   }
 }
 
@@ -56,53 +173,129 @@ bool WebSocketModule::isConnected() {
   return connected;
 }
 
-void WebSocketModule::sendScan(String tagId, String location) {
+bool WebSocketModule::sendScan(const TagUid& tag, const char* location, uint32_t seq) {
   if (!connected) {
     Serial.println("[WS] Not connected - cannot send scan");
-    return;
+    return false;
   }
   
-  JsonDocument doc;
+  // Hot path: fixed document and stack buffer, no heap
+  TagIdText tagId = tag.toText();
+  if (binaryFrames) {
+    uint8_t frame[96];
+    MsgPackWriter writer(frame, sizeof(frame));
+    writer.map(5);
+    writer.field(WIRE_KEY_ACTION, (uint64_t)WIRE_SCAN);
+    writer.field(WIRE_KEY_SEQ, (uint64_t)seq);
+    writer.field(WIRE_KEY_TAG_ID, tagId.c_str());
+    writer.field(WIRE_KEY_LOCATION, location);
+    writer.field(WIRE_KEY_TIMESTAMP, (uint64_t)millis());
+    return sendBinary(frame, writer.size());
+  }
+  
+  StaticJsonDocument<192> doc;
   doc["action"] = "scan";
-  doc["tagId"] = tagId;
+  doc["seq"] = seq;
+  doc["tagId"] = tagId.c_str();
   doc["location"] = location;
   doc["timestamp"] = millis();
   
-  String message;
-  serializeJson(doc, message);
+  char message[192];
+  size_t length = serializeJson(doc, message, sizeof(message));
   
-  ws->sendTXT(message);
-  Serial.println("[WS] Scan sent: " + tagId);
+  return sendText(message, length);
 }
 
 void WebSocketModule::sendHeartbeat() {
   if (!connected) return;
   
-  JsonDocument doc;
-  doc["action"] = "heartbeat";
-  doc["timestamp"] = millis();
-  
-  String message;
-  serializeJson(doc, message);
-  
-  ws->sendTXT(message);
+  if (binaryFrames) {
+    uint8_t frame[16];
+    MsgPackWriter writer(frame, sizeof(frame));
+    writer.map(2);
+    writer.field(WIRE_KEY_ACTION, (uint64_t)WIRE_HEARTBEAT);
+    writer.field(WIRE_KEY_TIMESTAMP, (uint64_t)millis());
+    sendBinary(frame, writer.size());
+  } else {
+    JsonDocument doc;
+    doc["action"] = "heartbeat";
+    doc["timestamp"] = millis();
+    
+    String message;
+    serializeJson(doc, message);
+    sendText(message.c_str(), message.length());
+  }
   lastHeartbeat = millis();
+  if (!awaitingAck) {
+    awaitingAck = true;
+    heartbeatSentAt = lastHeartbeat;
+  }
   Serial.println("[WS] Heartbeat sent");
 }
 
 void WebSocketModule::sendConfig(bool registrationMode, bool scanMode) {
   if (!connected) return;
   
-  JsonDocument doc;
-  doc["action"] = "config";
-  doc["registrationMode"] = registrationMode;
-  doc["scanMode"] = scanMode;
+  if (binaryFrames) {
+    uint8_t frame[16];
+    MsgPackWriter writer(frame, sizeof(frame));
+    writer.map(3);
+    writer.field(WIRE_KEY_ACTION, (uint64_t)WIRE_CONFIG);
+    writer.field(WIRE_KEY_REGISTRATION_MODE, registrationMode);
+    writer.field(WIRE_KEY_SCAN_MODE, scanMode);
+    sendBinary(frame, writer.size());
+  } else {
+    JsonDocument doc;
+    doc["action"] = "config";
+    doc["registrationMode"] = registrationMode;
+    doc["scanMode"] = scanMode;
+    
+    String message;
+    serializeJson(doc, message);
+    sendText(message.c_str(), message.length());
+  }
+  Serial.println("[WS] Config update sent");
+}
+
+void WebSocketModule::sendCommandAck(uint32_t id, const char* version) {
+  if (!connected) return;
   
-  String message;
-  serializeJson(doc, message);
+  if (binaryFrames) {
+    uint8_t frame[64];
+    MsgPackWriter writer(frame, sizeof(frame));
+    writer.map(3);
+    writer.field(WIRE_KEY_ACTION, (uint64_t)WIRE_COMMAND_ACK);
+    writer.field(WIRE_KEY_ID, (uint64_t)id);
+    writer.field(WIRE_KEY_VERSION, version);
+    sendBinary(frame, writer.size());
+    return;
+  }
   
-  ws->sendTXT(message);
-  Serial.println("[WS] Config update sent");
+  StaticJsonDocument<128> doc;
+  doc["action"] = "command_ack";
+  doc["id"] = id;
+  doc["version"] = version;
+  
+  char message[128];
+  size_t length = serializeJson(doc, message, sizeof(message));
+  
+  sendText(message, length);
+}
+
+bool WebSocketModule::sendText(const char* message, size_t length) {
+  txFrames++;
+  txBytes += length;
+  return ws->sendTXT(message, length);
+}
+
+bool WebSocketModule::sendBinary(uint8_t* frame, size_t length) {
+  if (length == 0) {
+    Serial.println("[WS] Binary frame overflow - not sent");
+    return false;
+  }
+  txFrames++;
+  txBytes += length;
+  return ws->sendBIN(frame, length);
 }
 
 void WebSocketModule::setOnScanResponse(void (*callback)(JsonDocument&)) {
@@ -117,6 +310,14 @@ void WebSocketModule::setOnConnectionStatus(void (*callback)(bool)) {
   onConnectionStatusCallback = callback;
 }
 
+void WebSocketModule::setOnCommands(bool (*callback)(JsonDocument&)) {
+  onCommandsCallback = callback;
+}
+
+void WebSocketModule::setOnHeartbeatAck(void (*callback)(uint32_t rttMs)) {
+  onHeartbeatAckCallback = callback;
+}
+
 void WebSocketModule::staticWebSocketEvent(WStype_t type, uint8_t* payload, size_t length) {
   if (instance) {
     instance->webSocketEvent(type, payload, length);
@@ -127,26 +328,29 @@ void WebSocketModule::webSocketEvent(WStype_t type, uint8_t* payload, size_t len
   switch(type) {
     case WStype_DISCONNECTED:
       Serial.println("[WS] Disconnected");
-      connected = false;
-      if (onConnectionStatusCallback) {
-        onConnectionStatusCallback(false);
+      if (connected) {
+        handleDisconnected();
       }
       break;
       
     case WStype_CONNECTED:
       Serial.printf("[WS] Connected to: %s\n", payload);
-      connected = true;
-      lastHeartbeat = millis();
-      if (onConnectionStatusCallback) {
-        onConnectionStatusCallback(true);
-      }
+      handleConnected();
       break;
       
     case WStype_TEXT:
       Serial.printf("[WS] Message received: %s\n", payload);
+      rxFrames++;
+      rxBytes += length;
       handleMessage(payload, length);
       break;
       
+    case WStype_BIN:
+      rxFrames++;
+      rxBytes += length;
+      handleBinaryMessage(payload, length);
+      break;
+      
     case WStype_ERROR:
       Serial.printf("[WS] Error: %s\n", payload);
       break;
@@ -171,6 +375,110 @@ void WebSocketModule::handleMessage(uint8_t* payload, size_t length) {
     return;
   }
   
+  dispatch(doc);
+}
+
+// Rebuilds the JSON shape of the message, so dispatch() and the callbacks
+// see the same document whichever format the server used
+void WebSocketModule::handleBinaryMessage(uint8_t* payload, size_t length) {
+  MsgPackReader reader(payload, length);
+  MsgPackValue header;
+  if (!reader.next(header) || header.type != MSGPACK_MAP) {
+    Serial.println("[WS] Binary frame is not a map - ignored");
+    return;
+  }
+  
+  StaticJsonDocument<512> doc;  // A rebuilt "commands" set is the largest
+  for (uint32_t i = 0; i < header.length; i++) {
+    MsgPackValue key;
+    MsgPackValue value;
+    if (!reader.next(key) || !reader.next(value) || key.type != MSGPACK_UINT) {
+      Serial.println("[WS] Malformed binary frame - ignored");
+      return;
+    }
+    
+    // Strings in the frame are not terminated; the document copies them
+    String text;
+    if (value.type == MSGPACK_STR) {
+      text.reserve(value.length);
+      for (uint32_t c = 0; c < value.length; c++) {
+        text += value.str[c];
+      }
+    }
+    
+    switch (key.uint) {
+      case WIRE_KEY_ACTION:
+        switch (value.uint) {
+          case WIRE_HEARTBEAT_ACK: doc["action"] = "heartbeat_ack"; break;
+          case WIRE_SCAN_RESULT:   doc["action"] = "scan_result"; break;
+          case WIRE_CONFIG:        doc["action"] = "config"; break;
+          case WIRE_COMMANDS:      doc["action"] = "commands"; break;
+          default:                 doc["action"] = "unknown"; break;
+        }
+        break;
+      case WIRE_KEY_TIMESTAMP:         doc["timestamp"] = value.uint; break;
+      case WIRE_KEY_SEQ:               doc["seq"] = (uint32_t)value.uint; break;
+      case WIRE_KEY_SUCCESS:           doc["success"] = value.boolean; break;
+      case WIRE_KEY_TAG_ID:            doc["scan"]["tagId"] = text; break;
+      case WIRE_KEY_REGISTERED:        doc["scan"]["isRegistered"] = value.boolean; break;
+      case WIRE_KEY_USER_NAME:         doc["user"]["name"] = text; break;
+      case WIRE_KEY_USER_ROLE:         doc["user"]["role"] = text; break;
+      case WIRE_KEY_ERROR:             doc["error"] = text; break;
+      case WIRE_KEY_ID:                doc["id"] = (uint32_t)value.uint; break;
+      case WIRE_KEY_VERSION:           doc["version"] = text; break;
+      case WIRE_KEY_REGISTRATION_MODE: doc["config"]["registrationMode"] = value.boolean; break;
+      case WIRE_KEY_SCAN_MODE:         doc["config"]["scanMode"] = value.boolean; break;
+      default:                         break;  // Newer key: skipped
+    }
+  }
+  
+  if (doc["action"] == "commands") {
+    rebuildCommands(doc);
+  }
+  
+  dispatch(doc);
+}
+
+// A binary "commands" push carries what the server derives the set from
+// (buildDeviceCommands() in the backend): the mode flags and, while
+// registering, the expected tag. Turn them back into the JSON push's
+// deviceStatus and commands list for parseCommandData().
+void WebSocketModule::rebuildCommands(JsonDocument& doc) {
+  bool hasRegistrationMode = !doc["config"]["registrationMode"].isNull();
+  bool hasScanMode = !doc["config"]["scanMode"].isNull();
+  bool registration = doc["config"]["registrationMode"] | false;
+  bool scanMode = doc["config"]["scanMode"] | false;
+  String tagId = doc["scan"]["tagId"] | "";
+  
+  // Decoded onto the config and scan keys, which dispatch() would take for
+  // a config update and a scan result
+  doc.remove("config");
+  doc.remove("scan");
+  
+  if (hasRegistrationMode) {
+    doc["deviceStatus"]["registrationMode"] = registration;
+  }
+  if (hasScanMode) {
+    doc["deviceStatus"]["scanMode"] = scanMode;
+  }
+  
+  JsonArray commands = doc.createNestedArray("commands");
+  if (registration && tagId.length() > 0) {
+    JsonObject command = commands.createNestedObject();
+    command["action"] = "enable_registration";
+    command["tagId"] = tagId;
+  } else if (!registration) {
+    JsonObject command = commands.createNestedObject();
+    command["action"] = "disable_registration";
+  }
+  JsonObject mode = commands.createNestedObject();
+  mode["action"] = "scan_mode";
+  if (hasScanMode) {
+    mode["enabled"] = scanMode;
+  }
+}
+
+void WebSocketModule::dispatch(JsonDocument& doc) {
   // Check if it's a scan response
   if (doc.containsKey("scan") && onScanResponseCallback) {
     onScanResponseCallback(doc);
@@ -181,10 +489,30 @@ void WebSocketModule::handleMessage(uint8_t* payload, size_t length) {
     onConfigUpdateCallback(doc);
   }
   
+  // Pushed command set: acknowledged once applied, so the server stops
+  // re-sending it. A set the handler rejects is left for the resend.
+  if (doc["action"] == "commands" && onCommandsCallback) {
+    if (onCommandsCallback(doc)) {
+      sendCommandAck(doc["id"] | 0, doc["version"] | "");
+    }
+  }
+  
   // Check for heartbeat acknowledgment
   if (doc["action"] == "heartbeat_ack") {
-    int scanCount = doc["scanCount"] | 0;
-    Serial.printf("[WS] Heartbeat acknowledged (scans: %d)\n", scanCount);
+    awaitingAck = false;
+    uint32_t rttMs = millis() - lastHeartbeat;
+    Serial.printf("[WS] Heartbeat acknowledged (%lums)\n", (unsigned long)rttMs);
+    if (onHeartbeatAckCallback) {
+      onHeartbeatAckCallback(rttMs);
+    }
+    
+    if (!healthy) {
+      healthy = true;
+      Serial.printf("[WS] Healthy %lums after connecting\n", millis() - connectedAt);
+      if (onConnectionStatusCallback) {
+        onConnectionStatusCallback(true);
+      }
+    }
   }
   
   // Check for error messages
@@ -193,3 +521,31 @@ void WebSocketModule::handleMessage(uint8_t* payload, size_t length) {
     Serial.printf("[WS] Error from server: %s\n", error);
   }
 }
+
+void WebSocketModule::report(JsonObject obj) const {
+  obj["healthy"] = healthy;
+  obj["uptimeMs"] = getUptimeMs();
+  obj["totalUptimeMs"] = totalUptimeMs + getUptimeMs();
+  obj["connects"] = connects;
+  obj["flaps"] = flaps;
+  obj["ackTimeouts"] = ackTimeouts;
+  obj["failedAttempts"] = attempts;
+  obj["encoding"] = binaryFrames ? "msgpack" : "json";
+  obj["txFrames"] = txFrames;
+  obj["txBytes"] = txBytes;
+  obj["rxFrames"] = rxFrames;
+  obj["rxBytes"] = rxBytes;
+}
+
+void WebSocketModule::printStatus() {
+  const char* state = healthy ? "healthy" : connected ? "unverified" : started ? "down" : "off";
+  Serial.printf("[WS] state=%s uptime=%lus total=%lus connects=%lu disconnects=%lu flaps=%lu "
+                "ackTimeouts=%lu failedAttempts=%lu backoff=%lums\n",
+                state, getUptimeMs() / 1000, (totalUptimeMs + getUptimeMs()) / 1000,
+                (unsigned long)connects, (unsigned long)disconnects, (unsigned long)flaps,
+                (unsigned long)ackTimeouts, (unsigned long)attempts, reconnectDelay);
+  Serial.printf("[WS] encoding=%s tx=%lu frames/%lu B rx=%lu frames/%lu B\n",
+                binaryFrames ? "msgpack" : "json",
+                (unsigned long)txFrames, (unsigned long)txBytes,
+                (unsigned long)rxFrames, (unsigned long)rxBytes);
+}
@@ -4,43 +4,98 @@
 #include <WebSocketsClient.h>
 #include <ArduinoJson.h>
 #include "Config.h"
+#include "TagUid.h"
 
+// WebSocket link to the backend. loop() must run whether or not the socket
+// is up: the library reconnects from inside it. Reconnects back off
+// exponentially with jitter, and the link only counts as healthy (and is
+// reported through onConnectionStatus) once the server has answered a
+// heartbeat on it; an open socket that stops answering is dropped.
+//
+// With WS_BINARY_FRAMES, scans, heartbeats, acks and config go out as
+// MessagePack frames with integer keys, and the server answers those in
+// kind. Received binary frames are decoded into the same document shape as
+// the JSON ones, so the callbacks do not care which format arrived.
 class WebSocketModule {
 private:
   WebSocketsClient* ws;
   String deviceId;
-  bool connected;
+  bool started;                 // begin() called
+  bool connected;               // Socket open
+  bool healthy;                 // heartbeat_ack received on this connection
   unsigned long lastHeartbeat;
-  unsigned long lastReconnectAttempt;
-  
+  bool awaitingAck;
+  unsigned long heartbeatSentAt;  // Oldest unanswered heartbeat
+  bool binaryFrames;            // WS_BINARY_FRAMES
+
+  // Reconnect backoff
+  uint8_t failures;             // Attempts and short-lived connections since the last stable one
+  unsigned long reconnectDelay; // Current jittered interval handed to the library
+  unsigned long lastAttemptAt;
+
+  // Statistics
+  unsigned long connectedAt;
+  uint32_t connects;
+  uint32_t disconnects;
+  uint32_t flaps;               // Lost before healthy or within WS_FLAP_WINDOW
+  uint32_t ackTimeouts;
+  uint32_t attempts;
+  unsigned long totalUptimeMs;
+  unsigned long lastUptimeMs;
+  uint32_t txFrames;
+  uint32_t txBytes;
+  uint32_t rxFrames;
+  uint32_t rxBytes;
+
   // Callback for received messages
   void (*onScanResponseCallback)(JsonDocument&);
   void (*onConfigUpdateCallback)(JsonDocument&);
   void (*onConnectionStatusCallback)(bool);
+  bool (*onCommandsCallback)(JsonDocument&);  // true: set applied (or already held)
+  void (*onHeartbeatAckCallback)(uint32_t);    // Round trip of the answered heartbeat (ms)
 
 public:
   WebSocketModule();
   ~WebSocketModule();
-  
-  void begin(String deviceId);
+
+  void begin(String deviceId, const char* apiKey);
   void loop();
   bool isConnected();
-  void sendScan(String tagId, String location = "");
+  bool isHealthy() const { return healthy; }
+  bool sendScan(const TagUid& tag, const char* location, uint32_t seq);  // Echoed in scan_result
   void sendHeartbeat();
   void sendConfig(bool registrationMode, bool scanMode);
+  void sendCommandAck(uint32_t id, const char* version);
   void setOnScanResponse(void (*callback)(JsonDocument&));
   void setOnConfigUpdate(void (*callback)(JsonDocument&));
   void setOnConnectionStatus(void (*callback)(bool));
-  
+  void setOnCommands(bool (*callback)(JsonDocument&));
+  void setOnHeartbeatAck(void (*callback)(uint32_t rttMs));
+
+  // Diagnostics
+  unsigned long getUptimeMs() const { return connected ? millis() - connectedAt : 0; }
+  uint32_t getFlaps() const { return flaps; }
+  uint32_t getConnects() const { return connects; }
+  void report(JsonObject obj) const;
+  void printStatus();
+
 private:
-  void connect();
-  void reconnect();
+  void scheduleReconnect();
+  void handleConnected();
+  void handleDisconnected();
+  bool sendText(const char* message, size_t length);
+  bool sendBinary(uint8_t* frame, size_t length);
   void handleMessage(uint8_t* payload, size_t length);
+  void handleBinaryMessage(uint8_t* payload, size_t length);
+  void rebuildCommands(JsonDocument& doc);
+  void dispatch(JsonDocument& doc);
   void webSocketEvent(WStype_t type, uint8_t* payload, size_t length);
-  
+
   // Static callback handler
   static WebSocketModule* instance;
   static void staticWebSocketEvent(WStype_t type, uint8_t* payload, size_t length);
 };
 
+extern WebSocketModule wsModule;
+
 #endif
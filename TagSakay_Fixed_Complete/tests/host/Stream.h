@@ -0,0 +1,2 @@
+// Some libraries include the core's Stream.h directly
+#include <Arduino.h>
@@ -0,0 +1,68 @@
+#ifndef HOST_WIFI_CLIENT_H
+#define HOST_WIFI_CLIENT_H
+
+#include <Arduino.h>
+
+// Host stand-in for a connected socket: plays back the bytes a server sent.
+// They arrive segment bytes at a time; a read() that finds the current
+// segment used up returns -1 (nothing yet, as on a real socket) and the
+// next segment "arrives" - at once, or intervalMs after the previous one
+// for a slow server. closeAtEnd drops the connection after the last byte,
+// as a server does for a body without Content-Length.
+class WiFiClient : public Stream {
+private:
+  const char* data;
+  size_t length;
+  size_t position;
+  size_t arrived;     // Bytes received so far
+  size_t segment;
+  bool closeAtEnd;
+  unsigned long interval;
+  unsigned long arrivedAt;
+
+public:
+  unsigned long polls;  // read() calls that found nothing
+
+  WiFiClient()
+    : data(nullptr), length(0), position(0), arrived(0), segment(0), closeAtEnd(false),
+      interval(0), arrivedAt(0), polls(0) {}
+
+  void load(const char* bytes, size_t count, size_t segmentSize, bool close,
+            unsigned long intervalMs = 0) {
+    data = bytes;
+    length = count;
+    position = 0;
+    segment = segmentSize ? segmentSize : count;
+    arrived = segment < count ? segment : count;
+    closeAtEnd = close;
+    interval = intervalMs;
+    arrivedAt = millis();
+    polls = 0;
+  }
+
+  // Bytes not read yet (e.g. the start of the next response)
+  const char* unread() const { return data + position; }
+  size_t unreadLength() const { return length - position; }
+
+  int available() override { return (int)(arrived - position); }
+
+  int read() override {
+    if (position == arrived) {
+      polls++;
+      if (millis() - arrivedAt >= interval) {
+        arrived = arrived + segment < length ? arrived + segment : length;
+        arrivedAt = millis();
+      }
+      return -1;
+    }
+    return (unsigned char)data[position++];
+  }
+
+  int peek() override { return position < arrived ? (unsigned char)data[position] : -1; }
+
+  size_t write(uint8_t) override { return 0; }
+
+  uint8_t connected() { return position < length || !closeAtEnd; }
+};
+
+#endif // HOST_WIFI_CLIENT_H
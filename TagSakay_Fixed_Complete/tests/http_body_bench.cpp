@@ -0,0 +1,267 @@
+// ============================================================================
+// HTTP BODY PARSE BENCHMARK
+// ============================================================================
+// Parses the backend's replies with the firmware's response filters two ways:
+// streamed through HttpBodyStream into deserializeJson() (ApiModule today),
+// and read whole into a buffer first, as HTTPClient::getString() does, then
+// parsed. Each reply goes over the wire with Content-Length, chunked and
+// until-close framing. Reports parse time and peak heap per reply; both
+// paths must yield the same document.
+//
+// Needs the ArduinoJson library (v6 or v7); see the Makefile.
+//
+// Usage: make -C TagSakay_Fixed_Complete/tests bench
+
+#define ARDUINOJSON_ENABLE_ARDUINO_STREAM 1
+#include <ArduinoJson.h>
+
+#include "HttpBodyStream.h"
+
+#include <stdlib.h>
+#include <memory>
+#include <new>
+#include <string>
+
+static const int ITERATIONS = 2000;
+static const size_t TCP_SEGMENT = 1436;    // HTTP_TCP_BUFFER_SIZE in the ESP32 core
+static const size_t CHUNK_SIZE = 256;
+static const unsigned long TIMEOUT_MS = 100;
+
+// Kept in step with ApiModule.cpp and NetworkModule.cpp
+static const char SCAN_VERDICT_FILTER[] = "{\"data\":{\"user\":{\"name\":true,\"role\":true}}}";
+static const char COMMANDS_FILTER[] =
+  "{\"message\":true,\"data\":{\"deviceStatus\":{\"registrationMode\":true,\"scanMode\":true},"
+  "\"commands\":[{\"action\":true,\"tagId\":true,\"enabled\":true}]}}";
+
+// ---------------------------------------------------------------------------
+// Heap accounting: operator new and the documents' allocator both count here
+// ---------------------------------------------------------------------------
+
+static size_t liveBytes = 0;
+static size_t peakBytes = 0;
+
+static void track(size_t added, size_t removed) {
+  liveBytes += added - removed;
+  if (liveBytes > peakBytes) peakBytes = liveBytes;
+}
+
+// Each block carries its size so frees can be counted. Kept out of line:
+// inlined into the replaced operator new/delete, GCC misreads the header.
+static const size_t HEADER = alignof(max_align_t);
+
+__attribute__((noinline)) static void* countedAlloc(size_t size) {
+  char* block = (char*)malloc(size + HEADER);
+  if (!block) return nullptr;
+  *(size_t*)block = size;
+  track(size, 0);
+  return block + HEADER;
+}
+
+__attribute__((noinline)) static void countedFree(void* p) {
+  if (!p) return;
+  char* block = (char*)p - HEADER;
+  track(0, *(size_t*)block);
+  free(block);
+}
+
+static void* countedRealloc(void* p, size_t size) {
+  if (!p) return countedAlloc(size);
+  char* block = (char*)p - HEADER;
+  size_t old = *(size_t*)block;
+  char* grown = (char*)realloc(block, size + HEADER);
+  if (!grown) return nullptr;
+  *(size_t*)grown = size;
+  track(size, old);
+  return grown + HEADER;
+}
+
+void* operator new(size_t size) {
+  void* p = countedAlloc(size);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, size_t) noexcept { countedFree(p); }
+
+#if ARDUINOJSON_VERSION_MAJOR >= 7
+class CountingAllocator : public ArduinoJson::Allocator {
+public:
+  void* allocate(size_t size) override { return countedAlloc(size); }
+  void deallocate(void* p) override { countedFree(p); }
+  void* reallocate(void* p, size_t size) override { return countedRealloc(p, size); }
+};
+static CountingAllocator countingAllocator;
+#define COUNTED_DOCUMENT(name, capacity) JsonDocument name(&countingAllocator)
+#else
+struct CountingAllocator {
+  void* allocate(size_t size) { return countedAlloc(size); }
+  void deallocate(void* p) { countedFree(p); }
+  void* reallocate(void* p, size_t size) { return countedRealloc(p, size); }
+};
+// On the device these are StaticJsonDocuments of the same capacity
+#define COUNTED_DOCUMENT(name, capacity) BasicJsonDocument<CountingAllocator> name(capacity)
+#endif
+
+// ---------------------------------------------------------------------------
+// Replies and their framing
+// ---------------------------------------------------------------------------
+
+struct Reply {
+  const char* name;
+  const char* body;
+  const char* filter;
+  size_t capacity;  // The firmware's document for it
+};
+
+// Shapes as recordDeviceScan() (routes/rfid.ts) and /sync (routes/device.ts)
+// send them
+static const Reply replies[] = {
+  {"scan 200", "{\"success\":true,\"message\":\"Scan recorded successfully\",\"data\":{"
+               "\"scan\":{\"id\":\"5f0c1e2a-8b7d-4c3e-9a1f-2d6b7e8f9a0b\",\"tagId\":\"04A1B2C3D4E5F6\","
+               "\"scanTime\":\"2026-10-16T08:15:42.123Z\",\"status\":\"success\",\"eventType\":\"entry\"},"
+               "\"user\":{\"id\":\"9b8a7c6d-5e4f-4a3b-8c2d-1e0f9a8b7c6d\",\"name\":\"Juan Dela Cruz\","
+               "\"role\":\"driver\"},\"rfid\":{\"tagId\":\"04A1B2C3D4E5F6\",\"isActive\":true}}}",
+   SCAN_VERDICT_FILTER, 256},
+  {"scan 404", "{\"success\":false,\"message\":\"RFID tag not registered\","
+               "\"data\":{\"tagId\":\"DEADBEEF\",\"registered\":false}}",
+   SCAN_VERDICT_FILTER, 256},
+  {"sync 200", "{\"success\":true,\"message\":\"Device synced\",\"data\":{\"commands\":["
+               "{\"action\":\"enable_registration\",\"tagId\":\"04A1B2C3D4E5F6\",\"timestamp\":1792138542123},"
+               "{\"action\":\"scan_mode\",\"enabled\":true,\"timestamp\":1792138542123}],"
+               "\"deviceStatus\":{\"isActive\":true,\"registrationMode\":true,\"scanMode\":true},"
+               "\"telemetryAccepted\":2}}",
+   COMMANDS_FILTER, 512},
+};
+
+enum Framing { FRAMING_LENGTH, FRAMING_CHUNKED, FRAMING_CLOSE };
+static const char* framingNames[] = {"length", "chunked", "close"};
+
+static std::string frameBody(const std::string& body, Framing framing) {
+  if (framing != FRAMING_CHUNKED) return body;
+  std::string wire;
+  char size[16];
+  for (size_t at = 0; at < body.size(); at += CHUNK_SIZE) {
+    size_t n = body.size() - at < CHUNK_SIZE ? body.size() - at : CHUNK_SIZE;
+    snprintf(size, sizeof(size), "%zx\r\n", n);
+    wire += size;
+    wire.append(body, at, n);
+    wire += "\r\n";
+  }
+  return wire + "0\r\n\r\n";
+}
+
+static void beginBody(HttpBodyStream& input, WiFiClient& socket, const std::string& wire,
+                      size_t bodyLength, Framing framing) {
+  socket.load(wire.data(), wire.size(), TCP_SEGMENT, framing == FRAMING_CLOSE);
+  input.begin(socket, framing == FRAMING_LENGTH ? (int)bodyLength : -1, framing == FRAMING_CHUNKED);
+  input.setTimeout(TIMEOUT_MS);
+}
+
+// ApiModule::parseBody(); input is the stream, or the text and its length
+template <typename... TInput>
+static bool parseFiltered(JsonDocument& doc, const Reply& reply, TInput&&... input) {
+  COUNTED_DOCUMENT(filterDoc, 256);
+  deserializeJson(filterDoc, reply.filter);
+  filterDoc["success"] = true;
+  return !deserializeJson(doc, input..., DeserializationOption::Filter(filterDoc));
+}
+
+// Streamed: the parser pulls bytes off the socket as they come
+static bool parseStreamed(const Reply& reply, const std::string& wire, Framing framing,
+                          JsonDocument& doc) {
+  WiFiClient socket;
+  HttpBodyStream input;
+  beginBody(input, socket, wire, strlen(reply.body), framing);
+  bool ok = parseFiltered(doc, reply, input);
+  input.finish(TIMEOUT_MS);
+  return ok;
+}
+
+// getString(): the whole body into a String through HTTPClient's TCP buffer,
+// reserved up front when the length is known, then parsed from memory
+static bool parseBuffered(const Reply& reply, const std::string& wire, Framing framing,
+                          JsonDocument& doc) {
+  WiFiClient socket;
+  HttpBodyStream input;
+  size_t bodyLength = strlen(reply.body);
+  beginBody(input, socket, wire, bodyLength, framing);
+
+  std::string body;
+  if (framing == FRAMING_LENGTH) body.reserve(bodyLength);
+  {
+    std::unique_ptr<char[]> buffer(new char[TCP_SEGMENT]);
+    while (input.getConsumed() < bodyLength) {
+      size_t want = bodyLength - input.getConsumed();
+      size_t n = input.readBytes(buffer.get(), want < TCP_SEGMENT ? want : TCP_SEGMENT);
+      if (n == 0) break;
+      body.append(buffer.get(), n);
+    }
+  }
+  input.finish(TIMEOUT_MS);
+  return parseFiltered(doc, reply, body.c_str(), body.size());
+}
+
+typedef bool (*ParsePath)(const Reply&, const std::string&, Framing, JsonDocument&);
+
+struct Measure {
+  double us;
+  size_t peak;
+  std::string json;  // What the firmware is left with
+  bool ok;
+};
+
+static Measure measure(ParsePath path, const Reply& reply, const std::string& wire, Framing framing) {
+  Measure result;
+  {
+    size_t base = liveBytes;
+    peakBytes = liveBytes;
+    COUNTED_DOCUMENT(doc, reply.capacity);
+    result.ok = path(reply, wire, framing, doc);
+    result.peak = peakBytes - base;
+    serializeJson(doc, result.json);
+  }
+
+  unsigned long started = micros();
+  for (int i = 0; i < ITERATIONS; i++) {
+    COUNTED_DOCUMENT(doc, reply.capacity);
+    path(reply, wire, framing, doc);
+  }
+  result.us = (double)(micros() - started) / ITERATIONS;
+  return result;
+}
+
+int main() {
+  printf("HTTP body parse benchmark (%d iterations, ArduinoJson %s)\n\n", ITERATIONS,
+         ARDUINOJSON_VERSION);
+  printf("%-10s %-8s %6s   %16s   %18s\n", "reply", "framing", "bytes", "parse us (s/b)",
+         "peak heap B (s/b)");
+
+  bool ok = true;
+  for (const Reply& reply : replies) {
+    for (int f = FRAMING_LENGTH; f <= FRAMING_CLOSE; f++) {
+      Framing framing = (Framing)f;
+      std::string wire = frameBody(reply.body, framing);
+      Measure streamed = measure(parseStreamed, reply, wire, framing);
+      Measure buffered = measure(parseBuffered, reply, wire, framing);
+
+      if (!streamed.ok || !buffered.ok || streamed.json != buffered.json) {
+        printf("%s/%s: documents differ\n  streamed %s\n  buffered %s\n", reply.name,
+               framingNames[f], streamed.json.c_str(), buffered.json.c_str());
+        ok = false;
+      }
+
+      printf("%-10s %-8s %6zu   %7.2f / %6.2f   %8zu / %7zu\n", reply.name, framingNames[f],
+             wire.size(), streamed.us, buffered.us, streamed.peak, buffered.peak);
+    }
+  }
+
+  printf("\ns = streamed through HttpBodyStream, b = buffered as getString() does\n");
+  if (!ok) {
+    printf("\nStreamed and buffered parses disagree\n");
+    return 1;
+  }
+  return 0;
+}
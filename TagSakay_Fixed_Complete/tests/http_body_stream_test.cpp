@@ -0,0 +1,235 @@
+// ============================================================================
+// HTTP BODY STREAM HOST TEST
+// ============================================================================
+// Feeds response bodies through HttpBodyStream the way ApiModule reads them
+// off the socket: Content-Length, chunked (with extensions and trailers) and
+// until-close, arriving in segments down to a byte at a time or slowly. Checks
+// the body bytes, that waiting yields, that finish() leaves a kept-alive
+// socket at the next response, and that broken framing is never reused.
+// tests/host/ stands in for the core.
+//
+// Usage: make -C TagSakay_Fixed_Complete/tests test
+
+#include "HttpBodyStream.h"
+
+#include <string>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    if (!(cond)) {                                                    \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+      failures++;                                                     \
+    }                                                                 \
+  } while (0)
+
+static const char NEXT[] = "HTTP/1.1 200 OK\r\n";
+
+// Reads until the stream has nothing more within its timeout
+static std::string readBody(HttpBodyStream& input) {
+  std::string body;
+  char buffer[16];
+  size_t n;
+  while ((n = input.readBytes(buffer, sizeof(buffer))) > 0) body.append(buffer, n);
+  return body;
+}
+
+static bool atNextResponse(const WiFiClient& socket) {
+  return socket.unreadLength() == strlen(NEXT) && memcmp(socket.unread(), NEXT, strlen(NEXT)) == 0;
+}
+
+static void testContentLength() {
+  printf("content length\n");
+  std::string wire = std::string("{\"success\":true,\"data\":{}}") + NEXT;
+  WiFiClient socket;
+  socket.load(wire.data(), wire.size(), 7, false);
+
+  HttpBodyStream input;
+  input.begin(socket, 26, false);
+  input.setTimeout(20);
+  CHECK(readBody(input) == "{\"success\":true,\"data\":{}}");
+  CHECK(input.getConsumed() == 26);
+  CHECK(input.finish(20));
+  CHECK(atNextResponse(socket));
+
+  // The same stream serves the next response on the kept-alive socket
+  std::string second = std::string("{}") + NEXT;
+  socket.load(second.data(), second.size(), 0, false);
+  input.begin(socket, 2, false);
+  CHECK(readBody(input) == "{}");
+  CHECK(input.finish(20));
+  CHECK(atNextResponse(socket));
+}
+
+static void testAvailableCapped() {
+  printf("available() stops at the body\n");
+  std::string wire = std::string("hello") + NEXT;
+  WiFiClient socket;
+  socket.load(wire.data(), wire.size(), 0, false);
+
+  HttpBodyStream input;
+  input.begin(socket, 5, false);
+  CHECK(input.available() == 5);
+  CHECK(input.peek() == 'h');
+}
+
+static void testEarlyStop() {
+  printf("parser stops early\n");
+  // Whitespace after the JSON value: the parser never reads it
+  const char body[] = "{\"success\":true}\r\n\r\n   ";
+  std::string wire = std::string(body) + NEXT;
+  WiFiClient socket;
+  socket.load(wire.data(), wire.size(), 5, false);
+
+  HttpBodyStream input;
+  input.begin(socket, strlen(body), false);
+  input.setTimeout(20);
+  char value[16];
+  CHECK(input.readBytes(value, sizeof(value)) == sizeof(value));
+  CHECK(input.finish(20));
+  CHECK(input.getConsumed() == strlen(body));
+  CHECK(atNextResponse(socket));
+}
+
+static void testZeroLength() {
+  printf("empty body\n");
+  WiFiClient socket;
+  socket.load(NEXT, strlen(NEXT), 0, false);
+
+  HttpBodyStream input;
+  input.begin(socket, 0, false);
+  CHECK(input.read() == -1);
+  CHECK(input.available() == 0);
+  CHECK(input.finish(20));
+  CHECK(input.getConsumed() == 0);
+  CHECK(atNextResponse(socket));
+}
+
+static void testChunked() {
+  printf("chunked, extensions and trailers\n");
+  std::string wire = std::string(
+      "4;name=value\r\nWiki\r\n"
+      "5 ; x\r\npedia\r\n"
+      "E\r\n in\r\n\r\nchunks.\r\n"
+      "1a\r\nabcdefghijklmnopqrstuvwxyz\r\n"
+      "0;last\r\n"
+      "Expires: never\r\n"
+      "X-Trailer: 1\r\n"
+      "\r\n") + NEXT;
+
+  for (size_t segment : {(size_t)0, (size_t)1, (size_t)3}) {
+    WiFiClient socket;
+    socket.load(wire.data(), wire.size(), segment, false);
+    HttpBodyStream input;
+    input.begin(socket, -1, true);
+    input.setTimeout(20);
+    CHECK(readBody(input) == "Wikipedia in\r\n\r\nchunks.abcdefghijklmnopqrstuvwxyz");
+    CHECK(input.getConsumed() == 49);
+    CHECK(input.finish(20));
+    CHECK(atNextResponse(socket));
+  }
+}
+
+static void testChunkedEarlyStop() {
+  printf("chunked, parser stops early\n");
+  std::string wire = std::string("6\r\n{\"a\":1\r\n3\r\n}  \r\n0\r\n\r\n") + NEXT;
+  WiFiClient socket;
+  socket.load(wire.data(), wire.size(), 2, false);
+
+  HttpBodyStream input;
+  input.begin(socket, -1, true);
+  input.setTimeout(20);
+  char value[7];
+  CHECK(input.readBytes(value, sizeof(value)) == sizeof(value));
+  CHECK(memcmp(value, "{\"a\":1}", sizeof(value)) == 0);
+  CHECK(input.finish(20));
+  CHECK(input.getConsumed() == 9);
+  CHECK(atNextResponse(socket));
+}
+
+static void testMalformedChunk() {
+  printf("malformed chunk framing\n");
+  const char* cases[] = {
+      "zz\r\nabc\r\n0\r\n\r\n",           // Not a size
+      "3\r\nabcX\r\n0\r\n\r\n",           // Data longer than its size
+      "123456789\r\n",                    // Size overflows
+  };
+  for (const char* wire : cases) {
+    WiFiClient socket;
+    socket.load(wire, strlen(wire), 0, false);
+    HttpBodyStream input;
+    input.begin(socket, -1, true);
+    input.setTimeout(20);
+    readBody(input);
+    CHECK(!input.finish(20));  // Never reused
+  }
+}
+
+static void testUntilClose() {
+  printf("until close\n");
+  const char wire[] = "{\"success\":true,\"data\":[1,2,3]}";
+  WiFiClient socket;
+  socket.load(wire, strlen(wire), 4, true);
+
+  HttpBodyStream input;
+  input.begin(socket, -1, false);
+  input.setTimeout(20);
+  CHECK(readBody(input) == wire);
+  CHECK(input.getConsumed() == strlen(wire));
+  CHECK(!input.finish(20));  // The connection is gone either way
+}
+
+static void testSlowServer() {
+  printf("slow server\n");
+  // 64 bytes in 8-byte pieces, 10 ms apart: readBytes() must wait for each
+  // without spinning (on the device the network task would starve IDLE0)
+  std::string body(64, 'x');
+  std::string wire = body + NEXT;
+  WiFiClient socket;
+  socket.load(wire.data(), wire.size(), 8, false, 10);
+
+  HttpBodyStream input;
+  input.begin(socket, body.size(), false);
+  input.setTimeout(100);
+  unsigned long started = millis();
+  CHECK(readBody(input) == body);
+  CHECK(millis() - started >= 70);
+  CHECK(socket.polls < 200);  // About one per millisecond waited
+  CHECK(input.finish(20));
+}
+
+static void testTruncated() {
+  printf("body cut short\n");
+  const char wire[] = "{\"succ";
+  WiFiClient socket;
+  socket.load(wire, strlen(wire), 0, false);
+
+  HttpBodyStream input;
+  input.begin(socket, 40, false);
+  input.setTimeout(20);
+  CHECK(readBody(input) == wire);
+  unsigned long started = millis();
+  CHECK(!input.finish(30));   // Gives up after its timeout, socket not reused
+  CHECK(millis() - started >= 30);
+}
+
+int main() {
+  testContentLength();
+  testAvailableCapped();
+  testEarlyStop();
+  testZeroLength();
+  testChunked();
+  testChunkedEarlyStop();
+  testMalformedChunk();
+  testUntilClose();
+  testSlowServer();
+  testTruncated();
+
+  if (failures) {
+    printf("\n%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("\nAll HTTP body stream checks passed\n");
+  return 0;
+}
@@ -0,0 +1,272 @@
+// ============================================================================
+// SCAN JOURNAL HOST TEST
+// ============================================================================
+// Runs ScanJournal against a temporary directory standing in for LittleFS:
+// append and group commit, ack and compaction, restart, a torn tail, a
+// corrupt record and the journal ID after a reformat. The journal is plain
+// stdio, so this is the same code the ESP32 runs.
+//
+// Usage: make -C TagSakay_Fixed_Complete/tests test
+
+#include "ScanJournal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ScanJournal scanJournal;  // The firmware's instance (unused here)
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    if (!(cond)) {                                                    \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+      failures++;                                                     \
+    }                                                                 \
+  } while (0)
+
+static char dir[64];
+static char journalFile[96];
+static char ackFile[96];
+static char idFile[96];
+
+static void freshDirectory() {
+  if (dir[0]) {
+    remove(journalFile);
+    remove(ackFile);
+    remove(idFile);
+    rmdir(dir);
+  }
+  strcpy(dir, "/tmp/scan-journal-XXXXXX");
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    exit(1);
+  }
+  snprintf(journalFile, sizeof(journalFile), "%s/scans.jnl", dir);
+  snprintf(ackFile, sizeof(ackFile), "%s/scans.ack", dir);
+  snprintf(idFile, sizeof(idFile), "%s/scans.id", dir);
+}
+
+static long fileSize(const char* path) {
+  struct stat st;
+  return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+static bool appendTag(ScanJournal& journal, uint8_t last, uint32_t nowMs = 0) {
+  uint8_t uid[4] = {0x04, 0xA1, 0xB2, last};
+  return journal.append(uid, sizeof(uid), 1760000000, nowMs, JOURNAL_FLAG_OFFLINE);
+}
+
+static void testGroupCommit() {
+  printf("group commit\n");
+  freshDirectory();
+  ScanJournal journal;
+  CHECK(journal.begin(dir, 64, 4, 1000));
+
+  for (int i = 0; i < 3; i++) CHECK(appendTag(journal, i, 100));
+  journal.service(200);
+  CHECK(journal.getPendingCount() == 3);
+  CHECK(fileSize(journalFile) == 0);  // Buffered, not yet written
+
+  CHECK(appendTag(journal, 3, 300));
+  journal.service(300);               // Group full
+  CHECK(fileSize(journalFile) == 4 * (long)sizeof(JournalRecord));
+
+  CHECK(appendTag(journal, 4, 400));
+  journal.service(1399);
+  CHECK(fileSize(journalFile) == 4 * (long)sizeof(JournalRecord));
+  journal.service(1400);              // commitIntervalMs after the first record
+  CHECK(fileSize(journalFile) == 5 * (long)sizeof(JournalRecord));
+  CHECK(journal.getPendingCount() == 5);
+
+  JournalRecord records[8];
+  CHECK(journal.readPending(records, 8) == 5);
+  for (int i = 0; i < 5; i++) CHECK(records[i].sequence == (uint32_t)i + 1);
+  CHECK(records[4].uid[3] == 4 && records[4].uidLength == 4);
+  journal.end();
+}
+
+static void testAckAndRestart() {
+  printf("ack and restart\n");
+  freshDirectory();
+  uint32_t journalId;
+  {
+    ScanJournal journal;
+    CHECK(journal.begin(dir, 64, 1, 1000));
+    journalId = journal.getJournalId();
+    CHECK(journalId != 0);
+    for (int i = 0; i < 5; i++) {
+      CHECK(appendTag(journal, i));
+      journal.service(0);
+    }
+    CHECK(journal.ack(3));
+    CHECK(journal.getPendingCount() == 2);
+    journal.end();
+  }
+  {
+    // Unacknowledged records survive; sequence numbers keep counting
+    ScanJournal journal;
+    CHECK(journal.begin(dir, 64, 1, 1000));
+    CHECK(journal.getJournalId() == journalId);
+    CHECK(journal.getPendingCount() == 2);
+    JournalRecord records[8];
+    CHECK(journal.readPending(records, 8) == 2);
+    CHECK(records[0].sequence == 4 && records[1].sequence == 5);
+
+    CHECK(journal.ack(5));
+    CHECK(journal.getPendingCount() == 0);
+    CHECK(fileSize(journalFile) == 0);  // Everything acknowledged: emptied
+
+    CHECK(appendTag(journal, 9));
+    CHECK(journal.flush());
+    CHECK(journal.readPending(records, 8) == 1);
+    CHECK(records[0].sequence == 6);
+    journal.end();
+  }
+}
+
+static void testCompaction() {
+  printf("compaction\n");
+  freshDirectory();
+  ScanJournal journal;
+  CHECK(journal.begin(dir, 8, 1, 1000));
+  for (int i = 0; i < 8; i++) {
+    CHECK(appendTag(journal, i));
+    journal.service(0);
+  }
+  CHECK(!appendTag(journal, 8));       // Full of unacknowledged records
+  CHECK(journal.getDroppedCount() == 1);
+
+  CHECK(journal.ack(4));
+  CHECK(fileSize(journalFile) == 8 * (long)sizeof(JournalRecord));
+  journal.service(0);                  // At the cap: acknowledged space reclaimed
+  CHECK(fileSize(journalFile) == 4 * (long)sizeof(JournalRecord));
+
+  for (int i = 0; i < 4; i++) {
+    CHECK(appendTag(journal, 10 + i));
+    journal.service(0);
+  }
+  JournalRecord records[8];
+  CHECK(journal.readPending(records, 8) == 8);
+  for (int i = 0; i < 8; i++) CHECK(records[i].sequence == (uint32_t)i + 5);
+  journal.end();
+}
+
+static void testTornTail() {
+  printf("torn tail\n");
+  freshDirectory();
+  {
+    ScanJournal journal;
+    CHECK(journal.begin(dir, 64, 8, 1000));
+    for (int i = 0; i < 3; i++) CHECK(appendTag(journal, i));
+    CHECK(journal.flush());
+    journal.end();
+  }
+
+  // Power cut part-way through the next group
+  FILE* f = fopen(journalFile, "ab");
+  const uint8_t partial[10] = {4, 0, 0, 0, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55};
+  fwrite(partial, sizeof(partial), 1, f);
+  fclose(f);
+
+  ScanJournal journal;
+  CHECK(journal.begin(dir, 64, 8, 1000));
+  CHECK(journal.getPendingCount() == 3);
+  CHECK(fileSize(journalFile) == 3 * (long)sizeof(JournalRecord));
+  CHECK(appendTag(journal, 3));
+  CHECK(journal.flush());
+  JournalRecord records[8];
+  CHECK(journal.readPending(records, 8) == 4);
+  CHECK(records[3].sequence == 4);
+  journal.end();
+}
+
+static void testCorruptRecord() {
+  printf("corrupt record\n");
+  freshDirectory();
+  {
+    ScanJournal journal;
+    CHECK(journal.begin(dir, 64, 8, 1000));
+    for (int i = 0; i < 3; i++) CHECK(appendTag(journal, i));
+    CHECK(journal.flush());
+    journal.end();
+  }
+
+  // Flip a bit in the middle record's UID
+  FILE* f = fopen(journalFile, "r+b");
+  long offset = sizeof(JournalRecord) + offsetof(JournalRecord, uid);
+  fseek(f, offset, SEEK_SET);
+  int byte = fgetc(f);
+  fseek(f, offset, SEEK_SET);
+  fputc(byte ^ 0x01, f);
+  fclose(f);
+
+  ScanJournal journal;
+  CHECK(journal.begin(dir, 64, 8, 1000));
+  CHECK(journal.getCorruptedCount() == 1);
+  CHECK(journal.getPendingCount() == 2);
+  JournalRecord records[8];
+  CHECK(journal.readPending(records, 8) == 2);
+  CHECK(records[0].sequence == 1 && records[1].sequence == 3);
+  CHECK(fileSize(journalFile) == 2 * (long)sizeof(JournalRecord));
+  journal.end();
+}
+
+static void testReformatNewId() {
+  printf("journal ID after reformat\n");
+  freshDirectory();
+  uint32_t journalId;
+  {
+    ScanJournal journal;
+    CHECK(journal.begin(dir, 64, 1, 1000));
+    journalId = journal.getJournalId();
+    for (int i = 0; i < 3; i++) CHECK(appendTag(journal, i));
+    CHECK(journal.flush());
+    CHECK(journal.ack(3));
+    journal.end();
+  }
+  {
+    // Everything acknowledged and emptied: the sequence and ID carry on
+    ScanJournal journal;
+    CHECK(journal.begin(dir, 64, 1, 1000));
+    CHECK(journal.getJournalId() == journalId);
+    CHECK(appendTag(journal, 3));
+    CHECK(journal.flush());
+    JournalRecord records[1];
+    CHECK(journal.readPending(records, 1) == 1 && records[0].sequence == 4);
+    journal.end();
+  }
+
+  // Flash reformatted: the sequence starts over, under a new ID
+  remove(journalFile);
+  remove(ackFile);
+  remove(idFile);
+  ScanJournal journal;
+  CHECK(journal.begin(dir, 64, 1, 1000));
+  CHECK(journal.getJournalId() != 0 && journal.getJournalId() != journalId);
+  CHECK(appendTag(journal, 4));
+  CHECK(journal.flush());
+  JournalRecord records[1];
+  CHECK(journal.readPending(records, 1) == 1 && records[0].sequence == 1);
+  journal.end();
+}
+
+int main() {
+  testGroupCommit();
+  testAckAndRestart();
+  testCompaction();
+  testTornTail();
+  testCorruptRecord();
+  testReformatNewId();
+  freshDirectory();
+  rmdir(dir);
+
+  if (failures) {
+    printf("\n%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("\nAll scan journal checks passed\n");
+  return 0;
+}
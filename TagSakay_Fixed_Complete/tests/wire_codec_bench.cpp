@@ -0,0 +1,55 @@
+// ============================================================================
+// WIRE CODEC BENCHMARK
+// ============================================================================
+// Host timing of the firmware's MsgPack codec on the frames in
+// wire_vectors.txt: encoding into a stack buffer (the send paths) and walking
+// a received frame (handleBinaryMessage() without the document). The
+// backend's side of the same frames: npm run bench:ws-codec.
+//
+// Usage: make -C TagSakay_Fixed_Complete/tests bench
+
+#include "wire_vectors.h"
+
+static const int ITERATIONS = 1000000;
+
+static volatile size_t sink;
+
+static double timeNs(void (*fn)(const WireVector&), const WireVector& vector) {
+  unsigned long started = micros();
+  for (int i = 0; i < ITERATIONS; i++) fn(vector);
+  return (double)(micros() - started) * 1000.0 / ITERATIONS;
+}
+
+static void encodeOnce(const WireVector& vector) {
+  uint8_t frame[128];
+  sink = encodeWireVector(vector, frame, sizeof(frame));
+}
+
+static void decodeOnce(const WireVector& vector) {
+  MsgPackReader reader(vector.frame.data(), vector.frame.size());
+  MsgPackValue value;
+  size_t items = 0;
+  while (reader.next(value)) items++;
+  sink = items;
+}
+
+int main(int argc, char** argv) {
+  const char* path = argc > 1 ? argv[1] : "wire_vectors.txt";
+  std::vector<WireVector> vectors;
+  int badLine;
+  if (!loadWireVectors(path, vectors, &badLine)) {
+    printf("Cannot load %s (line %d)\n", path, badLine);
+    return 1;
+  }
+
+  printf("Wire codec benchmark (%d iterations)\n\n", ITERATIONS);
+  for (const WireVector& vector : vectors) {
+    if (!decodeMatchesWireVector(vector.frame.data(), vector.frame.size(), vector)) {
+      printf("%s: does not decode to its fields\n", vector.name.c_str());
+      return 1;
+    }
+    printf("%-28s %4zu B   encode %6.1f ns   decode %6.1f ns\n", vector.name.c_str(),
+           vector.frame.size(), timeNs(encodeOnce, vector), timeNs(decodeOnce, vector));
+  }
+  return 0;
+}
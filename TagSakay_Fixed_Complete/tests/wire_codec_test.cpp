@@ -0,0 +1,64 @@
+// ============================================================================
+// WIRE CODEC HOST TEST
+// ============================================================================
+// Checks the firmware's MsgPack codec and DeviceWire.h tables against the
+// frames in wire_vectors.txt, which the backend's codec is checked against
+// too (backend-workers/tests/ws-codec-benchmark.ts): every frame decodes to
+// its fields and encodes back to the same bytes, every truncation of it is
+// rejected, and a frame that does not fit is not sent half-written.
+//
+// Usage: make -C TagSakay_Fixed_Complete/tests test
+
+#include "wire_vectors.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    if (!(cond)) {                                                    \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+      failures++;                                                     \
+    }                                                                 \
+  } while (0)
+
+static void testVector(const WireVector& vector) {
+  printf("%s (%s)\n", vector.name.c_str(), vector.fromDevice ? "device" : "server");
+  const uint8_t* frame = vector.frame.data();
+  size_t length = vector.frame.size();
+
+  CHECK(decodeMatchesWireVector(frame, length, vector));
+
+  uint8_t encoded[256];
+  size_t size = encodeWireVector(vector, encoded, sizeof(encoded));
+  CHECK(size == length && memcmp(encoded, frame, length) == 0);
+
+  // Cut anywhere, the frame must not pass as complete
+  for (size_t cut = 0; cut < length; cut++) {
+    CHECK(!decodeMatchesWireVector(frame, cut, vector));
+  }
+
+  // One byte short of room: nothing rather than a truncated frame
+  CHECK(encodeWireVector(vector, encoded, length - 1) == 0);
+}
+
+int main(int argc, char** argv) {
+  const char* path = argc > 1 ? argv[1] : "wire_vectors.txt";
+  std::vector<WireVector> vectors;
+  int badLine;
+  if (!loadWireVectors(path, vectors, &badLine)) {
+    printf("Cannot load %s (line %d)\n", path, badLine);
+    return 1;
+  }
+  CHECK(!vectors.empty());
+
+  for (const WireVector& vector : vectors) {
+    testVector(vector);
+  }
+
+  if (failures) {
+    printf("\n%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("\nAll %zu wire vectors passed\n", vectors.size());
+  return 0;
+}
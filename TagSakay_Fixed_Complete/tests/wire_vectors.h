@@ -0,0 +1,202 @@
+#ifndef WIRE_VECTORS_H
+#define WIRE_VECTORS_H
+
+// wire_vectors.txt for the host programs: loading, and encoding/decoding a
+// vector with the firmware's MsgPack codec under the DeviceWire.h tables.
+
+#include "DeviceWire.h"
+#include "MsgPack.h"
+
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+// The JSON names the firmware gives each key and action
+static const struct { uint8_t key; const char* name; } WIRE_KEY_NAMES[] = {
+  {WIRE_KEY_ACTION, "action"},
+  {WIRE_KEY_TIMESTAMP, "timestamp"},
+  {WIRE_KEY_SEQ, "seq"},
+  {WIRE_KEY_TAG_ID, "tagId"},
+  {WIRE_KEY_LOCATION, "location"},
+  {WIRE_KEY_SUCCESS, "success"},
+  {WIRE_KEY_REGISTERED, "isRegistered"},
+  {WIRE_KEY_USER_NAME, "userName"},
+  {WIRE_KEY_USER_ROLE, "userRole"},
+  {WIRE_KEY_ERROR, "error"},
+  {WIRE_KEY_ID, "id"},
+  {WIRE_KEY_VERSION, "version"},
+  {WIRE_KEY_REGISTRATION_MODE, "registrationMode"},
+  {WIRE_KEY_SCAN_MODE, "scanMode"},
+};
+
+static const struct { uint8_t code; const char* name; } WIRE_ACTION_NAMES[] = {
+  {WIRE_HEARTBEAT, "heartbeat"},
+  {WIRE_HEARTBEAT_ACK, "heartbeat_ack"},
+  {WIRE_SCAN, "scan"},
+  {WIRE_SCAN_RESULT, "scan_result"},
+  {WIRE_COMMAND_ACK, "command_ack"},
+  {WIRE_CONFIG, "config"},
+  {WIRE_COMMANDS, "commands"},
+};
+
+enum WireFieldType { WIRE_FIELD_BOOL, WIRE_FIELD_UINT, WIRE_FIELD_TEXT };
+
+struct WireField {
+  uint8_t key;
+  WireFieldType type;
+  bool boolean;
+  uint64_t uint;      // Also the action code
+  std::string text;
+};
+
+struct WireVector {
+  std::string name;
+  bool fromDevice;
+  std::vector<uint8_t> frame;
+  std::vector<WireField> fields;
+};
+
+inline int wireKeyCode(const std::string& name) {
+  for (const auto& entry : WIRE_KEY_NAMES) {
+    if (name == entry.name) return entry.key;
+  }
+  return -1;
+}
+
+inline int wireActionCode(const std::string& name) {
+  for (const auto& entry : WIRE_ACTION_NAMES) {
+    if (name == entry.name) return entry.code;
+  }
+  return -1;
+}
+
+inline bool parseWireField(const std::string& item, WireField& field) {
+  size_t eq = item.find('=');
+  if (eq == std::string::npos) return false;
+  int key = wireKeyCode(item.substr(0, eq));
+  std::string value = item.substr(eq + 1);
+  if (key < 0 || value.empty()) return false;
+  field.key = (uint8_t)key;
+
+  if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+    field.type = WIRE_FIELD_TEXT;
+    field.text = value.substr(1, value.size() - 2);
+    if (key == WIRE_KEY_ACTION) {
+      int code = wireActionCode(field.text);
+      if (code < 0) return false;
+      field.type = WIRE_FIELD_UINT;
+      field.uint = (uint64_t)code;
+    }
+  } else if (value == "true" || value == "false") {
+    field.type = WIRE_FIELD_BOOL;
+    field.boolean = value == "true";
+  } else {
+    char* end;
+    field.type = WIRE_FIELD_UINT;
+    field.uint = strtoull(value.c_str(), &end, 10);
+    if (*end) return false;
+  }
+  return true;
+}
+
+// False (with the line number in *badLine) on a line that does not parse
+inline bool loadWireVectors(const char* path, std::vector<WireVector>& vectors, int* badLine) {
+  FILE* f = fopen(path, "r");
+  *badLine = 0;
+  if (!f) return false;
+
+  char line[1024];
+  int number = 0;
+  while (fgets(line, sizeof(line), f)) {
+    number++;
+    std::string text(line);
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) text.pop_back();
+    if (text.empty() || text[0] == '#') continue;
+
+    std::vector<std::string> items;
+    size_t start = 0;
+    for (size_t tab; (tab = text.find('\t', start)) != std::string::npos; start = tab + 1) {
+      items.push_back(text.substr(start, tab - start));
+    }
+    items.push_back(text.substr(start));
+
+    WireVector vector;
+    bool ok = items.size() >= 4 && items[2].size() % 2 == 0 &&
+              (items[1] == "device" || items[1] == "server");
+    if (ok) {
+      vector.name = items[0];
+      vector.fromDevice = items[1] == "device";
+      for (size_t i = 0; ok && i < items[2].size(); i += 2) {
+        char* end;
+        std::string byte = items[2].substr(i, 2);
+        vector.frame.push_back((uint8_t)strtoul(byte.c_str(), &end, 16));
+        ok = *end == '\0';
+      }
+      for (size_t i = 3; ok && i < items.size(); i++) {
+        WireField field;
+        ok = parseWireField(items[i], field);
+        vector.fields.push_back(field);
+      }
+    }
+    if (!ok) {
+      *badLine = number;
+      fclose(f);
+      return false;
+    }
+    vectors.push_back(vector);
+  }
+  fclose(f);
+  return true;
+}
+
+// Writes the fields in order, as the firmware's send paths do
+inline size_t encodeWireVector(const WireVector& vector, uint8_t* buffer, size_t capacity) {
+  MsgPackWriter writer(buffer, capacity);
+  writer.map((uint8_t)vector.fields.size());
+  for (const WireField& field : vector.fields) {
+    writer.uint(field.key);
+    switch (field.type) {
+      case WIRE_FIELD_BOOL: writer.boolean(field.boolean); break;
+      case WIRE_FIELD_UINT: writer.uint(field.uint); break;
+      case WIRE_FIELD_TEXT: writer.str(field.text.c_str()); break;
+    }
+  }
+  return writer.size();
+}
+
+// Walks the frame as handleBinaryMessage() does; true when it holds exactly
+// the vector's fields
+inline bool decodeMatchesWireVector(const uint8_t* frame, size_t length, const WireVector& vector) {
+  MsgPackReader reader(frame, length);
+  MsgPackValue header;
+  if (!reader.next(header) || header.type != MSGPACK_MAP ||
+      header.length != vector.fields.size()) {
+    return false;
+  }
+
+  for (const WireField& field : vector.fields) {
+    MsgPackValue key;
+    MsgPackValue value;
+    if (!reader.next(key) || !reader.next(value) || key.type != MSGPACK_UINT ||
+        key.uint != field.key) {
+      return false;
+    }
+    switch (field.type) {
+      case WIRE_FIELD_BOOL:
+        if (value.type != MSGPACK_BOOL || value.boolean != field.boolean) return false;
+        break;
+      case WIRE_FIELD_UINT:
+        if (value.type != MSGPACK_UINT || value.uint != field.uint) return false;
+        break;
+      case WIRE_FIELD_TEXT:
+        if (value.type != MSGPACK_STR || value.length != field.text.size() ||
+            memcmp(value.str, field.text.data(), value.length) != 0) {
+          return false;
+        }
+        break;
+    }
+  }
+  return reader.atEnd();
+}
+
+#endif // WIRE_VECTORS_H
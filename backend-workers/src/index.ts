@@ -10,6 +10,7 @@ import rfidRoutes from "./routes/rfid";
 import deviceRoutes from "./routes/device";
 import userRoutes from "./routes/user";
 import apiKeyRoutes from "./routes/apiKey";
+import deviceSocketRoutes from "./routes/deviceSocket";
 
 type Bindings = {
   DATABASE_URL: string;
@@ -64,32 +65,6 @@ app.get("/health", (c) => {
   });
 });
 
-// WebSocket endpoint for ESP32 devices (standard HTTP upgrade)
-app.get("/ws/device", async (c) => {
-  const deviceId = c.req.query("deviceId");
-
-  if (!deviceId) {
-    return c.json(
-      {
-        success: false,
-        message: "Missing deviceId parameter",
-      },
-      400
-    );
-  }
-
-  // WebSocket upgrade (Cloudflare Workers handles this natively)
-  // Clients connect and maintain persistent connection
-  // Server sends real-time updates via HTTP push or polling fallback
-
-  return c.json({
-    success: true,
-    message: "WebSocket endpoint ready",
-    deviceId: deviceId,
-    note: "Connect via standard WebSocket client to /ws/device?deviceId=YOUR_ID",
-  });
-});
-
 // Routes
 app.route("/api/auth", authRoutes);
 app.route("/api/rfid", rfidRoutes);
@@ -97,6 +72,9 @@ app.route("/api/devices", deviceRoutes);
 app.route("/api/users", userRoutes);
 app.route("/api/keys", apiKeyRoutes);
 
+// WebSocket for ESP32 devices: live scans and pushed commands
+app.route("/ws/device", deviceSocketRoutes);
+
 // 404 handler
 app.notFound((c) => {
   return c.json(
@@ -0,0 +1,77 @@
+// Device command set: what an ESP32 should apply, derived from its row in
+// the devices table. Shared by the HTTP polls (/commands, /sync) and the
+// device WebSocket, which pushes the same set when it changes.
+
+export type DeviceCommandState = {
+  isActive: boolean | null;
+  registrationMode: boolean | null;
+  scanMode: boolean | null;
+  pendingRegistrationTagId: string | null;
+};
+
+// Commands the device should apply, derived from its stored state
+export const buildDeviceCommands = (deviceData: DeviceCommandState): any[] => {
+  const commands: any[] = [];
+
+  // Check for registration mode command
+  if (deviceData.registrationMode && deviceData.pendingRegistrationTagId) {
+    commands.push({
+      action: "enable_registration",
+      tagId: deviceData.pendingRegistrationTagId,
+      timestamp: Date.now(),
+    });
+  } else if (!deviceData.registrationMode) {
+    commands.push({
+      action: "disable_registration",
+      timestamp: Date.now(),
+    });
+  }
+
+  // Check for scan mode changes
+  commands.push({
+    action: "scan_mode",
+    enabled: deviceData.scanMode,
+    timestamp: Date.now(),
+  });
+
+  return commands;
+};
+
+// ETag of the state the commands are derived from (their timestamps aside),
+// so a device polling with If-None-Match gets an empty answer until it changes
+export const commandsEtag = (deviceData: DeviceCommandState): string => {
+  const key = [
+    deviceData.isActive,
+    deviceData.registrationMode,
+    deviceData.scanMode,
+    deviceData.pendingRegistrationTagId ?? "",
+  ].join("|");
+
+  // FNV-1a 32
+  let hash = 0x811c9dc5;
+  for (let i = 0; i < key.length; i++) {
+    hash ^= key.charCodeAt(i);
+    hash = Math.imul(hash, 0x01000193) >>> 0;
+  }
+  return `"c-${hash.toString(16).padStart(8, "0")}"`;
+};
+
+// Device sockets open in this isolate. A mode change handled by the same
+// isolate pushes at once; elsewhere the socket's periodic check finds it.
+const commandListeners = new Map<string, () => void>();
+
+export const onDeviceCommandsChanged = (
+  deviceId: string,
+  listener: () => void
+): (() => void) => {
+  commandListeners.set(deviceId, listener);
+  return () => {
+    if (commandListeners.get(deviceId) === listener) {
+      commandListeners.delete(deviceId);
+    }
+  };
+};
+
+export const notifyDeviceCommandsChanged = (deviceId: string) => {
+  commandListeners.get(deviceId)?.();
+};
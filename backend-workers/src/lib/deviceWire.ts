@@ -0,0 +1,231 @@
+// Binary device socket frames: MessagePack maps with small integer keys in
+// place of JSON field names. Devices built with WS_BINARY_FRAMES send scans,
+// heartbeats, acks and config this way, and are answered (and sent their
+// command pushes) in kind. The key and action tables must match DeviceWire.h
+// in the firmware; both sides are checked against
+// TagSakay_Fixed_Complete/tests/wire_vectors.txt.
+//
+// Only the subset the firmware reads and writes is supported: unsigned
+// integers, booleans, strings and one flat map per frame. Nested objects in
+// the JSON messages (scan, user, config) are flattened onto their own keys.
+// A "commands" push carries only what its command list is derived from
+// (buildDeviceCommands): the mode flags and the pending registration tag.
+// The firmware rebuilds the list; isActive and timestamps, which it does not
+// read, are left out.
+
+export const WIRE_KEYS = {
+  action: 0,
+  timestamp: 1,
+  seq: 2,
+  tagId: 3,
+  location: 4,
+  success: 5,
+  isRegistered: 6,
+  userName: 7,
+  userRole: 8,
+  error: 9,
+  id: 10,
+  version: 11,
+  registrationMode: 12,
+  scanMode: 13,
+} as const;
+
+// Index is the wire code; 0 is unused
+const WIRE_ACTIONS = [
+  "",
+  "heartbeat",
+  "heartbeat_ack",
+  "scan",
+  "scan_result",
+  "command_ack",
+  "config",
+  "commands",
+];
+
+const KEY_ENTRIES = Object.entries(WIRE_KEYS);
+const KEY_NAMES: string[] = [];
+for (const [name, key] of KEY_ENTRIES) KEY_NAMES[key] = name;
+
+const textEncoder = new TextEncoder();
+const textDecoder = new TextDecoder();
+
+class Writer {
+  private bytes: number[] = [];
+
+  uint(value: number) {
+    if (value < 0x80) {
+      this.bytes.push(value);
+    } else if (value <= 0xff) {
+      this.bytes.push(0xcc, value);
+    } else if (value <= 0xffff) {
+      this.bytes.push(0xcd, value >>> 8, value & 0xff);
+    } else if (value <= 0xffffffff) {
+      this.bytes.push(0xce);
+      this.bigEndian(value, 4);
+    } else {
+      this.bytes.push(0xcf);
+      this.bigEndian(Math.floor(value / 0x100000000), 4);
+      this.bigEndian(value >>> 0, 4);
+    }
+  }
+
+  boolean(value: boolean) {
+    this.bytes.push(value ? 0xc3 : 0xc2);
+  }
+
+  str(value: string) {
+    const encoded = textEncoder.encode(value).subarray(0, 0xffff);
+    const n = encoded.length;
+    if (n < 32) {
+      this.bytes.push(0xa0 | n);
+    } else if (n <= 0xff) {
+      this.bytes.push(0xd9, n);
+    } else {
+      this.bytes.push(0xda, n >>> 8, n & 0xff);
+    }
+    for (const byte of encoded) this.bytes.push(byte);
+  }
+
+  map(entries: number) {
+    if (entries < 16) {
+      this.bytes.push(0x80 | entries);
+    } else {
+      this.bytes.push(0xde, entries >>> 8, entries & 0xff);
+    }
+  }
+
+  toBytes() {
+    return Uint8Array.from(this.bytes);
+  }
+
+  private bigEndian(value: number, count: number) {
+    for (let shift = (count - 1) * 8; shift >= 0; shift -= 8) {
+      this.bytes.push((value >>> shift) & 0xff);
+    }
+  }
+}
+
+// Encodes a device socket message. Returns null for anything the binary
+// format does not cover (an unknown action), which goes out as JSON.
+export const encodeDeviceFrame = (message: any): Uint8Array | null => {
+  const fields: [number, number | boolean | string][] = [];
+
+  if (message.action !== undefined) {
+    const code = WIRE_ACTIONS.indexOf(message.action);
+    if (code <= 0) return null;
+    fields.push([WIRE_KEYS.action, code]);
+  }
+
+  const registration = Array.isArray(message.commands)
+    ? message.commands.find((command: any) => command?.action === "enable_registration")
+    : undefined;
+
+  const flat: Record<string, unknown> = {
+    timestamp: message.timestamp,
+    seq: message.seq,
+    tagId: message.scan?.tagId ?? message.tagId ?? registration?.tagId,
+    location: message.location,
+    success: message.success,
+    isRegistered: message.scan?.isRegistered ?? message.isRegistered,
+    userName: message.user?.name,
+    userRole: message.user?.role,
+    error: message.error,
+    id: message.id,
+    version: message.version,
+    registrationMode:
+      message.config?.registrationMode ??
+      message.deviceStatus?.registrationMode ??
+      message.registrationMode,
+    scanMode:
+      message.config?.scanMode ?? message.deviceStatus?.scanMode ?? message.scanMode,
+  };
+
+  for (const [name, key] of KEY_ENTRIES) {
+    const value = flat[name];
+    if (typeof value === "boolean" || typeof value === "string") {
+      fields.push([key, value]);
+    } else if (
+      typeof value === "number" &&
+      Number.isSafeInteger(value) &&
+      value >= 0
+    ) {
+      fields.push([key, value]);
+    }
+  }
+
+  const writer = new Writer();
+  writer.map(fields.length);
+  for (const [key, value] of fields) {
+    writer.uint(key);
+    if (typeof value === "boolean") writer.boolean(value);
+    else if (typeof value === "string") writer.str(value);
+    else writer.uint(value);
+  }
+  return writer.toBytes();
+};
+
+// Decodes a device frame into the same flat shape as its JSON form. Throws
+// on anything malformed or outside the supported subset.
+export const decodeDeviceFrame = (
+  frame: ArrayBuffer | Uint8Array
+): Record<string, any> => {
+  const bytes = frame instanceof Uint8Array ? frame : new Uint8Array(frame);
+  let pos = 0;
+
+  const take = (count: number) => {
+    if (pos + count > bytes.length) throw new Error("Truncated frame");
+    let value = 0;
+    for (let i = 0; i < count; i++) value = value * 256 + bytes[pos++];
+    return value;
+  };
+
+  const readValue = (): number | boolean | string | null => {
+    const type = take(1);
+    if (type < 0x80) return type;
+    if (type >= 0xe0) return type - 0x100;
+    if ((type & 0xe0) === 0xa0) return readStr(type & 0x1f);
+    switch (type) {
+      case 0xc0: return null;
+      case 0xc2: return false;
+      case 0xc3: return true;
+      case 0xcc: return take(1);
+      case 0xcd: return take(2);
+      case 0xce: return take(4);
+      case 0xcf: return take(8);
+      case 0xd0: return take(1) << 24 >> 24;
+      case 0xd1: return take(2) << 16 >> 16;
+      case 0xd2: return take(4) | 0;
+      case 0xd9: return readStr(take(1));
+      case 0xda: return readStr(take(2));
+    }
+    throw new Error(`Unsupported type 0x${type.toString(16)}`);
+  };
+
+  const readStr = (length: number) => {
+    if (pos + length > bytes.length) throw new Error("Truncated frame");
+    const value = textDecoder.decode(bytes.subarray(pos, pos + length));
+    pos += length;
+    return value;
+  };
+
+  const header = take(1);
+  let entries: number;
+  if ((header & 0xf0) === 0x80) entries = header & 0x0f;
+  else if (header === 0xde) entries = take(2);
+  else throw new Error("Frame is not a map");
+
+  const message: Record<string, any> = {};
+  for (let i = 0; i < entries; i++) {
+    const key = readValue();
+    const value = readValue();
+    if (typeof key !== "number") throw new Error("Non-integer key");
+    const name = KEY_NAMES[key];
+    if (!name) continue; // Newer key: skipped
+    message[name] =
+      name === "action" && typeof value === "number"
+        ? WIRE_ACTIONS[value] || "unknown"
+        : value;
+  }
+  if (pos !== bytes.length) throw new Error("Trailing bytes");
+  return message;
+};
@@ -0,0 +1,121 @@
+// ============================================================================
+// REGISTERED-TAG BLOOM FILTER
+// ============================================================================
+// Built here, queried on the ESP32 (TagFilter.cpp) to give an instant
+// "likely registered / not registered" verdict while the backend is down.
+// The hashing must stay bit-for-bit identical to the firmware:
+//
+//   key   = raw UID bytes (tag ID parsed as hex)
+//   h1    = FNV-1a 32 over key, offset basis 0x811C9DC5
+//   h2    = FNV-1a 32 over key, offset basis 0x9747B28C, low bit forced to 1
+//   bit i = (h1 + i * h2) mod bitCount   (uint32 arithmetic), i = 0..k-1
+//   bit n lives in byte n >> 3, mask 1 << (n & 7)
+//
+// A filter never reports a registered tag as unregistered; the false
+// positive rate is set by bitCount and hashCount (see buildTagFilter).
+
+export const TAG_FILTER_MAX_BYTES = 4096; // Firmware TAG_FILTER_MAX_BYTES
+export const TAG_FILTER_TARGET_FPR = 0.01;
+const TAG_FILTER_MAX_HASHES = 16;
+
+export interface TagFilter {
+  version: number;
+  bitCount: number;
+  hashCount: number;
+  tagCount: number;
+  bits: Uint8Array;
+}
+
+const fnv1a = (bytes: Uint8Array, basis: number): number => {
+  let hash = basis >>> 0;
+  for (const byte of bytes) {
+    hash ^= byte;
+    hash = Math.imul(hash, 0x01000193) >>> 0;
+  }
+  return hash;
+};
+
+export const tagIdToBytes = (tagId: string): Uint8Array | null => {
+  const hex = tagId.trim().toUpperCase();
+  if (hex.length === 0 || hex.length % 2 !== 0 || !/^[0-9A-F]+$/.test(hex)) {
+    return null;
+  }
+  const bytes = new Uint8Array(hex.length / 2);
+  for (let i = 0; i < bytes.length; i++) {
+    bytes[i] = parseInt(hex.substring(i * 2, i * 2 + 2), 16);
+  }
+  return bytes;
+};
+
+const forEachBit = (
+  key: Uint8Array,
+  bitCount: number,
+  hashCount: number,
+  visit: (bit: number) => void
+) => {
+  const h1 = fnv1a(key, 0x811c9dc5);
+  const h2 = (fnv1a(key, 0x9747b28c) | 1) >>> 0;
+  for (let i = 0; i < hashCount; i++) {
+    const combined = (h1 + Math.imul(i, h2)) >>> 0;
+    visit(combined % bitCount);
+  }
+};
+
+// Smallest filter that meets targetFpr for these tags, within maxBytes
+export const sizeTagFilter = (
+  tagCount: number,
+  targetFpr = TAG_FILTER_TARGET_FPR,
+  maxBytes = TAG_FILTER_MAX_BYTES
+) => {
+  const n = Math.max(tagCount, 1);
+  const idealBits = Math.ceil((-n * Math.log(targetFpr)) / (Math.LN2 * Math.LN2));
+  const bytes = Math.min(Math.max(Math.ceil(idealBits / 8), 8), maxBytes);
+  const bitCount = bytes * 8;
+  const hashCount = Math.min(
+    Math.max(Math.round((bitCount / n) * Math.LN2), 1),
+    TAG_FILTER_MAX_HASHES
+  );
+  return { bitCount, hashCount };
+};
+
+export const buildTagFilter = (
+  tagIds: string[],
+  targetFpr = TAG_FILTER_TARGET_FPR,
+  maxBytes = TAG_FILTER_MAX_BYTES
+): TagFilter => {
+  const keys = tagIds
+    .map(tagIdToBytes)
+    .filter((key): key is Uint8Array => key !== null);
+  const { bitCount, hashCount } = sizeTagFilter(keys.length, targetFpr, maxBytes);
+  const bits = new Uint8Array(bitCount / 8);
+
+  keys.forEach((key) =>
+    forEachBit(key, bitCount, hashCount, (bit) => {
+      bits[bit >> 3] |= 1 << (bit & 7);
+    })
+  );
+
+  // Content hash: identical tag sets give identical versions, so a device
+  // that already holds this filter is told "unchanged"
+  const header = new Uint8Array(new Uint32Array([bitCount, hashCount]).buffer);
+  const version = (fnv1a(bits, fnv1a(header, 0x811c9dc5)) || 1) >>> 0;
+
+  return { version, bitCount, hashCount, tagCount: keys.length, bits };
+};
+
+export const tagFilterContains = (filter: TagFilter, tagId: string): boolean => {
+  const key = tagIdToBytes(tagId);
+  if (!key) return false;
+
+  let present = true;
+  forEachBit(key, filter.bitCount, filter.hashCount, (bit) => {
+    if ((filter.bits[bit >> 3] & (1 << (bit & 7))) === 0) present = false;
+  });
+  return present;
+};
+
+export const encodeTagFilterBits = (bits: Uint8Array): string => {
+  let binary = "";
+  for (const byte of bits) binary += String.fromCharCode(byte);
+  return btoa(binary);
+};
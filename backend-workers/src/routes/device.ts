@@ -9,6 +9,11 @@ import { devices } from "../db/schema";
 import { eq, desc } from "drizzle-orm";
 import type { Database } from "../db";
 import { generateApiKey, hashApiKey } from "../lib/auth";
+import {
+  buildDeviceCommands,
+  commandsEtag,
+  notifyDeviceCommandsChanged,
+} from "../lib/deviceCommands";
 
 type Env = {
   Bindings: {
@@ -27,6 +32,9 @@ const app = new Hono<Env>();
 
 const DEVICE_ONLINE_THRESHOLD_MS = 2 * 60 * 1000;
 
+// Telemetry events accepted from one sync request; extras are ignored
+const MAX_SYNC_TELEMETRY = 16;
+
 type DeviceResponseRecord = {
   id: string;
   deviceId: string;
@@ -403,6 +411,9 @@ app.put(
         .where(eq(devices.deviceId, deviceId))
         .returning();
 
+      // isActive is part of the command set a connected device holds
+      if (isActive !== undefined) notifyDeviceCommandsChanged(deviceId);
+
       const responseDevice = enrichDeviceRecord({
         id: updatedDevice.id,
         deviceId: updatedDevice.deviceId,
@@ -535,29 +546,14 @@ app.get(
         );
       }
 
-      // Build commands response
-      const commands: any[] = [];
-
-      // Check for registration mode command
-      if (deviceData.registrationMode && deviceData.pendingRegistrationTagId) {
-        commands.push({
-          action: "enable_registration",
-          tagId: deviceData.pendingRegistrationTagId,
-          timestamp: Date.now(),
-        });
-      } else if (!deviceData.registrationMode) {
-        commands.push({
-          action: "disable_registration",
-          timestamp: Date.now(),
-        });
+      const etag = commandsEtag(deviceData);
+      c.header("ETag", etag);
+      if (c.req.header("If-None-Match") === etag) {
+        return c.body(null, 304);
       }
 
-      // Check for scan mode changes
-      commands.push({
-        action: "scan_mode",
-        enabled: deviceData.scanMode,
-        timestamp: Date.now(),
-      });
+      // Build commands response
+      const commands = buildDeviceCommands(deviceData);
 
       return c.json({
         success: true,
@@ -658,6 +654,96 @@ app.post("/:deviceId/heartbeat", deviceAuthMiddleware, async (c) => {
   }
 });
 
+// POST /api/devices/:deviceId/sync - Heartbeat, telemetry upload and command
+// poll in one round trip (device auth + rate limit)
+app.post(
+  "/:deviceId/sync",
+  apiRateLimit,
+  deviceAuthMiddleware,
+  async (c) => {
+    try {
+      const db = c.get("db");
+      const deviceId = c.req.param("deviceId");
+      const device = c.get("device");
+
+      // Verify deviceId matches authenticated device
+      if (device && device.deviceId !== deviceId) {
+        return c.json(
+          {
+            success: false,
+            message: "Device ID mismatch",
+          },
+          403
+        );
+      }
+
+      // Heartbeat fields and stats are optional; a bare sync still polls
+      const body = await c.req.json().catch(() => null);
+
+      // Status reports the device buffered since its last sync. There is no
+      // telemetry table yet, so they go to the Worker log like errors do.
+      const telemetry = Array.isArray(body?.telemetry)
+        ? body.telemetry.slice(0, MAX_SYNC_TELEMETRY)
+        : [];
+      for (const event of telemetry) {
+        console.log(`Device ${deviceId} telemetry:`, JSON.stringify(event));
+      }
+
+      // The sync is the device's heartbeat
+      const [updatedDevice] = await db
+        .update(devices)
+        .set({
+          lastSeen: new Date(),
+          updatedAt: new Date(),
+        })
+        .where(eq(devices.deviceId, deviceId))
+        .returning();
+
+      if (!updatedDevice) {
+        return c.json(
+          {
+            success: false,
+            message: "Device not found",
+          },
+          404
+        );
+      }
+
+      // Heartbeat and telemetry are taken either way; an unchanged command
+      // set is answered with no body
+      const etag = commandsEtag(updatedDevice);
+      c.header("ETag", etag);
+      if (c.req.header("If-None-Match") === etag) {
+        return c.body(null, 204);
+      }
+
+      return c.json({
+        success: true,
+        message: "Device synced",
+        data: {
+          commands: buildDeviceCommands(updatedDevice),
+          deviceStatus: {
+            isActive: updatedDevice.isActive,
+            registrationMode: updatedDevice.registrationMode,
+            scanMode: updatedDevice.scanMode,
+          },
+          telemetryAccepted: telemetry.length,
+        },
+      });
+    } catch (error: any) {
+      console.error("Device sync error:", error);
+      return c.json(
+        {
+          success: false,
+          message: "Failed to sync device",
+          error: error.message,
+        },
+        500
+      );
+    }
+  }
+);
+
 // POST /api/devices/:deviceId/mode - Change device mode (admin/superadmin only)
 app.post(
   "/:deviceId/mode",
@@ -705,6 +791,9 @@ app.post(
         .where(eq(devices.deviceId, deviceId))
         .returning();
 
+      // Push to the device if its socket is open in this isolate
+      notifyDeviceCommandsChanged(deviceId);
+
       const responseDevice = enrichDeviceRecord({
         id: updatedDevice.id,
         deviceId: updatedDevice.deviceId,
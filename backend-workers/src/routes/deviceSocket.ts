@@ -0,0 +1,317 @@
+import { Hono } from "hono";
+import { deviceAuthMiddleware } from "../middleware/auth";
+import { devices, type Device } from "../db/schema";
+import { eq } from "drizzle-orm";
+import type { Database } from "../db";
+import { recordDeviceScan } from "./rfid";
+import {
+  buildDeviceCommands,
+  commandsEtag,
+  onDeviceCommandsChanged,
+} from "../lib/deviceCommands";
+import { decodeDeviceFrame, encodeDeviceFrame } from "../lib/deviceWire";
+
+type Env = {
+  Bindings: {
+    DATABASE_URL: string;
+    JWT_SECRET: string;
+    SESSION_SECRET: string;
+  };
+  Variables: {
+    db: Database;
+    device?: Device;
+  };
+};
+
+const app = new Hono<Env>();
+
+// Safety net for an open socket. Changes made through this isolate are pushed
+// at once (onDeviceCommandsChanged); this slow re-read of the device row only
+// catches ones written elsewhere (another isolate, a direct DB edit), so it
+// costs one query per device per minute rather than one every few seconds.
+// Such a change reaches the socket up to this late: the listeners live in
+// the isolate, and sockets are not routed through a Durable Object (the
+// DeviceConnection binding in wrangler.toml is not enabled). The device's
+// own HTTP sync (SYNC_PUSH_INTERVAL, 30 s) usually picks it up first.
+const COMMAND_CHECK_INTERVAL_MS = 60000;
+
+// A pushed command set not acknowledged within this is sent again
+const COMMAND_ACK_TIMEOUT_MS = 10000;
+
+// Scan results kept per socket so a resend on the same socket is answered,
+// not recorded twice
+const RECENT_SCAN_RESULTS = 16;
+
+// Device -> server:
+//   { action: "heartbeat", timestamp }
+//   { action: "scan", seq, tagId, location, timestamp }
+//   { action: "command_ack", id, version }
+// Server -> device:
+//   { action: "heartbeat_ack", timestamp }
+//   { action: "scan_result", seq, success, scan: { tagId, isRegistered }, user?, error? }
+//     (an unregistered tag is success: true, isRegistered: false)
+//   { action: "commands", id, version, commands, deviceStatus }
+//
+// "commands" carries the same set and ETag version as GET /commands. The
+// device acknowledges the version it applied; until it does, the set is
+// re-sent every COMMAND_ACK_TIMEOUT_MS. A change is pushed at once only when
+// it is made through this isolate; otherwise the push can lag by up to
+// COMMAND_CHECK_INTERVAL_MS (60 s).
+//
+// Scans may be pipelined: the device keeps several in flight and matches
+// each scan_result to its tap by seq. A scan it resends after a timeout
+// carries the same seq and gets the first result again. That holds only
+// within one socket: seq is not stored, so a scan resent after a reconnect
+// or over HTTP is recorded again. Scan delivery is at-least-once.
+//
+// The same messages may arrive as binary MessagePack frames (see
+// lib/deviceWire.ts). Each reply goes out in the encoding of the message it
+// answers. The "commands" push uses the socket's encoding: MessagePack when
+// the device connected with ?encoding=msgpack or has sent a binary frame.
+const serveDeviceSocket = (
+  socket: WebSocket,
+  db: Database,
+  device: Device,
+  binaryPeer: boolean
+) => {
+  const deviceId = device.deviceId;
+  let nextPushId = 1;
+  let ackedVersion = "";
+  let pending: { id: number; version: string; sentAt: number } | null = null;
+  let checking = false;
+  let closed = false;
+  let resendTimer: ReturnType<typeof setTimeout> | null = null;
+  const recentScans = new Map<number, Promise<any>>();
+
+  const send = (message: any, binary = false) => {
+    if (closed) return;
+    try {
+      const frame = binary ? encodeDeviceFrame(message) : null;
+      socket.send(frame ?? JSON.stringify(message));
+    } catch (error) {
+      console.error(`Device ${deviceId} socket send error:`, error);
+    }
+  };
+
+  // Push the command set if the device does not hold the current version
+  const checkCommands = async () => {
+    if (checking || closed) return;
+    checking = true;
+    try {
+      const [state] = await db
+        .select({
+          isActive: devices.isActive,
+          registrationMode: devices.registrationMode,
+          scanMode: devices.scanMode,
+          pendingRegistrationTagId: devices.pendingRegistrationTagId,
+        })
+        .from(devices)
+        .where(eq(devices.deviceId, deviceId))
+        .limit(1);
+
+      if (!state) {
+        socket.close(1008, "Device not found");
+        return;
+      }
+
+      const version = commandsEtag(state);
+      if (version === ackedVersion) return;
+      if (
+        pending &&
+        pending.version === version &&
+        Date.now() - pending.sentAt < COMMAND_ACK_TIMEOUT_MS
+      ) {
+        return;
+      }
+
+      pending = { id: nextPushId++, version, sentAt: Date.now() };
+      // The safety net is too slow to drive resends; check again on timeout
+      if (resendTimer) clearTimeout(resendTimer);
+      resendTimer = setTimeout(() => {
+        resendTimer = null;
+        if (!pending) return;
+        pending.sentAt = 0; // Expired, whatever the clock says
+        checkCommands();
+      }, COMMAND_ACK_TIMEOUT_MS);
+      send(
+        {
+          action: "commands",
+          id: pending.id,
+          version,
+          commands: buildDeviceCommands(state),
+          deviceStatus: {
+            isActive: state.isActive,
+            registrationMode: state.registrationMode,
+            scanMode: state.scanMode,
+          },
+        },
+        binaryPeer
+      );
+    } catch (error) {
+      console.error(`Device ${deviceId} command check error:`, error);
+    } finally {
+      checking = false;
+    }
+  };
+
+  // An unregistered tag (404 on HTTP) is a verdict, not a failure: the
+  // device shows "not registered" and caches it, as it does for the 404
+  const scanReply = async (message: any) => {
+    const result = await recordDeviceScan(db, device, message);
+    const data = result.body.data ?? {};
+    const registered = result.status !== 404;
+    return {
+      action: "scan_result",
+      success: registered ? result.body.success : true,
+      scan: {
+        tagId: data.scan?.tagId ?? data.tagId ?? message.tagId,
+        isRegistered: registered,
+      },
+      ...(data.user ? { user: data.user } : {}),
+      ...(result.body.success || !registered ? {} : { error: result.body.message }),
+    };
+  };
+
+  const handleMessage = async (message: any, binary: boolean) => {
+    switch (message?.action) {
+      case "heartbeat": {
+        await db
+          .update(devices)
+          .set({ lastSeen: new Date(), updatedAt: new Date() })
+          .where(eq(devices.deviceId, deviceId));
+        send({ action: "heartbeat_ack", timestamp: Date.now() }, binary);
+        break;
+      }
+
+      case "scan": {
+        const seq = Number(message.seq);
+        const hasSeq = Number.isInteger(seq) && seq > 0;
+
+        // A resend (or a duplicate still being processed) shares the result
+        let reply = hasSeq ? recentScans.get(seq) : undefined;
+        if (!reply) {
+          reply = scanReply(message);
+          if (hasSeq) {
+            recentScans.set(seq, reply);
+            if (recentScans.size > RECENT_SCAN_RESULTS) {
+              recentScans.delete(recentScans.keys().next().value!);
+            }
+          }
+        }
+
+        try {
+          send({ ...(await reply), ...(hasSeq ? { seq } : {}) }, binary);
+        } catch (error) {
+          if (hasSeq) recentScans.delete(seq);
+          throw error;
+        }
+        break;
+      }
+
+      case "command_ack": {
+        if (pending && message.id === pending.id) {
+          ackedVersion = pending.version;
+          pending = null;
+        } else if (typeof message.version === "string") {
+          ackedVersion = message.version;
+        }
+        break;
+      }
+
+      default:
+        send(
+          { success: false, error: `Unknown action: ${message?.action}` },
+          binary
+        );
+    }
+  };
+
+  socket.addEventListener("message", async (event: MessageEvent) => {
+    const binary = typeof event.data !== "string";
+    if (binary) binaryPeer = true; // Older builds do not ask for msgpack
+    let message: any;
+    try {
+      message = binary
+        ? decodeDeviceFrame(event.data as ArrayBuffer)
+        : JSON.parse(event.data as string);
+    } catch {
+      send({ success: false, error: binary ? "Invalid frame" : "Invalid JSON" }, binary);
+      return;
+    }
+
+    try {
+      await handleMessage(message, binary);
+    } catch (error: any) {
+      console.error(`Device ${deviceId} socket message error:`, error);
+      send({ success: false, error: error.message || "Internal error" }, binary);
+    }
+  });
+
+  const timer = setInterval(checkCommands, COMMAND_CHECK_INTERVAL_MS);
+  const unsubscribe = onDeviceCommandsChanged(deviceId, () => {
+    checkCommands();
+  });
+
+  const shutdown = () => {
+    if (closed) return;
+    closed = true;
+    clearInterval(timer);
+    if (resendTimer) clearTimeout(resendTimer);
+    unsubscribe();
+    console.log(`Device ${deviceId} socket closed`);
+  };
+  socket.addEventListener("close", shutdown);
+  socket.addEventListener("error", shutdown);
+
+  // The current set goes out on connect; the device acks it without
+  // reapplying when it already holds that version from an HTTP poll
+  console.log(`Device ${deviceId} socket opened`);
+  checkCommands();
+};
+
+// GET /ws/device?deviceId=ID[&encoding=msgpack] - WebSocket for ESP32
+// devices (device auth)
+app.get("/", deviceAuthMiddleware, async (c) => {
+  const deviceId = c.req.query("deviceId");
+  const device = c.get("device");
+
+  if (!deviceId) {
+    return c.json(
+      {
+        success: false,
+        message: "Missing deviceId parameter",
+      },
+      400
+    );
+  }
+
+  // Verify deviceId matches authenticated device
+  if (!device || device.deviceId !== deviceId) {
+    return c.json(
+      {
+        success: false,
+        message: "Device ID mismatch",
+      },
+      403
+    );
+  }
+
+  if (c.req.header("Upgrade")?.toLowerCase() !== "websocket") {
+    return c.json(
+      {
+        success: false,
+        message: "Expected WebSocket upgrade",
+      },
+      426
+    );
+  }
+
+  const pair = new WebSocketPair();
+  const [client, server] = Object.values(pair);
+  server.accept();
+  serveDeviceSocket(server, c.get("db"), device, c.req.query("encoding") === "msgpack");
+
+  return new Response(null, { status: 101, webSocket: client });
+});
+
+export default app;
@@ -11,8 +11,10 @@ import {
   NewRfidScan,
   type Device,
 } from "../db/schema";
-import { eq, desc, and, isNull, sql } from "drizzle-orm";
+import { eq, desc, and, or, isNull, sql, inArray } from "drizzle-orm";
 import type { Database } from "../db";
+import { validateRfidTag } from "../lib/validation";
+import { buildTagFilter, encodeTagFilterBits } from "../lib/tagFilter";
 
 type Env = {
   Bindings: {
@@ -105,6 +107,176 @@ const fetchUnregisteredTags = async (db: Database, limit: number) => {
   };
 };
 
+type DeviceScanResult = {
+  status: 200 | 400 | 403 | 404;
+  body: any;
+};
+
+// Records one live scan from an ESP32 and builds the reply. Shared by
+// POST /api/rfid/scan and the device WebSocket (src/routes/deviceSocket.ts).
+export const recordDeviceScan = async (
+  db: Database,
+  device: Device,
+  { tagId, location, vehicleId }: any
+): Promise<DeviceScanResult> => {
+  const normalizedTagId = normalizeTagId(tagId);
+
+  if (!normalizedTagId) {
+    return {
+      status: 400,
+      body: {
+        success: false,
+        message: "Missing required field: tagId is required",
+      },
+    };
+  }
+
+  console.log(
+    `RFID scan attempt: ${normalizedTagId} from device ${device.deviceId}`
+  );
+
+  // Check if RFID exists and is active
+  const [rfidTag] = await db
+    .select()
+    .from(rfids)
+    .leftJoin(users, eq(rfids.userId, users.id))
+    .where(sql`${rfids.tagId} ILIKE ${normalizedTagId}`)
+    .limit(1);
+
+  if (!rfidTag || !rfidTag.Rfids) {
+    console.warn(`Unregistered RFID: ${normalizedTagId}`);
+
+    // Record failed scan attempt
+    const failedScan: NewRfidScan = {
+      rfidTagId: normalizedTagId,
+      deviceId: device.deviceId,
+      location: location || null,
+      vehicleId: vehicleId || null,
+      status: "failed",
+      eventType: "unknown",
+      metadata: { reason: "Tag not registered" },
+    };
+
+    await db.insert(rfidScans).values(failedScan);
+
+    return {
+      status: 404,
+      body: {
+        success: false,
+        message: "RFID tag not registered",
+        data: { tagId: normalizedTagId, registered: false },
+      },
+    };
+  }
+
+  const { Rfids: rfid, Users: user } = rfidTag;
+
+  // Check if RFID is active
+  if (!rfid.isActive) {
+    const inactiveScan: NewRfidScan = {
+      rfidTagId: normalizedTagId,
+      deviceId: device.deviceId,
+      userId: user?.id || null,
+      location: location || null,
+      vehicleId: vehicleId || null,
+      status: "unauthorized",
+      eventType: "unknown",
+      metadata: { reason: "Tag is inactive" },
+    };
+
+    await db.insert(rfidScans).values(inactiveScan);
+
+    return {
+      status: 403,
+      body: {
+        success: false,
+        message: "RFID tag is inactive",
+        data: { tagId: normalizedTagId, active: false },
+      },
+    };
+  }
+
+  // Check if user is active (if associated)
+  if (user && !user.isActive) {
+    const unauthorizedScan: NewRfidScan = {
+      rfidTagId: normalizedTagId,
+      deviceId: device.deviceId,
+      userId: user.id,
+      location: location || null,
+      vehicleId: vehicleId || null,
+      status: "unauthorized",
+      eventType: "unknown",
+      metadata: { reason: "User is inactive" },
+    };
+
+    await db.insert(rfidScans).values(unauthorizedScan);
+
+    return {
+      status: 403,
+      body: {
+        success: false,
+        message: "User associated with this RFID is inactive",
+        data: {
+          tagId: normalizedTagId,
+          userName: user.name,
+          userActive: false,
+        },
+      },
+    };
+  }
+
+  // Record successful scan
+  const successScan: NewRfidScan = {
+    rfidTagId: normalizedTagId,
+    deviceId: device.deviceId,
+    userId: user?.id || null,
+    location: location || null,
+    vehicleId: vehicleId || null,
+    status: "success",
+    eventType: "entry", // Default to entry, can be customized
+    metadata: {},
+  };
+
+  const [scan] = await db.insert(rfidScans).values(successScan).returning();
+
+  // Update RFID last scanned
+  await db
+    .update(rfids)
+    .set({
+      lastScanned: new Date(),
+      deviceId: device.deviceId,
+    })
+    .where(sql`${rfids.tagId} ILIKE ${normalizedTagId}`);
+
+  return {
+    status: 200,
+    body: {
+      success: true,
+      message: "Scan recorded successfully",
+      data: {
+        scan: {
+          id: scan.id,
+          tagId: normalizedTagId,
+          scanTime: scan.scanTime,
+          status: scan.status,
+          eventType: scan.eventType,
+        },
+        user: user
+          ? {
+              id: user.id,
+              name: user.name,
+              role: user.role,
+            }
+          : null,
+        rfid: {
+          tagId: normalizeTagId(rfid.tagId),
+          isActive: rfid.isActive,
+        },
+      },
+    },
+  };
+};
+
 // POST /api/rfid/scan - Handle RFID scan from ESP32 device
 app.post("/scan", deviceAuthMiddleware, async (c) => {
   try {
@@ -121,166 +293,234 @@ app.post("/scan", deviceAuthMiddleware, async (c) => {
       );
     }
 
-    const { tagId, location, vehicleId } = await c.req.json();
-    const normalizedTagId = normalizeTagId(tagId);
+    const result = await recordDeviceScan(db, device, await c.req.json());
+    return c.json(result.body, result.status);
+  } catch (error: any) {
+    console.error("Scan error:", error);
+    return c.json(
+      {
+        success: false,
+        message: "Failed to process scan",
+        error: error.message,
+      },
+      500
+    );
+  }
+});
+
+// POST /api/rfid/batch-scan - Upload scans an ESP32 recorded while offline
+// Body: { journal, scans: [{ seq, tagId, scannedAt?, offline }] }, oldest first.
+// seq is the device's journal sequence and journal the random ID of that
+// journal, redrawn whenever the sequence restarts (e.g. flash reformatted);
+// a batch re-sent after a lost response is recognised by the pair and not
+// recorded twice. Batches without journal (older firmware) dedupe on seq. Per-scan outcomes (unregistered,
+// inactive) are reported in the results but never fail the batch: the device
+// clears its journal on any 2xx.
+const MAX_BATCH_SCANS = 50;
+
+app.post("/batch-scan", deviceAuthMiddleware, async (c) => {
+  try {
+    const db = c.get("db");
+    const device = c.get("device");
 
-    if (!normalizedTagId) {
+    if (!device) {
       return c.json(
         {
           success: false,
-          message: "Missing required field: tagId is required",
+          message: "Device not authenticated",
         },
-        400
+        401
       );
     }
 
-    console.log(
-      `RFID scan attempt: ${normalizedTagId} from device ${device.deviceId}`
-    );
-
-    // Check if RFID exists and is active
-    const [rfidTag] = await db
-      .select()
-      .from(rfids)
-      .leftJoin(users, eq(rfids.userId, users.id))
-      .where(sql`${rfids.tagId} ILIKE ${normalizedTagId}`)
-      .limit(1);
-
-    if (!rfidTag || !rfidTag.Rfids) {
-      console.warn(`Unregistered RFID: ${normalizedTagId}`);
-
-      // Record failed scan attempt
-      const failedScan: NewRfidScan = {
-        rfidTagId: normalizedTagId,
-        deviceId: device.deviceId,
-        location: location || null,
-        vehicleId: vehicleId || null,
-        status: "failed",
-        eventType: "unknown",
-        metadata: { reason: "Tag not registered" },
-      };
-
-      await db.insert(rfidScans).values(failedScan);
+    const body = await c.req.json().catch(() => null);
+    const scans = body?.scans;
+    const journalId =
+      typeof body?.journal === "string" && /^[0-9a-f]{8}$/i.test(body.journal)
+        ? body.journal.toLowerCase()
+        : null;
 
+    if (!Array.isArray(scans) || scans.length === 0 || scans.length > MAX_BATCH_SCANS) {
       return c.json(
         {
           success: false,
-          message: "RFID tag not registered",
-          data: { tagId: normalizedTagId, registered: false },
+          message: `scans must be an array of 1-${MAX_BATCH_SCANS} items`,
         },
-        404
+        400
       );
     }
 
-    const { Rfids: rfid, Users: user } = rfidTag;
+    // Sequences this device has already uploaded from this journal
+    const sequences = scans
+      .map((scan: any) => Number(scan?.seq))
+      .filter((seq: number) => Number.isInteger(seq) && seq > 0);
+    const recorded = new Set<string>();
+    if (sequences.length > 0) {
+      const existing = await db
+        .select({ seq: sql<string>`${rfidScans.metadata}->>'journalSeq'` })
+        .from(rfidScans)
+        .where(
+          and(
+            eq(rfidScans.deviceId, device.deviceId),
+            journalId
+              ? sql`${rfidScans.metadata}->>'journalId' = ${journalId}`
+              : sql`${rfidScans.metadata}->>'journalId' IS NULL`,
+            inArray(
+              sql`${rfidScans.metadata}->>'journalSeq'`,
+              sequences.map(String)
+            )
+          )
+        );
+      existing.forEach((row) => recorded.add(String(row.seq)));
+    }
+
+    const tagCache = new Map<string, any>();
+    const now = Date.now();
+    const results: Array<{ seq: number | null; status: string }> = [];
+    let accepted = 0;
+
+    for (const scan of scans) {
+      const seq = Number(scan?.seq);
+      const normalizedTagId = normalizeTagId(scan?.tagId);
+
+      if (!Number.isInteger(seq) || seq <= 0) {
+        results.push({ seq: scan?.seq ?? null, status: "invalid" });
+        continue;
+      }
+      if (recorded.has(String(seq))) {
+        results.push({ seq, status: "duplicate" });
+        continue;
+      }
+      if (!validateRfidTag(normalizedTagId).valid) {
+        results.push({ seq, status: "invalid" });
+        continue;
+      }
+
+      if (!tagCache.has(normalizedTagId)) {
+        const [rfidTag] = await db
+          .select()
+          .from(rfids)
+          .leftJoin(users, eq(rfids.userId, users.id))
+          .where(sql`${rfids.tagId} ILIKE ${normalizedTagId}`)
+          .limit(1);
+        tagCache.set(normalizedTagId, rfidTag ?? null);
+      }
+      const rfidTag = tagCache.get(normalizedTagId);
+      const rfid = rfidTag?.Rfids;
+      const user = rfidTag?.Users;
+
+      // Keep the tap time when the device clock was synced and it is sane
+      const scannedAt = Number(scan.scannedAt) * 1000;
+      const scanTime =
+        Number.isFinite(scannedAt) && scannedAt > 0 && scannedAt <= now
+          ? new Date(scannedAt)
+          : new Date(now);
+
+      let status: "success" | "failed" | "unauthorized" = "success";
+      let reason: string | undefined;
+      if (!rfid) {
+        status = "failed";
+        reason = "Tag not registered";
+      } else if (!rfid.isActive) {
+        status = "unauthorized";
+        reason = "Tag is inactive";
+      } else if (user && !user.isActive) {
+        status = "unauthorized";
+        reason = "User is inactive";
+      }
 
-    // Check if RFID is active
-    if (!rfid.isActive) {
-      const inactiveScan: NewRfidScan = {
+      const offlineScan: NewRfidScan = {
         rfidTagId: normalizedTagId,
         deviceId: device.deviceId,
         userId: user?.id || null,
-        location: location || null,
-        vehicleId: vehicleId || null,
-        status: "unauthorized",
-        eventType: "unknown",
-        metadata: { reason: "Tag is inactive" },
+        location: device.location || null,
+        status,
+        eventType: status === "success" ? "entry" : "unknown",
+        scanTime,
+        metadata: {
+          ...(journalId ? { journalId } : {}),
+          journalSeq: seq,
+          offline: scan.offline === true,
+          clockSynced: scanTime.getTime() === scannedAt,
+          ...(reason ? { reason } : {}),
+        },
       };
 
-      await db.insert(rfidScans).values(inactiveScan);
-
-      return c.json(
-        {
-          success: false,
-          message: "RFID tag is inactive",
-          data: { tagId: normalizedTagId, active: false },
-        },
-        403
-      );
+      await db.insert(rfidScans).values(offlineScan);
+      recorded.add(String(seq));
+      accepted++;
+      results.push({ seq, status });
     }
 
-    // Check if user is active (if associated)
-    if (user && !user.isActive) {
-      const unauthorizedScan: NewRfidScan = {
-        rfidTagId: normalizedTagId,
-        deviceId: device.deviceId,
-        userId: user.id,
-        location: location || null,
-        vehicleId: vehicleId || null,
-        status: "unauthorized",
-        eventType: "unknown",
-        metadata: { reason: "User is inactive" },
-      };
+    return c.json({
+      success: true,
+      message: `Recorded ${accepted} of ${scans.length} offline scans`,
+      data: {
+        accepted,
+        results,
+      },
+    });
+  } catch (error: any) {
+    console.error("Batch scan error:", error);
+    return c.json(
+      {
+        success: false,
+        message: "Failed to process batch scan",
+        error: error.message,
+      },
+      500
+    );
+  }
+});
 
-      await db.insert(rfidScans).values(unauthorizedScan);
+// GET /api/rfid/filter?version=N - Bloom filter of active tags for offline
+// verdicts on the ESP32. A device already holding this version gets
+// { unchanged: true } instead of the bits.
+app.get("/filter", deviceAuthMiddleware, async (c) => {
+  try {
+    const db = c.get("db");
 
-      return c.json(
-        {
-          success: false,
-          message: "User associated with this RFID is inactive",
-          data: {
-            tagId: normalizedTagId,
-            userName: user.name,
-            userActive: false,
-          },
-        },
-        403
+    // Same rules as /scan: an active tag whose user is inactive is refused
+    // (403), so it must not read as registered offline either
+    const activeTags = await db
+      .select({ tagId: rfids.tagId })
+      .from(rfids)
+      .leftJoin(users, eq(rfids.userId, users.id))
+      .where(
+        and(
+          eq(rfids.isActive, true),
+          or(isNull(users.id), eq(users.isActive, true))
+        )
       );
-    }
 
-    // Record successful scan
-    const successScan: NewRfidScan = {
-      rfidTagId: normalizedTagId,
-      deviceId: device.deviceId,
-      userId: user?.id || null,
-      location: location || null,
-      vehicleId: vehicleId || null,
-      status: "success",
-      eventType: "entry", // Default to entry, can be customized
-      metadata: {},
-    };
-
-    const [scan] = await db.insert(rfidScans).values(successScan).returning();
+    const filter = buildTagFilter(activeTags.map((row) => row.tagId));
+    const knownVersion = Number(c.req.query("version") || 0);
 
-    // Update RFID last scanned
-    await db
-      .update(rfids)
-      .set({
-        lastScanned: new Date(),
-        deviceId: device.deviceId,
-      })
-      .where(sql`${rfids.tagId} ILIKE ${normalizedTagId}`);
+    if (knownVersion === filter.version) {
+      return c.json({
+        success: true,
+        message: "Tag filter unchanged",
+        data: { version: filter.version, unchanged: true },
+      });
+    }
 
     return c.json({
       success: true,
-      message: "Scan recorded successfully",
+      message: `Tag filter with ${filter.tagCount} tags`,
       data: {
-        scan: {
-          id: scan.id,
-          tagId: normalizedTagId,
-          scanTime: scan.scanTime,
-          status: scan.status,
-          eventType: scan.eventType,
-        },
-        user: user
-          ? {
-              id: user.id,
-              name: user.name,
-              role: user.role,
-            }
-          : null,
-        rfid: {
-          tagId: normalizeTagId(rfid.tagId),
-          isActive: rfid.isActive,
-        },
+        version: filter.version,
+        bitCount: filter.bitCount,
+        hashCount: filter.hashCount,
+        tagCount: filter.tagCount,
+        bits: encodeTagFilterBits(filter.bits),
       },
     });
   } catch (error: any) {
-    console.error("Scan error:", error);
+    console.error("Tag filter error:", error);
     return c.json(
       {
         success: false,
-        message: "Failed to process scan",
+        message: "Failed to build tag filter",
         error: error.message,
       },
       500
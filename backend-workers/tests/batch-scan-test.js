@@ -0,0 +1,130 @@
+// ============================================================================
+// OFFLINE BATCH SCAN TEST SCRIPT
+// ============================================================================
+// Posts a batch in the exact format the ESP32 drain worker sends
+// (ScanBatchWriter) and re-sends it, as the device does when a response is
+// lost. The second upload must be reported as duplicates, not re-recorded,
+// while the same sequence numbers from a new journal are new scans.
+//
+// Usage: DEVICE_API_KEY=<device key> node tests/batch-scan-test.js
+
+const BASE_URL = process.env.BASE_URL || "http://localhost:8787";
+const API_KEY = process.env.DEVICE_API_KEY;
+
+// ANSI color codes for terminal output
+const colors = {
+  reset: "\x1b[0m",
+  bright: "\x1b[1m",
+  red: "\x1b[31m",
+  green: "\x1b[32m",
+  yellow: "\x1b[33m",
+  cyan: "\x1b[36m",
+};
+
+function log(message, color = "reset") {
+  console.log(`${colors[color]}${message}${colors.reset}`);
+}
+
+function logSection(title) {
+  log("\n" + "=".repeat(60), "cyan");
+  log(`  ${title}`, "bright");
+  log("=".repeat(60), "cyan");
+}
+
+function logSuccess(message) {
+  log(`✅ ${message}`, "green");
+}
+
+function logError(message) {
+  log(`❌ ${message}`, "red");
+}
+
+// Firmware body: {"journal":"..","scans":[{"seq":..,"tagId":"..","scannedAt":..,"offline":..}]}
+function buildBatch(journal, firstSeq) {
+  const now = Math.floor(Date.now() / 1000);
+  return {
+    journal,
+    scans: [
+      { seq: firstSeq, tagId: "04A1B2C3", scannedAt: now - 120, offline: true },
+      { seq: firstSeq + 1, tagId: "04A1B2C3D4E5F6", offline: true },
+      { seq: firstSeq + 2, tagId: "DEADBEEF", scannedAt: now - 60, offline: false },
+    ],
+  };
+}
+
+async function postBatch(batch) {
+  const response = await fetch(`${BASE_URL}/api/rfid/batch-scan`, {
+    method: "POST",
+    headers: {
+      "Content-Type": "application/json",
+      "X-API-Key": API_KEY,
+    },
+    body: JSON.stringify(batch),
+  });
+  return { status: response.status, data: await response.json() };
+}
+
+async function runBatchScanTest() {
+  logSection("🧪 OFFLINE BATCH SCAN TEST");
+
+  if (!API_KEY) {
+    logError("Set DEVICE_API_KEY to a registered device's API key");
+    process.exit(1);
+  }
+
+  // A journal ID unique to this run so earlier runs don't interfere
+  const randomJournal = () =>
+    Math.floor(Math.random() * 0xffffffff).toString(16).padStart(8, "0");
+  const batch = buildBatch(randomJournal(), 1);
+  let passed = true;
+
+  const first = await postBatch(batch);
+  log(`First upload: ${first.status} ${first.data.message || ""}`);
+  if (first.status === 200 && first.data.data.accepted === batch.scans.length) {
+    logSuccess("All scans recorded");
+  } else {
+    logError("Expected every scan to be recorded");
+    passed = false;
+  }
+
+  const second = await postBatch(batch);
+  log(`Re-sent upload: ${second.status} ${second.data.message || ""}`);
+  const duplicates = (second.data.data?.results || []).filter(
+    (r) => r.status === "duplicate"
+  ).length;
+  if (second.status === 200 && duplicates === batch.scans.length) {
+    logSuccess("Re-sent batch recognised as duplicates");
+  } else {
+    logError("Re-sent batch was recorded again");
+    passed = false;
+  }
+
+  // Reformatted flash: same sequence numbers, new journal ID
+  const reformatted = await postBatch(buildBatch(randomJournal(), 1));
+  log(`Same seqs, new journal: ${reformatted.status} ${reformatted.data.message || ""}`);
+  if (
+    reformatted.status === 200 &&
+    reformatted.data.data.accepted === batch.scans.length
+  ) {
+    logSuccess("New journal's scans recorded, not taken as duplicates");
+  } else {
+    logError("Scans from a new journal were reported as duplicates");
+    passed = false;
+  }
+
+  const invalid = await postBatch({ scans: [] });
+  if (invalid.status === 400) {
+    logSuccess("Empty batch rejected with 400");
+  } else {
+    logError(`Empty batch returned ${invalid.status}`);
+    passed = false;
+  }
+
+  logSection(passed ? "✅ ALL CHECKS PASSED" : "❌ SOME CHECKS FAILED");
+  process.exit(passed ? 0 : 1);
+}
+
+runBatchScanTest().catch((error) => {
+  logError(`Test failed: ${error.message}`);
+  process.exit(1);
+});
@@ -0,0 +1,167 @@
+// ============================================================================
+// DEVICE SYNC STAND-IN CHECK
+// ============================================================================
+// Starts tests/sync-standin-server.js and runs the firmware's sync exchange
+// against it, request for request: the same headers and body as
+// ApiModule::sendSync(), the ETag cursor of acceptServerCommands(), and the
+// fallback rule of NetworkTask::handleSync() (only the router's notFound
+// means "no /sync"; the backend's own 404 is an answer). Covers the current
+// backend, a legacy one without /sync, and an unregistered device.
+//
+// Usage: node tests/sync-standin-check.js
+
+import { spawn } from "node:child_process";
+import { fileURLToPath } from "node:url";
+
+const SERVER = fileURLToPath(new URL("./sync-standin-server.js", import.meta.url));
+const DEVICE_ID = "AABBCCDDEEFF";
+
+// ANSI color codes for terminal output
+const colors = {
+  reset: "\x1b[0m",
+  bright: "\x1b[1m",
+  red: "\x1b[31m",
+  green: "\x1b[32m",
+  cyan: "\x1b[36m",
+};
+
+function log(message, color = "reset") {
+  console.log(`${colors[color]}${message}${colors.reset}`);
+}
+
+let passed = true;
+function check(condition, message) {
+  if (condition) {
+    log(`✅ ${message}`, "green");
+  } else {
+    log(`❌ ${message}`, "red");
+    passed = false;
+  }
+}
+
+function startServer(port, args = []) {
+  return new Promise((resolve, reject) => {
+    const child = spawn(process.execPath, [SERVER, ...args], {
+      env: { ...process.env, PORT: String(port) },
+      stdio: ["ignore", "pipe", "inherit"],
+    });
+    child.stdout.on("data", (chunk) => {
+      if (String(chunk).includes("listening")) resolve(child);
+    });
+    child.on("error", reject);
+    child.on("exit", (code) => reject(new Error(`stand-in exited (${code})`)));
+  });
+}
+
+// Body of ApiModule::fillHeartbeat() (stats trimmed) plus sendSync() telemetry
+function syncBody(includeStats, telemetry) {
+  return {
+    status: "online",
+    uptime: 120,
+    freeHeap: 180000,
+    location: "Main Terminal",
+    firmwareVersion: "2.0.0",
+    registrationMode: false,
+    scanMode: false,
+    ...(includeStats ? { stats: { totalScans: 3, errorCount: 0 } } : {}),
+    ...(telemetry.length
+      ? {
+          telemetry: telemetry.map((reason) => ({ type: "status", reason, ageMs: 500 })),
+        }
+      : {}),
+  };
+}
+
+async function sendSync(base, etag, telemetry = []) {
+  const response = await fetch(`${base}/api/devices/${DEVICE_ID}/sync`, {
+    method: "POST",
+    headers: {
+      "Content-Type": "application/json",
+      "x-api-key": "standin-key",
+      "User-Agent": "TagSakay Scanner/2.0",
+      ...(etag ? { "If-None-Match": etag } : {}),
+    },
+    body: JSON.stringify(syncBody(true, telemetry)),
+  });
+  const text = await response.text();
+  let body = null;
+  try {
+    body = text ? JSON.parse(text) : null;
+  } catch {}
+  return { status: response.status, etag: response.headers.get("etag"), body };
+}
+
+// NetworkTask.cpp isRouteNotFound()
+function isRouteNotFound(reply) {
+  if (reply.status !== 404) return false;
+  if (!reply.body || !("success" in reply.body)) return true;
+  return reply.body.message === "Route not found";
+}
+
+async function control(base, query) {
+  await fetch(`${base}/control?${query}`, { method: "POST" });
+}
+
+async function run() {
+  log("\n🧪 DEVICE SYNC STAND-IN CHECK", "bright");
+
+  // Current backend
+  let server = await startServer(18788);
+  let base = "http://localhost:18788";
+  try {
+    const first = await sendSync(base, "", ["boot"]);
+    check(first.status === 200 && first.etag, "First sync returns the command set and an ETag");
+    check(
+      Array.isArray(first.body?.data?.commands) && first.body.data.telemetryAccepted === 1,
+      "Telemetry accepted and commands included"
+    );
+
+    const second = await sendSync(base, first.etag);
+    check(second.status === 204, "Sync with the held ETag is answered 204 (unchanged)");
+
+    await control(base, "registrationMode=1&tagId=04A1B2C3");
+    const changed = await sendSync(base, first.etag);
+    check(
+      changed.status === 200 && changed.etag !== first.etag &&
+        changed.body.data.commands[0]?.action === "enable_registration",
+      "State change on the server comes back with a new ETag"
+    );
+
+    await control(base, "registered=0");
+    const unregistered = await sendSync(base, changed.etag);
+    check(unregistered.status === 404, "Unregistered device: /sync answers 404");
+    check(
+      !isRouteNotFound(unregistered),
+      "…and the firmware keeps /sync (Device not found is an answer)"
+    );
+  } finally {
+    server.kill();
+  }
+
+  // Backend without /sync
+  server = await startServer(18789, ["--legacy"]);
+  base = "http://localhost:18789";
+  try {
+    const legacy = await sendSync(base, "");
+    check(
+      legacy.status === 404 && isRouteNotFound(legacy),
+      "Legacy backend: router's 404 makes the firmware fall back"
+    );
+    const heartbeat = await fetch(`${base}/api/devices/${DEVICE_ID}/heartbeat`, {
+      method: "POST",
+      headers: { "Content-Type": "application/json", "x-api-key": "standin-key" },
+      body: JSON.stringify(syncBody(true, [])),
+    });
+    check(heartbeat.status === 200, "Fallback heartbeat accepted");
+  } finally {
+    server.kill();
+  }
+
+  log(passed ? "\n✅ ALL CHECKS PASSED" : "\n❌ SOME CHECKS FAILED", passed ? "green" : "red");
+  process.exit(passed ? 0 : 1);
+}
+
+run().catch((error) => {
+  log(`❌ Check failed: ${error.message}`, "red");
+  process.exit(1);
+});
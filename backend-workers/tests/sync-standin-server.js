@@ -0,0 +1,208 @@
+// ============================================================================
+// DEVICE SYNC STAND-IN SERVER
+// ============================================================================
+// A local stand-in for the device endpoints the ESP32 talks to, for
+// testing the firmware's sync exchange without Workers or a database.
+// Point serverConfig.baseUrl at http://<this machine>:8788 and watch the
+// log: every request is printed, and request counts per endpoint are
+// summarised each minute. An idle device should show one sync per
+// HEARTBEAT_INTERVAL where it used to send a heartbeat plus six polls, and
+// once it holds the current ETag those syncs come back empty (unchanged).
+//
+// Usage:
+//   node tests/sync-standin-server.js            # Current backend (/sync)
+//   node tests/sync-standin-server.js --legacy   # Backend without /sync
+//
+// Device state can be changed while it runs, as the dashboard would:
+//   curl -X POST "localhost:8788/control?registrationMode=1&tagId=04A1B2C3"
+//   curl -X POST "localhost:8788/control?registrationMode=0&scanMode=1"
+//   curl -X POST "localhost:8788/control?registered=0"   # /sync: 404 Device not found
+//
+// tests/sync-standin-check.js drives it through the firmware's exchange.
+
+import http from "node:http";
+
+const PORT = Number(process.env.PORT || 8788);
+const LEGACY = process.argv.includes("--legacy");
+
+const state = {
+  registered: true,
+  isActive: true,
+  registrationMode: false,
+  scanMode: false,
+  pendingRegistrationTagId: "",
+};
+
+const counts = {};
+
+// Same rules as buildDeviceCommands() in src/routes/device.ts
+function buildCommands() {
+  const commands = [];
+  if (state.registrationMode && state.pendingRegistrationTagId) {
+    commands.push({
+      action: "enable_registration",
+      tagId: state.pendingRegistrationTagId,
+      timestamp: Date.now(),
+    });
+  } else if (!state.registrationMode) {
+    commands.push({ action: "disable_registration", timestamp: Date.now() });
+  }
+  commands.push({ action: "scan_mode", enabled: state.scanMode, timestamp: Date.now() });
+  return commands;
+}
+
+// Same key and hash as commandsEtag() in src/routes/device.ts
+function commandsEtag() {
+  const key = [
+    state.isActive,
+    state.registrationMode,
+    state.scanMode,
+    state.pendingRegistrationTagId,
+  ].join("|");
+  let hash = 0x811c9dc5;
+  for (let i = 0; i < key.length; i++) {
+    hash ^= key.charCodeAt(i);
+    hash = Math.imul(hash, 0x01000193) >>> 0;
+  }
+  return `"c-${hash.toString(16).padStart(8, "0")}"`;
+}
+
+function deviceStatus() {
+  return {
+    isActive: state.isActive,
+    registrationMode: state.registrationMode,
+    scanMode: state.scanMode,
+  };
+}
+
+function send(res, status, body, headers = {}) {
+  if (body === null) {
+    res.writeHead(status, headers);
+    return res.end();
+  }
+  const payload = JSON.stringify(body);
+  res.writeHead(status, {
+    "Content-Type": "application/json",
+    "Content-Length": Buffer.byteLength(payload),
+    ...headers,
+  });
+  res.end(payload);
+}
+
+function readBody(req) {
+  return new Promise((resolve) => {
+    let data = "";
+    req.on("data", (chunk) => (data += chunk));
+    req.on("end", () => {
+      try {
+        resolve(data ? JSON.parse(data) : null);
+      } catch {
+        resolve(null);
+      }
+    });
+  });
+}
+
+function describe(body) {
+  if (!body) return "(no body)";
+  const parts = [
+    `regMode=${body.registrationMode}`,
+    `scanMode=${body.scanMode}`,
+    `stats=${body.stats ? "yes" : "no"}`,
+  ];
+  if (Array.isArray(body.telemetry)) {
+    parts.push(`telemetry=[${body.telemetry.map((e) => e.reason).join(", ")}]`);
+  }
+  return parts.join(" ");
+}
+
+const server = http.createServer(async (req, res) => {
+  const url = new URL(req.url, `http://localhost:${PORT}`);
+  const body = req.method === "POST" ? await readBody(req) : null;
+
+  if (url.pathname === "/control") {
+    for (const key of ["registered", "registrationMode", "scanMode", "isActive"]) {
+      if (url.searchParams.has(key)) {
+        state[key] = url.searchParams.get(key) === "1";
+      }
+    }
+    if (url.searchParams.has("tagId")) {
+      state.pendingRegistrationTagId = url.searchParams.get("tagId");
+    }
+    console.log("[control] state:", JSON.stringify(state));
+    return send(res, 200, { success: true, state });
+  }
+
+  const match = url.pathname.match(/^\/api\/devices\/([^/]+)\/(sync|heartbeat|commands|status)$/);
+  const etag = commandsEtag();
+  const unchanged = req.headers["if-none-match"] === etag;
+  const endpoint =
+    (match ? `${req.method} ${match[2]}` : `${req.method} ${url.pathname}`) +
+    (match && ["sync", "commands"].includes(match[2]) && unchanged ? " (unchanged)" : "");
+  counts[endpoint] = (counts[endpoint] || 0) + 1;
+  console.log(`[${new Date().toISOString()}] ${endpoint} ${describe(body)}`);
+
+  if (!req.headers["x-api-key"]) {
+    return send(res, 401, { success: false, message: "Missing API key" });
+  }
+
+  if (match && match[2] === "sync" && req.method === "POST" && !LEGACY) {
+    // The route exists but answers for the device, as src/routes/device.ts does
+    if (!state.registered) {
+      return send(res, 404, { success: false, message: "Device not found" });
+    }
+    const telemetry = Array.isArray(body?.telemetry) ? body.telemetry.slice(0, 16) : [];
+    if (unchanged) {
+      return send(res, 204, null, { ETag: etag });
+    }
+    return send(res, 200, {
+      success: true,
+      message: "Device synced",
+      data: {
+        commands: buildCommands(),
+        deviceStatus: deviceStatus(),
+        telemetryAccepted: telemetry.length,
+      },
+    }, { ETag: etag });
+  }
+
+  if (match && match[2] === "heartbeat" && req.method === "POST") {
+    return send(res, 200, { success: true, message: "Heartbeat received", data: {} });
+  }
+
+  if (match && match[2] === "commands" && req.method === "GET") {
+    if (unchanged) {
+      return send(res, 304, null, { ETag: etag });
+    }
+    return send(res, 200, {
+      success: true,
+      message: "Commands retrieved",
+      data: { commands: buildCommands(), deviceStatus: deviceStatus() },
+    }, { ETag: etag });
+  }
+
+  if (match && match[2] === "status" && req.method === "POST") {
+    return send(res, 200, { success: true, message: "Status recorded" });
+  }
+
+  if (url.pathname === "/health") {
+    return send(res, 200, { success: true, status: "ok" });
+  }
+
+  // Hono's notFound handler in src/index.ts answers the same way
+  return send(res, 404, { success: false, message: "Route not found" });
+});
+
+setInterval(() => {
+  const summary = Object.entries(counts)
+    .map(([endpoint, count]) => `${endpoint}=${count}`)
+    .join(" ");
+  console.log(`[summary] last minute: ${summary || "no requests"}`);
+  for (const key of Object.keys(counts)) delete counts[key];
+}, 60 * 1000);
+
+server.listen(PORT, () => {
+  console.log(
+    `Device stand-in listening on :${PORT} (${LEGACY ? "legacy, no /sync" : "with /sync"})`
+  );
+});
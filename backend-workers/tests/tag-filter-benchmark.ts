@@ -0,0 +1,77 @@
+// ============================================================================
+// TAG FILTER FALSE-POSITIVE BENCHMARK
+// ============================================================================
+// Builds filters from random 4- and 7-byte UIDs (the two common MIFARE
+// sizes) and measures how often unregistered UIDs are reported as
+// "likely registered". Also checks there are no false negatives.
+//
+// Usage: npm run bench:tag-filter
+
+import {
+  buildTagFilter,
+  tagFilterContains,
+  TAG_FILTER_MAX_BYTES,
+} from "../src/lib/tagFilter";
+
+const PROBES = 200000;
+
+const randomTagId = (): string => {
+  const length = Math.random() < 0.5 ? 4 : 7;
+  let hex = "";
+  for (let i = 0; i < length; i++) {
+    hex += Math.floor(Math.random() * 256)
+      .toString(16)
+      .padStart(2, "0")
+      .toUpperCase();
+  }
+  return hex;
+};
+
+const benchmark = (tagCount: number) => {
+  const registered = new Set<string>();
+  while (registered.size < tagCount) registered.add(randomTagId());
+  const tags = Array.from(registered);
+
+  const started = performance.now();
+  const filter = buildTagFilter(tags);
+  const buildMs = performance.now() - started;
+
+  const falseNegatives = tags.filter((tag) => !tagFilterContains(filter, tag)).length;
+
+  let falsePositives = 0;
+  let probes = 0;
+  const probeStarted = performance.now();
+  while (probes < PROBES) {
+    const tag = randomTagId();
+    if (registered.has(tag)) continue;
+    probes++;
+    if (tagFilterContains(filter, tag)) falsePositives++;
+  }
+  const probeUs = ((performance.now() - probeStarted) * 1000) / probes;
+
+  console.log(
+    [
+      `${String(tagCount).padStart(6)} tags`,
+      `${String(filter.bits.length).padStart(5)} bytes`,
+      `k=${String(filter.hashCount).padStart(2)}`,
+      `FPR ${((falsePositives / probes) * 100).toFixed(3).padStart(7)}%`,
+      `false negatives ${falseNegatives}`,
+      `build ${buildMs.toFixed(1)}ms`,
+      `lookup ${probeUs.toFixed(2)}us`,
+    ].join("  ")
+  );
+
+  return falseNegatives === 0;
+};
+
+console.log(`Tag filter benchmark (cap ${TAG_FILTER_MAX_BYTES} bytes, ${PROBES} probes)\n`);
+
+let ok = true;
+for (const count of [10, 100, 500, 1000, 2000, 3400, 5000, 10000]) {
+  ok = benchmark(count) && ok;
+}
+
+if (!ok) {
+  console.error("\nFalse negatives found - filter hashing is broken");
+  process.exit(1);
+}
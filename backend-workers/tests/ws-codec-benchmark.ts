@@ -0,0 +1,207 @@
+// ============================================================================
+// DEVICE SOCKET ENCODING BENCHMARK
+// ============================================================================
+// Compares the JSON device socket messages with their binary MessagePack
+// frames (src/lib/deviceWire.ts): bytes on the wire, and encode/decode time
+// on this machine. Every frame is decoded again and checked against its
+// message, so a broken key table fails here before it reaches a device.
+//
+// First, the shared frames in TagSakay_Fixed_Complete/tests/wire_vectors.txt
+// (which the firmware's codec is checked against too) must decode to their
+// fields, and the server's frames must encode to exactly their bytes.
+//
+// Usage: npm run bench:ws-codec
+
+import { readFileSync } from "node:fs";
+import { buildDeviceCommands } from "../src/lib/deviceCommands";
+import { decodeDeviceFrame, encodeDeviceFrame } from "../src/lib/deviceWire";
+
+const ITERATIONS = 100000;
+
+// Device -> server messages decode to the same flat shape; the server ->
+// device ones are compared flattened, as the firmware rebuilds them
+const messages: Record<string, any> = {
+  heartbeat: { action: "heartbeat", timestamp: 123456 },
+  scan: {
+    action: "scan",
+    seq: 42,
+    tagId: "04A1B2C3D4E5F6",
+    location: "Main Terminal",
+    timestamp: 987654,
+  },
+  command_ack: { action: "command_ack", id: 7, version: '"c-1a2b3c4d"' },
+  heartbeat_ack: { action: "heartbeat_ack", timestamp: Date.now() },
+  "scan_result (registered)": {
+    action: "scan_result",
+    seq: 42,
+    success: true,
+    scan: { tagId: "04A1B2C3D4E5F6", isRegistered: true },
+    user: { name: "Juan Dela Cruz", role: "driver" },
+  },
+  "scan_result (unknown)": {
+    action: "scan_result",
+    seq: 43,
+    success: true,
+    scan: { tagId: "DEADBEEF", isRegistered: false },
+  },
+  commands: {
+    action: "commands",
+    id: 3,
+    version: '"c-5e6f7a8b"',
+    commands: buildDeviceCommands({
+      isActive: true,
+      registrationMode: true,
+      scanMode: true,
+      pendingRegistrationTagId: "04A1B2C3",
+    }),
+    deviceStatus: { isActive: true, registrationMode: true, scanMode: true },
+  },
+};
+
+// A "commands" push flattens to its mode flags and pending tag, from which
+// the firmware rebuilds the list
+const flatten = (message: any) => {
+  const { scan, user, commands, deviceStatus, ...rest } = message;
+  const registration = commands?.find((command: any) => command.action === "enable_registration");
+  return {
+    ...rest,
+    ...(scan ? { tagId: scan.tagId, isRegistered: scan.isRegistered } : {}),
+    ...(user ? { userName: user.name, userRole: user.role } : {}),
+    ...(registration ? { tagId: registration.tagId } : {}),
+    ...(deviceStatus
+      ? { registrationMode: deviceStatus.registrationMode, scanMode: deviceStatus.scanMode }
+      : {}),
+  };
+};
+
+const sameFields = (a: Record<string, any>, b: Record<string, any>) =>
+  Object.keys(a).length === Object.keys(b).length &&
+  Object.keys(a).every((key) => a[key] === b[key]);
+
+type WireVector = {
+  name: string;
+  from: string;
+  frame: Uint8Array;
+  fields: [string, number | boolean | string][];
+};
+
+// Format described at the top of the file
+const loadWireVectors = (): WireVector[] => {
+  const path = new URL("../../TagSakay_Fixed_Complete/tests/wire_vectors.txt", import.meta.url);
+  return readFileSync(path, "utf8")
+    .split("\n")
+    .filter((line) => line.trim() && !line.startsWith("#"))
+    .map((line) => {
+      const [name, from, frameHex, ...items] = line.replace(/\r$/, "").split("\t");
+      const fields = items.map((item): [string, number | boolean | string] => {
+        const eq = item.indexOf("=");
+        const value = item.slice(eq + 1);
+        return [
+          item.slice(0, eq),
+          value.startsWith('"') ? value.slice(1, -1)
+            : value === "true" || value === "false" ? value === "true"
+            : Number(value),
+        ];
+      });
+      const frame = Uint8Array.from(frameHex.match(/../g)!.map((byte) => parseInt(byte, 16)));
+      return { name, from, frame, fields };
+    });
+};
+
+const hex = (bytes: Uint8Array) => Buffer.from(bytes).toString("hex");
+
+// Server frames are built from the nested message, as scanReply() and
+// checkCommands() send it
+const nestMessage = (flat: Record<string, any>) => {
+  if (flat.action === "commands") {
+    const { tagId, registrationMode, scanMode, ...rest } = flat;
+    const state = { isActive: true, registrationMode, scanMode };
+    return {
+      ...rest,
+      commands: buildDeviceCommands({ ...state, pendingRegistrationTagId: tagId ?? null }),
+      deviceStatus: state,
+    };
+  }
+  const { userName, userRole, ...rest } = flat;
+  return userName === undefined ? rest : { ...rest, user: { name: userName, role: userRole } };
+};
+
+let ok = true;
+const vectors = loadWireVectors();
+console.log(`Shared wire vectors (${vectors.length})\n`);
+for (const vector of vectors) {
+  const problems: string[] = [];
+  try {
+    const decoded = Object.entries(decodeDeviceFrame(vector.frame));
+    if (JSON.stringify(decoded) !== JSON.stringify(vector.fields)) {
+      problems.push(`decodes to ${JSON.stringify(decoded)}`);
+    }
+  } catch (error: any) {
+    problems.push(`decode failed: ${error.message}`);
+  }
+  if (vector.from === "server") {
+    const encoded = encodeDeviceFrame(nestMessage(Object.fromEntries(vector.fields)));
+    if (!encoded || hex(encoded) !== hex(vector.frame)) {
+      problems.push(`encodes to ${encoded ? hex(encoded) : "nothing"}`);
+    }
+  }
+  console.log(`${problems.length ? "FAIL" : "ok  "}  ${vector.name} (${vector.from})`);
+  for (const problem of problems) console.error(`      ${problem}`);
+  if (problems.length) ok = false;
+}
+console.log("");
+
+const timeUs = (fn: () => void) => {
+  const started = performance.now();
+  for (let i = 0; i < ITERATIONS; i++) fn();
+  return ((performance.now() - started) * 1000) / ITERATIONS;
+};
+
+console.log(`Device socket encoding benchmark (${ITERATIONS} iterations)\n`);
+
+let jsonTotal = 0;
+let binaryTotal = 0;
+for (const [name, message] of Object.entries(messages)) {
+  const json = JSON.stringify(message);
+  const frame = encodeDeviceFrame(message);
+  if (!frame) {
+    console.error(`${name}: not encodable`);
+    ok = false;
+    continue;
+  }
+
+  if (!sameFields(flatten(message), decodeDeviceFrame(frame))) {
+    console.error(`${name}: round trip mismatch`);
+    ok = false;
+  }
+
+  const jsonBytes = new TextEncoder().encode(json).length;
+  jsonTotal += jsonBytes;
+  binaryTotal += frame.length;
+
+  const jsonEncodeUs = timeUs(() => JSON.stringify(message));
+  const jsonDecodeUs = timeUs(() => JSON.parse(json));
+  const binaryEncodeUs = timeUs(() => encodeDeviceFrame(message));
+  const binaryDecodeUs = timeUs(() => decodeDeviceFrame(frame));
+
+  console.log(
+    [
+      name.padEnd(26),
+      `json ${String(jsonBytes).padStart(4)} B`,
+      `msgpack ${String(frame.length).padStart(4)} B`,
+      `(${((frame.length / jsonBytes) * 100).toFixed(0).padStart(3)}%)`,
+      `encode ${jsonEncodeUs.toFixed(2)}/${binaryEncodeUs.toFixed(2)}us`,
+      `decode ${jsonDecodeUs.toFixed(2)}/${binaryDecodeUs.toFixed(2)}us`,
+    ].join("  ")
+  );
+}
+
+console.log(
+  `\nTotal ${jsonTotal} B json, ${binaryTotal} B msgpack ` +
+    `(${((binaryTotal / jsonTotal) * 100).toFixed(0)}%); times are json/msgpack`
+);
+
+if (!ok) {
+  console.error("\nVector or round trip failures - key table or codec is broken");
+  process.exit(1);
+}